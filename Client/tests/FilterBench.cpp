@@ -0,0 +1,68 @@
+#include "rrc_client.hpp"
+#include "rrc_filter.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+// Filtri del volante su uno sterzo sintetico: slalom a 0.5-1.5 Hz più il rumore del sensore.
+// Confronta ciò che arriva al Pi dopo la latenza one-way con la posizione vera del volante in
+// quell'istante (errore e rumore residuo) e misura il costo di ogni chiamata.
+// Uso: filter_bench [latenza one-way in us, default 20000]
+namespace {
+constexpr double PERIOD_S = 0.004;  // Comandi a 250 Hz
+constexpr double DURATION_S = 60.0;
+constexpr double NOISE_UNITS = 6.0; // Deviazione standard del rumore, in unità di asse
+
+double trueSteering(double t) {
+    return 1000.0 + 600.0 * std::sin(2.0 * 3.14159265358979 * (0.5 + 0.5 * std::sin(0.1 * t)) * t);
+}
+
+void run(const char *spec, uint64_t one_way_us) {
+    InputFilter filter;
+    std::string error;
+    filter.configure(spec, error);
+    std::mt19937 random(42);
+    std::normal_distribution<double> noise(0.0, NOISE_UNITS);
+
+    const int steps = static_cast<int>(DURATION_S / PERIOD_S);
+    double error_sq = 0.0;
+    double jitter_sq = 0.0;
+    double previous_out = 0.0;
+    double previous_truth = 0.0;
+    uint64_t cost_ns = 0;
+    for (int i = 0; i < steps; ++i) {
+        const double t = i * PERIOD_S;
+        WheelState input;
+        input.steering = static_cast<int>(std::lround(trueSteering(t) + noise(random)));
+
+        const auto start = std::chrono::steady_clock::now();
+        const WheelState output = filter.apply(input, static_cast<uint64_t>(t * 1e6) + 1, one_way_us);
+        cost_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+        // Il comando viene applicato sul Pi one_way_us dopo: lì si confronta con il volante vero
+        const double truth = trueSteering(t + one_way_us / 1e6);
+        error_sq += (output.steering - truth) * (output.steering - truth);
+        if (i > 0) {
+            // Rumore residuo: variazione del comando meno variazione vera del volante
+            const double wobble = (output.steering - previous_out) - (truth - previous_truth);
+            jitter_sq += wobble * wobble;
+        }
+        previous_out = output.steering;
+        previous_truth = truth;
+    }
+    printf("%-26s %10.1f %12.2f %10.0f\n", *spec ? spec : "(grezzo)", std::sqrt(error_sq / steps),
+           std::sqrt(jitter_sq / (steps - 1)), static_cast<double>(cost_ns) / steps);
+}
+}
+
+int main(int argc, char **argv) {
+    const uint64_t one_way_us = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000;
+    printf("Sterzo a 250 Hz, rumore %.0f unità, latenza one-way %llu us\n", NOISE_UNITS,
+           static_cast<unsigned long long>(one_way_us));
+    printf("%-26s %10s %12s %10s\n", "stadi", "errore RMS", "rumore/passo", "ns/comando");
+    for (const char *spec : {"", "steering:smooth", "steering:predict", "steering:smooth+predict"}) {
+        run(spec, one_way_us);
+    }
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include "rrc_haptic.hpp"
+#include "rrc_platform.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+// Prova senza volante: il force feedback gira sul volante simulato con telemetria sintetica
+// (accelerazione, velocità costante, urto, perdita della telemetria) e deve restare sopra 200 Hz.
+namespace {
+void report(const char *phase, const SimulatedHaptic &wheel) {
+    std::cout << phase << ": molla " << wheel.spring() << ", coppia " << wheel.force()
+              << ", picco " << wheel.peakForce() << std::endl;
+}
+}
+
+int main() {
+    SimulatedHaptic wheel;
+    ForceFeedback feedback(wheel);
+    Telemetry telemetry;
+
+    const uint64_t start_us = monotonicMicros();
+    feedback.start();
+
+    // Telemetria a 50 Hz come quella del Pi, su questo thread che fa da thread di rete
+    for (int i = 0; i < 150; ++i) {
+        telemetry.seq++;
+        telemetry.speed_cm_s = static_cast<int16_t>(std::min(i * 10, 800));
+        telemetry.impact_mg = i == 100 ? 3000 : 0; // Urto dopo 2 s
+        telemetry.accel_y_mg = i == 100 ? 1200 : 0;
+        telemetry.flags = TELEMETRY_FLAG_IMU;
+        feedback.onTelemetry(telemetry, monotonicMicros());
+        if (i == 0 || i == 99 || i == 101) {
+            report(i == 0 ? "Fermo" : i == 99 ? "In velocità" : "Urto", wheel);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(700)); // Telemetria persa
+    report("Senza telemetria", wheel);
+    feedback.stop();
+
+    const double elapsed_s = (monotonicMicros() - start_us) / 1e6;
+    const ForceFeedbackStats stats = feedback.stats();
+    const double rate = stats.updates / elapsed_s;
+    std::cout << "Aggiornamenti: " << stats.updates << " in " << elapsed_s << " s (" << rate << " Hz), ritardo max "
+              << stats.max_late_us << " us, tick saltati " << stats.overruns << std::endl;
+
+    if (rate < 200.0 || wheel.peakForce() < 0.5) {
+        std::cerr << "Force feedback non conforme" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "OK" << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,236 @@
+#include "rrc_client.hpp"
+#include "rrc_stats.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Cadenza del thread dei comandi senza volante né Pi: un finto Pi su loopback concede il lease
+// con il periodo scelto e misura lo scarto di ogni intervallo tra due comandi dal periodo.
+// Con --loss il finto Pi scarta i datagrammi a caso e conta quanti stati gli sono arrivati,
+// direttamente (anche come copia) o solo nella storia di un comando successivo. Il volante preme
+// il paddle per un solo campione ogni PADDLE_EVERY: il finto Pi applica le pressioni come quello
+// vero, anche dagli stati saltati nella storia, e le confronta con quelle inviate.
+// Con --echo il mittente stampa i comandi come il client con RRC_ECHO=1, per misurarne il costo.
+// Uso: sender_bench [--period-ms=N] [--frames=N] [--spin-us=N] [--loss=P] [--history=K] [--duplicate-us=N] [--echo]
+namespace {
+class SimulatedWheel : public WheelSource {
+public:
+    WheelState sample() override {
+        WheelState state;
+        phase_ += 0.05;
+        state.steering = AXIS_MAX_VALUE / 2 + static_cast<int>(std::sin(phase_) * AXIS_MAX_VALUE / 2);
+        state.accelerator = AXIS_MAX_VALUE / 4;
+        samples_++;
+        if (samples_ % PADDLE_EVERY == 0) {
+            state.paddle = (samples_ / PADDLE_EVERY) % 2 ? -1 : 1;
+        }
+        return state;
+    }
+
+private:
+    static constexpr uint64_t PADDLE_EVERY = 25;
+    double phase_ = 0.0;
+    uint64_t samples_ = 0;
+};
+
+struct FakePi {
+    int fd = -1;
+    int period_ms = 0;
+    int frames = 0;
+    double loss = 0.0; // Probabilità di perdere ogni datagramma in arrivo, indipendente
+    LatencyHistogram interval_error_us;
+    std::vector<uint8_t> seen; // Per numero di sequenza: 0 mai visto, 1 ricevuto, 2 solo nella storia
+    std::vector<int8_t> paddle; // Per numero di sequenza, letto prima dello scarto: le pressioni inviate
+    uint64_t stale = 0;
+    uint64_t presses_applied = 0;  // Ogni stato si applica al più una volta: direttamente o dalla storia
+    uint64_t presses_from_history = 0;
+
+    void applyPaddle(int8_t value, bool from_history) {
+        if (value != 0) {
+            presses_applied++;
+            presses_from_history += from_history;
+        }
+    }
+};
+
+void servePi(FakePi &pi, ControlAuth &auth) {
+    uint8_t datagram[256];
+    sockaddr_in client{};
+    socklen_t client_len = sizeof(client);
+    std::mt19937 random(7);
+    std::bernoulli_distribution drop(pi.loss);
+    uint64_t last_us = 0;
+    uint32_t last_seq = 0;
+    pi.seen.assign(pi.frames + 1, 0);
+    pi.paddle.assign(pi.frames + 1, 0);
+    while (last_seq < static_cast<uint32_t>(pi.frames)) {
+        ssize_t n = recvfrom(pi.fd, datagram, sizeof(datagram), 0, reinterpret_cast<sockaddr *>(&client), &client_len);
+        const uint64_t now_us = monotonicMicros();
+        size_t len = n > 0 ? static_cast<size_t>(n) : 0;
+        uint32_t counter;
+        uint32_t nonce;
+        uint32_t challenge;
+        ControlFrame control;
+        if (len == 0 || !auth.open(datagram, len, len, counter)) {
+            continue;
+        }
+        if (parseHello(datagram, len, nonce, challenge)) {
+            SessionAccept accept;
+            accept.status = SESSION_GRANTED;
+            accept.nonce = nonce;
+            accept.token = 0x5AFE;
+            accept.period_ms = static_cast<uint16_t>(pi.period_ms);
+            uint8_t reply[ACCEPT_SIZE + AUTH_TRAILER_SIZE];
+            writeAccept(reply, accept);
+            sendto(pi.fd, reply, auth.seal(reply, ACCEPT_SIZE), 0, reinterpret_cast<sockaddr *>(&client), client_len);
+        } else if (parseControlFrame(datagram, len, control)) {
+            if (control.seq <= static_cast<uint32_t>(pi.frames)) {
+                pi.paddle[control.seq] = control.paddle;
+            }
+            if (drop(random)) {
+                continue;
+            }
+            // Come il Pi: si applica solo un numero di sequenza più recente dell'ultimo
+            if (control.seq <= last_seq || control.seq > static_cast<uint32_t>(pi.frames)) {
+                pi.stale++;
+                continue;
+            }
+            if (control.seq == last_seq + 1 && last_us != 0) {
+                pi.interval_error_us.record(std::llabs(static_cast<long long>(now_us - last_us) - pi.period_ms * 1000LL));
+            }
+            pi.seen[control.seq] = 1;
+            for (uint32_t i = 0; i < control.history_count && control.seq > i + 1; ++i) {
+                if (pi.seen[control.seq - 1 - i] == 0) {
+                    pi.seen[control.seq - 1 - i] = 2;
+                }
+            }
+            // Dalla storia solo gli stati saltati, dal più vecchio, poi il comando stesso
+            const uint32_t skipped = std::min<uint32_t>(control.seq - last_seq - 1, control.history_count);
+            for (uint32_t i = skipped; i-- > 0;) {
+                pi.applyPaddle(control.history[i].paddle, true);
+            }
+            pi.applyPaddle(control.paddle, false);
+            last_us = now_us;
+            last_seq = control.seq;
+        }
+    }
+}
+
+// Il finto Pi risponde sul socket dei comandi come quello vero: le risposte le legge questo thread
+void readReplies(ControlSession &session, const std::atomic<bool> &running) {
+    uint8_t datagram[256];
+    while (running) {
+        bool reply_ready = false;
+        bool unused = false;
+        waitReadable(session.socket(), session.socket(), 50000, reply_ready, unused);
+        const int n = reply_ready ? netRecv(session.socket(), datagram, sizeof(datagram)) : -1;
+        if (n > 0) {
+            session.onReply(datagram, n, nullptr, monotonicMicros());
+        }
+    }
+}
+}
+
+int main(int argc, char **argv) {
+    FakePi pi;
+    pi.period_ms = 10;
+    pi.frames = 1000;
+    int spin_us = -1;
+    bool echo = false;
+    RedundancyOptions redundancy;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--period-ms=", 0) == 0 && std::atoi(arg.c_str() + 12) > 0) {
+            pi.period_ms = std::atoi(arg.c_str() + 12);
+        } else if (arg.rfind("--frames=", 0) == 0 && std::atoi(arg.c_str() + 9) > 1) {
+            pi.frames = std::atoi(arg.c_str() + 9);
+        } else if (arg.rfind("--spin-us=", 0) == 0 && std::atoi(arg.c_str() + 10) >= 0) {
+            spin_us = std::atoi(arg.c_str() + 10);
+        } else if (arg.rfind("--loss=", 0) == 0) {
+            pi.loss = std::atof(arg.c_str() + 7);
+        } else if (arg.rfind("--history=", 0) == 0 && std::atoi(arg.c_str() + 10) <= static_cast<int>(CONTROL_HISTORY_MAX)) {
+            redundancy.history = std::atoi(arg.c_str() + 10);
+        } else if (arg.rfind("--duplicate-us=", 0) == 0) {
+            redundancy.duplicate_us = std::strtoull(arg.c_str() + 15, nullptr, 10);
+        } else if (arg == "--echo") {
+            echo = true;
+        } else {
+            std::cerr << "Uso: " << argv[0] << " [--period-ms=N] [--frames=N] [--spin-us=N] [--loss=P] [--history=K]"
+                      << " [--duplicate-us=N] [--echo]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    platformStartup();
+    pi.fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    NetSocket sock = openUdpSocket();
+    if (pi.fd < 0 || bind(pi.fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 ||
+        getsockname(pi.fd, reinterpret_cast<sockaddr *>(&addr), &addr_len) < 0 || sock == INVALID_NET_SOCKET ||
+        !connectUdp(sock, addr.sin_addr.s_addr, ntohs(addr.sin_port))) {
+        std::cerr << "Socket di prova non disponibili: " << netLastError() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    ControlAuth auth;
+    const uint8_t key[16] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+    auth.setKey(key);
+    ControlAuth pi_auth;
+    pi_auth.setKey(key);
+
+    ControlSession session(sock, auth);
+    if (spin_us >= 0) {
+        session.setPacingSpin(static_cast<uint64_t>(spin_us));
+    }
+    session.setRedundancy(redundancy);
+    session.setEcho(echo);
+    SimulatedWheel wheel;
+    std::atomic<bool> running{true};
+    std::thread pi_thread(servePi, std::ref(pi), std::ref(pi_auth));
+    std::thread reply_thread(readReplies, std::ref(session), std::cref(running));
+    std::thread sender([&] { session.runSender(wheel, running); });
+
+    pi_thread.join();
+    running = false;
+    sender.join();
+    reply_thread.join();
+    closeSocket(sock);
+    close(pi.fd);
+
+    const SenderStats stats = session.stats();
+    std::cout << pi.frames << " comandi ogni " << session.periodMs() << " ms"
+              << (echo ? ", con eco sulla console" : "") << std::endl;
+    std::cout << "Scarto dell'intervallo dal periodo, all'arrivo: " << pi.interval_error_us.summary() << std::endl;
+    std::cout << "Scarto dell'intervallo dal periodo, all'invio: " << stats.interval_error_us.summary() << std::endl;
+    uint64_t direct = 0;
+    uint64_t recovered = 0;
+    for (int seq = 1; seq <= pi.frames; ++seq) {
+        direct += pi.seen[seq] == 1;
+        recovered += pi.seen[seq] == 2;
+    }
+    printf("Stati arrivati con perdita %.0f%%: %.1f%% in tempo, %.1f%% contando la storia (scartati come vecchi %llu)\n",
+           pi.loss * 100.0, direct * 100.0 / pi.frames, (direct + recovered) * 100.0 / pi.frames,
+           static_cast<unsigned long long>(pi.stale));
+    uint64_t presses = 0;
+    for (int seq = 1; seq <= pi.frames; ++seq) {
+        presses += pi.paddle[seq] != 0;
+    }
+    printf("Pressioni brevi del paddle: %llu inviate, %llu applicate (%llu dalla storia)\n",
+           static_cast<unsigned long long>(presses), static_cast<unsigned long long>(pi.presses_applied),
+           static_cast<unsigned long long>(pi.presses_from_history));
+    std::cout << "Mittente: ritardo max " << stats.max_late_us << " us, periodi saltati " << stats.overruns
+              << ", hello " << stats.hellos << ", copie " << stats.duplicates << ", errori di invio "
+              << stats.send_errors << std::endl;
+    return session.periodMs() == pi.period_ms ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,88 +1,31 @@
 // WINDOWS
 
 #define SDL_MAIN_HANDLED
-#include <chrono>
-#include <cstdio>
+#include <atomic>
+#include <cstdlib>
 #include <iostream>
-#include <mutex>
-#include <algorithm>
-#include <cmath>
 #include <string>
 #include <thread>
-#include <winsock2.h>
-#include <ws2tcpip.h>
 #include <SDL2/SDL.h>
 
-#pragma comment(lib, "ws2_32.lib")
-
-#define PORT 8080  // Porta utilizzata
-#define VIDEO_PORT 1234  // Porta per il flusso video
-
-constexpr int AXIS_STEERING = 0;
-constexpr int AXIS_ACCELERATOR = 1;
-constexpr int AXIS_BRAKE = 2;
-constexpr int AXIS_MAX_VALUE = 2000;
-constexpr double RAW_AXIS_FULL_RANGE = 65535.0;
-constexpr double RAW_AXIS_HALF_RANGE = 32768.0;
-
-int normalizeAxis(int raw) {
-    const double scaled = (static_cast<double>(raw) + RAW_AXIS_HALF_RANGE) * AXIS_MAX_VALUE / RAW_AXIS_FULL_RANGE;
-    const int value = static_cast<int>(std::lround(scaled));
-    return std::clamp(value, 0, AXIS_MAX_VALUE);
-}
-
-std::mutex commandMutex;
-bool running = true;  // Variabile globale per il controllo del ciclo
-
-// Funzione per gestire lo streaming video tramite ffplay
-void streamVideo(const std::string& raspberry_ip) {
-    std::string command = "ffplay -fflags nobuffer -flags low_delay -framedrop udp://" + raspberry_ip + ":" + std::to_string(VIDEO_PORT) + " > NUL 2>&1";
-    FILE* result = popen(command.c_str(), "r");
-
-    if (!result) {
-        std::cerr << "Errore nell'esecuzione del comando ffplay." << std::endl;
-    }
-}
-
-// Funzione per inviare comandi al Raspberry Pi in un thread separato
-void handleCommands(int sock, SDL_Joystick* g29) {
-	int steering, accelerator, brake, paddle;
-    while (running) {
-        std::lock_guard<std::mutex> lock(commandMutex);  // Lock per evitare problemi di concorrenza
-        SDL_JoystickUpdate();
-
-    steering = SDL_JoystickGetAxis(g29, AXIS_STEERING);  // Asse dello sterzo
-        steering = (steering + 32767) / 32.767;      // Normalizza tra 0 e 2000
-
-    accelerator = SDL_JoystickGetAxis(g29, AXIS_ACCELERATOR);  // Acceleratore (pedale destro)
-        accelerator = AXIS_MAX_VALUE - normalizeAxis(accelerator);  // Inverti per avere 0 a riposo
-
-    brake = SDL_JoystickGetAxis(g29, AXIS_BRAKE);  // Freno (pedale sinistro)
-        brake = AXIS_MAX_VALUE - normalizeAxis(brake);  // Inverti per avere 0 a riposo
-
-        paddle = 0;
-        if (SDL_JoystickGetButton(g29, 4)) {
-            paddle = -1;  // Modalità Reverse
-        } else if (SDL_JoystickGetButton(g29, 5)) {
-            paddle = 1;  // Modalità Drive
-        }
-
-        if (sock != INVALID_SOCKET) {
-            std::string command = std::to_string(steering) + " " + std::to_string(accelerator) + " " +
-                                  std::to_string(brake) + " " + std::to_string(paddle);
-            std::cout << command << std::endl;
-            send(sock, command.c_str(), command.length(), 0);
-        }
-
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));  // Evita di saturare la CPU
-    }
-}
+#include "rrc_client.hpp"
+#include "rrc_sdlhaptic.hpp"
+#include "rrc_sdlwheel.hpp"
 
 int main() {
+    std::atomic<bool> running{true};  // Controllo del ciclo principale e dei thread
+    ControlAuth controlAuth; // Chiave condivisa con il Pi (RRC_PSK)
+
     std::string raspberry_ip;
     std::cout << "Inserisci l'indirizzo IP del Raspberry Pi: ";
     std::cin >> raspberry_ip;
 
+    uint32_t raspberry_addr;
+    if (!parseIpv4(raspberry_ip, raspberry_addr)) {
+        std::cerr << "Indirizzo IP non valido o non supportato." << std::endl;
+        return -1;
+    }
+
     // Inizializza SDL per il joystick (Logitech G29)
     if (SDL_Init(SDL_INIT_JOYSTICK) < 0) {
         std::cerr << "Impossibile inizializzare SDL: " << SDL_GetError() << std::endl;
@@ -91,50 +34,73 @@ int main() {
     SDL_Joystick* g29 = SDL_JoystickOpen(0);
     if (!g29) {
         std::cerr << "Impossibile aprire il joystick: " << SDL_GetError() << std::endl;
+        SDL_Quit();
         return -1;
     }
 
-    // Inizializzazione di Winsock
-    WSADATA wsaData;
-    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
-        std::cerr << "Errore nell'inizializzazione di Winsock." << std::endl;
-        return -1;
+    // Force feedback su un thread proprio; senza motore del volante il client funziona comunque
+    SdlHaptic haptic;
+    ForceFeedback feedback(haptic);
+    const bool has_feedback = haptic.open(g29);
+    if (has_feedback) {
+        feedback.start();
     }
 
-    int sock = socket(AF_INET, SOCK_DGRAM, 0);
-    struct sockaddr_in serv_addr;
-    if (sock < 0) {
-        std::cerr << "Errore nella creazione del socket." << std::endl;
+    // Inizializzazione di Winsock
+    if (!platformStartup()) {
+        std::cerr << "Errore nell'inizializzazione di Winsock." << std::endl;
+        feedback.stop();
+        haptic.close();
         SDL_JoystickClose(g29);
         SDL_Quit();
-        WSACleanup();
         return -1;
     }
 
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port = htons(PORT);
-
-    if (inet_pton(AF_INET, raspberry_ip.c_str(), &serv_addr.sin_addr) <= 0) {
-        std::cerr << "Indirizzo IP non valido o non supportato." << std::endl;
-        return -1;
-    }
-
-    if (connect(sock, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) == SOCKET_ERROR) {
-        std::cerr << "Impossibile configurare il socket UDP: " << WSAGetLastError() << std::endl;
-        closesocket(sock);
+    NetSocket sock = openUdpSocket();
+    if (sock == INVALID_NET_SOCKET || !connectUdp(sock, raspberry_addr, CONTROL_PORT)) {
+        std::cerr << "Impossibile configurare il socket UDP: " << netLastError() << std::endl;
+        if (sock != INVALID_NET_SOCKET) {
+            closeSocket(sock);
+        }
+        feedback.stop();
+        haptic.close();
         SDL_JoystickClose(g29);
         SDL_Quit();
-        WSACleanup();
+        platformCleanup();
         return -1;
     }
+    setExpeditedForwarding(sock);
 
+    if (controlAuth.loadFromEnv()) {
+        std::cout << "Comandi autenticati con la chiave RRC_PSK." << std::endl;
+    } else {
+        std::cout << "RRC_PSK non impostata: comandi senza autenticazione." << std::endl;
+    }
     std::cout << "Pronto a inviare datagrammi a " << raspberry_ip << std::endl;
 
+    ControlSession session(sock, controlAuth);
+    // Eco dei comandi sulla console solo a richiesta (RRC_ECHO=1), comunque limitata a pochi Hz
+    const char *echo = std::getenv("RRC_ECHO");
+    session.setEcho(echo && std::string(echo) == "1");
+    InputFilter filter; // Filtri e previsione per canale da RRC_FILTER, spenti di default
+    if (filter.loadFromEnv()) {
+        std::cout << "Filtri sui comandi: " << filter.describe() << std::endl;
+        session.setFilter(&filter);
+    }
+    RedundancyOptions redundancy; // Storia e duplicati dei comandi da RRC_REDUNDANCY
+    if (redundancy.loadFromEnv()) {
+        std::cout << "Ridondanza dei comandi: storia " << redundancy.history << ", copia dopo "
+                  << redundancy.duplicate_us << " us" << std::endl;
+        session.setRedundancy(redundancy);
+    }
+    SdlWheel wheel(g29);
+
     // Avvia il thread per inviare i comandi al Raspberry Pi
-    std::thread commandThread(handleCommands, sock, g29);
+    std::thread commandThread([&] { session.runSender(wheel, running); });
 
     // Avvia il thread per lo streaming video tramite ffplay
-    std::thread videoThread(streamVideo, raspberry_ip);
+    std::thread videoThread(streamVideo, raspberry_ip, std::ref(session), has_feedback ? &feedback : nullptr,
+                            std::cref(running));
 
     // Ciclo principale per gestire gli eventi
     while (running) {
@@ -145,21 +111,26 @@ int main() {
             } else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE) {
                 std::cout << "Tasto ESC premuto, interrompendo il programma..." << std::endl;
                 running = false;  // Esci dal ciclo principale
+            } else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_r) {
+                // Avvia o ferma la registrazione sul Pi; lo stato arriva sul thread video
+                session.sendRecordToggle();
             }
         }
     }
 
     // Chiudi tutto correttamente
-    running = false;
     if (commandThread.joinable()) {
         commandThread.join();
     }
     if (videoThread.joinable()) {
         videoThread.join();
     }
+    session.sendBye();
+    feedback.stop();
+    haptic.close();
     SDL_JoystickClose(g29);
-    closesocket(sock);
+    closeSocket(sock);
     SDL_Quit();
-    WSACleanup();
+    platformCleanup();
     return 0;
 }
@@ -0,0 +1,67 @@
+#ifndef RRC_AUTH_HPP
+#define RRC_AUTH_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// SipHash-2-4 (Aumasson, Bernstein): MAC a 64 bit, veloce su messaggi corti anche senza AES/NEON
+uint64_t siphash24(const uint8_t key[16], const uint8_t *data, size_t len);
+
+// Coda aggiunta a ogni messaggio binario del canale di controllo: contatore del mittente e MAC
+// SipHash-2-4 calcolato su messaggio e contatore con la chiave condivisa (variabile RRC_PSK).
+constexpr size_t AUTH_COUNTER_SIZE = 4;
+constexpr size_t AUTH_MAC_SIZE = 8;
+constexpr size_t AUTH_TRAILER_SIZE = AUTH_COUNTER_SIZE + AUTH_MAC_SIZE;
+
+class ControlAuth {
+public:
+    // RRC_PSK: 32 cifre esadecimali (chiave diretta) oppure una passphrase da cui derivarla.
+    // Senza variabile l'autenticazione resta disattivata e i messaggi viaggiano senza coda.
+    bool loadFromEnv();
+    void setKey(const uint8_t key[16]);
+    bool enabled() const { return enabled_; }
+
+    // Aggiunge contatore e MAC dopo i len byte del messaggio; p deve avere spazio per la coda.
+    // Ritorna la lunghezza da inviare. Sicura da più thread (contatore atomico).
+    size_t seal(uint8_t *p, size_t len);
+    // Verifica il MAC; payload_len esclude la coda. Con l'autenticazione disattivata accetta tutto.
+    bool open(const uint8_t *p, size_t len, size_t &payload_len, uint32_t &counter) const;
+
+private:
+    uint8_t key_[16] = {};
+    bool enabled_ = false;
+    std::atomic<uint32_t> counter_{0};
+};
+
+// Finestra anti-replay a 64 posizioni sul contatore (come IPsec/DTLS): accetta contatori nuovi
+// o arrivati fuori ordine entro la finestra, scarta i duplicati e quelli troppo vecchi.
+class ReplayWindow {
+public:
+    bool accept(uint32_t counter);
+    void reset() { started_ = false; bitmap_ = 0; }
+
+private:
+    bool started_ = false;
+    uint32_t highest_ = 0;
+    uint64_t bitmap_ = 0; // Bit i: contatore highest_ - i già visto
+};
+
+// Sfide per l'hello senza stato, come i cookie di DTLS: SipHash con un segreto casuale del Pi
+// sull'indirizzo del client e sull'intervallo di tempo. Valgono nell'intervallo corrente e nel
+// precedente, solo per l'indirizzo a cui sono state mandate; mai 0, che indica l'hello senza sfida.
+class HelloChallenge {
+public:
+    static constexpr uint64_t EPOCH_MS = 2000;
+
+    HelloChallenge();
+    uint32_t issue(uint32_t addr, uint16_t port, uint64_t now_ms) const;
+    bool verify(uint32_t challenge, uint32_t addr, uint16_t port, uint64_t now_ms) const;
+
+private:
+    uint32_t compute(uint32_t addr, uint16_t port, uint64_t epoch) const;
+
+    uint8_t secret_[16];
+};
+
+#endif // RRC_AUTH_HPP
@@ -0,0 +1,160 @@
+#ifndef RRC_CLIENT_HPP
+#define RRC_CLIENT_HPP
+
+#include "rrc_auth.hpp"
+#include "rrc_filter.hpp"
+#include "rrc_haptic.hpp"
+#include "rrc_link.hpp"
+#include "rrc_platform.hpp"
+#include "rrc_proto.hpp"
+#include "rrc_stats.hpp"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+
+// Nucleo del client comune a Linux e Windows: lettura del volante, protocollo di controllo,
+// cadenza dei comandi, ricezione del video e statistiche. Il sistema resta dietro rrc_platform.hpp.
+constexpr int CONTROL_PORT = 8080; // Porta dei comandi del Pi
+constexpr int VIDEO_PORT = 1234;   // Porta locale per il flusso video
+constexpr int AXIS_MAX_VALUE = 2000;
+
+// Ingressi del volante già normalizzati come li vuole il Pi
+struct WheelState {
+    int steering = AXIS_MAX_VALUE / 2; // 0 tutto a sinistra, AXIS_MAX_VALUE tutto a destra
+    int accelerator = 0;               // 0..AXIS_MAX_VALUE
+    int brake = 0;                     // 0..AXIS_MAX_VALUE
+    int paddle = 0;                    // -1 retromarcia, 1 avanti, 0 nessun paddle
+};
+
+// Asse grezzo di SDL (-32768..32767) in 0..AXIS_MAX_VALUE
+int normalizeAxis(int raw);
+// Letture grezze del G29: i pedali a riposo stanno al massimo dell'asse
+WheelState wheelFromRaw(int steering, int accelerator, int brake, bool reverse_paddle, bool drive_paddle);
+
+// Sorgente degli ingressi: il volante vero (SdlWheel) o uno simulato nei benchmark
+class WheelSource {
+public:
+    virtual ~WheelSource() = default;
+    virtual WheelState sample() = 0;
+};
+
+// Ridondanza dei comandi contro le perdite, senza ritrasmissioni né attese: ogni comando porta
+// gli ultimi history stati inviati e/o parte una seconda volta duplicate_us dopo il primo invio
+// (entro metà periodo). Il Pi applica il più recente e scarta i duplicati per numero di sequenza;
+// dagli stati persi ma presenti nella storia recupera le pressioni del paddle.
+struct RedundancyOptions {
+    int history = 0;           // 0..CONTROL_HISTORY_MAX
+    uint64_t duplicate_us = 0; // 0: nessun duplicato
+
+    // "history=2,duplicate_us=500"; stringa vuota: nessuna ridondanza
+    bool parse(const std::string &spec, std::string &error);
+    // Legge RRC_REDUNDANCY; false se assente o non valida (errore già stampato)
+    bool loadFromEnv();
+    bool enabled() const { return history > 0 || duplicate_us > 0; }
+};
+
+struct SenderStats {
+    uint64_t controls = 0;
+    uint64_t hellos = 0;
+    uint64_t send_errors = 0;
+    uint64_t overruns = 0;    // Periodi saltati perché in ritardo di oltre un periodo
+    uint64_t max_late_us = 0; // Ritardo massimo di un invio rispetto alla scadenza
+    uint64_t duplicates = 0;  // Copie ridondanti dei comandi
+    LatencyHistogram interval_error_us; // |intervallo tra due invii - periodo|
+    uint64_t one_way_us = 0;  // Metà del RTT minimo verso il Pi, 0 finché non è misurato
+};
+
+// Sessione di guida sul socket dei comandi (già connesso al Pi): hello finché il Pi non concede
+// il lease, poi comandi con token e sequenza al periodo indicato dall'ACCEPT. Gli invii possono
+// arrivare da più thread: il sigillo è atomico e lo stato condiviso sta in variabili atomiche.
+class ControlSession {
+public:
+    static constexpr uint64_t HELLO_INTERVAL_US = 250000;
+    static constexpr int DEFAULT_PERIOD_MS = 100;
+    static constexpr uint64_t TIME_SYNC_INTERVAL_US = 1000000; // Misura del RTT, serve alla previsione
+
+    ControlSession(NetSocket sock, ControlAuth &auth);
+
+    static constexpr uint64_t ECHO_INTERVAL_US = 250000; // Eco sulla console al più 4 volte al secondo
+
+    // Stampa i comandi inviati, uno ogni ECHO_INTERVAL_US e dopo l'invio: la console non
+    // ritarda mai un comando
+    void setEcho(bool echo) { echo_ = echo; }
+    // Attesa attiva prima di ogni invio, vedi PacingTimer; da impostare prima di runSender
+    void setPacingSpin(uint64_t spin_us) { spin_us_ = spin_us; }
+    // Filtro tra volante e protocollo (nullptr: valori grezzi); da impostare prima di runSender
+    void setFilter(InputFilter *filter) { filter_ = filter; }
+    void setRedundancy(const RedundancyOptions &redundancy) { redundancy_ = redundancy; }
+
+    // Un passo del thread dei comandi: hello senza lease, altrimenti il comando (ritorna true)
+    bool sendInput(const WheelState &state, uint64_t now_us);
+    // Copia dell'ultimo comando, con lo stesso numero di sequenza e un nuovo sigillo
+    void sendDuplicate();
+    // Thread dei comandi: legge il volante e invia a scadenze fisse finché running resta vero
+    void runSender(WheelSource &wheel, const std::atomic<bool> &running);
+
+    void sendTimeRequest(uint64_t now_us);
+    void sendRecordToggle();
+    void sendReceiverReport(const ReceiverReport &report);
+    // Rilascia subito il lease invece di lasciarlo scadere
+    void sendBye();
+
+    // Risposte del Pi: sessione, stato della registrazione e telemetria per il force feedback
+    void onReply(const uint8_t *data, size_t len, ForceFeedback *feedback, uint64_t now_us);
+
+    NetSocket socket() const { return sock_; }
+    uint32_t token() const { return token_.load(); }
+    int periodMs() const { return period_ms_.load(); }
+    uint64_t oneWayUs() const { return one_way_us_.load(); }
+    SenderStats stats() const;
+
+private:
+    void handleAccept(const SessionAccept &accept);
+    void sealAndSend(uint8_t *message, size_t len);
+
+    NetSocket sock_;
+    ControlAuth &auth_;
+    bool echo_ = false;
+    uint64_t spin_us_ = PacingTimer::DEFAULT_SPIN_US;
+    InputFilter *filter_ = nullptr;
+    RedundancyOptions redundancy_;
+    std::atomic<uint32_t> token_{0}; // Token del lease di guida, 0 finché il Pi non lo concede
+    std::atomic<uint32_t> nonce_{0};
+    std::atomic<uint32_t> challenge_{0}; // Ultima sfida del Pi, da firmare negli hello
+    std::atomic<int> period_ms_{DEFAULT_PERIOD_MS};
+    std::atomic<uint64_t> one_way_us_{0};
+
+    // Solo thread di ricezione
+    bool busy_reported_ = false;
+    bool low_power_ = false; // Ultimo stato di alimentazione annunciato dal Pi
+    ClockSync clock_;
+
+    // Solo thread dei comandi
+    uint32_t seq_ = 0;
+    ControlFrame last_frame_;
+    ControlState history_[CONTROL_HISTORY_MAX]; // Stati inviati, il più recente per primo
+    size_t history_size_ = 0;
+    uint64_t last_hello_us_ = 0;
+    uint64_t last_echo_us_ = 0;
+    uint32_t hello_challenge_ = 0; // Sfida dell'ultimo hello inviato
+    uint64_t last_sync_us_ = 0;
+    std::mt19937 nonces_;
+
+    std::atomic<uint64_t> controls_{0};
+    std::atomic<uint64_t> hellos_{0};
+    std::atomic<uint64_t> send_errors_{0};
+    std::atomic<uint64_t> overruns_{0};
+    std::atomic<uint64_t> max_late_us_{0};
+    std::atomic<uint64_t> duplicates_{0};
+    mutable std::mutex interval_mutex_;
+    LatencyHistogram interval_error_us_;
+};
+
+// Riceve il flusso video dal Pi, lo passa a ffplay attraverso FEC e jitter buffer e serve le
+// risposte del Pi sul socket dei comandi, a cui manda i ReceiverReport. Esce quando running diventa falso.
+void streamVideo(const std::string &raspberry_ip, ControlSession &session, ForceFeedback *feedback,
+                 const std::atomic<bool> &running);
+
+#endif // RRC_CLIENT_HPP
@@ -0,0 +1,40 @@
+#ifndef RRC_FEC_HPP
+#define RRC_FEC_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// FEC a parità XOR riga/colonna sui pacchetti di un frame video.
+// cols = 0 disattiva la FEC, rows = 1 usa solo la parità di riga.
+// Ridondanza: 1/cols con sola riga, (cols + rows) / (cols * rows) con entrambe.
+struct FecParams {
+    uint8_t cols = 0;
+    uint8_t rows = 1;
+
+    bool enabled() const { return cols > 0; }
+    bool hasColumns() const { return cols > 0 && rows > 1; }
+};
+
+// Accetta "off", "L" oppure "LxD" (es. "10x4"). Ritorna false se non valido.
+bool parseFecParams(const std::string &text, FecParams &out);
+std::string fecParamsToString(const FecParams &params);
+
+// dst[i] ^= src[i] per len byte. Vettorizzato con NEON, AVX2 o SSE2 se disponibili.
+void fecXor(uint8_t *dst, const uint8_t *src, size_t len);
+
+// Numero di pacchetti di parità di riga/colonna per un frame di data_count pacchetti.
+size_t fecRowCount(const FecParams &params, size_t data_count);
+size_t fecColumnCount(const FecParams &params, size_t data_count);
+
+// Intervallo dei pacchetti dati coperti da una parità: indici first, first + step, ... < end.
+struct FecSpan {
+    size_t first;
+    size_t step;
+    size_t end;
+};
+
+FecSpan fecRowSpan(const FecParams &params, size_t data_count, size_t row);
+FecSpan fecColumnSpan(const FecParams &params, size_t data_count, size_t column);
+
+#endif // RRC_FEC_HPP
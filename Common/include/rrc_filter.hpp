@@ -0,0 +1,71 @@
+#ifndef RRC_FILTER_HPP
+#define RRC_FILTER_HPP
+
+#include <cstdint>
+#include <string>
+
+struct WheelState;
+
+// Filtro One-Euro (Casiez, Roussel, Vogel 2012): passa-basso del primo ordine con la frequenza
+// di taglio che sale con la velocità del segnale. Fermo toglie il rumore del sensore, in
+// movimento rapido segue il volante con poco ritardo. Tiene anche la derivata filtrata.
+class OneEuroFilter {
+public:
+    OneEuroFilter(double min_cutoff_hz, double beta, double derivative_cutoff_hz)
+        : min_cutoff_hz_(min_cutoff_hz), beta_(beta), derivative_cutoff_hz_(derivative_cutoff_hz) {}
+
+    double filter(double value, double dt_s);
+    void reset() { started_ = false; }
+
+    double value() const { return value_; }
+    double derivative() const { return derivative_; } // Unità al secondo
+
+private:
+    double min_cutoff_hz_;
+    double beta_;
+    double derivative_cutoff_hz_;
+    bool started_ = false;
+    double raw_ = 0.0;
+    double value_ = 0.0;
+    double derivative_ = 0.0;
+};
+
+// Stadio opzionale tra la lettura del volante e il protocollo, separato per canale:
+// "smooth" filtra con One-Euro, "predict" estrapola in avanti della latenza one-way misurata,
+// così il Pi riceve il valore che il volante avrà quando il comando arriva.
+// I paddle sono discreti e passano sempre invariati.
+class InputFilter {
+public:
+    enum Channel { STEERING = 0, ACCELERATOR = 1, BRAKE = 2, CHANNELS = 3 };
+
+    static constexpr uint64_t MAX_HORIZON_US = 50000; // Oltre si indovina invece di prevedere
+    static constexpr double STEERING_MIN_CUTOFF_HZ = 1.5;
+    static constexpr double PEDAL_MIN_CUTOFF_HZ = 3.0;
+    static constexpr double BETA = 0.02;              // Per unità di asse al secondo
+    static constexpr double DERIVATIVE_CUTOFF_HZ = 5.0;
+
+    InputFilter();
+
+    // "canale:stadi" separati da virgole, es. "steering:smooth+predict,brake:smooth";
+    // canali steering, accelerator, brake; stadi smooth, predict. Stringa vuota: tutto spento.
+    bool configure(const std::string &spec, std::string &error);
+    // Legge RRC_FILTER; false se assente o non valida (errore già stampato)
+    bool loadFromEnv();
+    bool enabled() const;
+    std::string describe() const;
+
+    // Applica gli stadi attivi; horizon_us è la latenza da compensare, limitata a MAX_HORIZON_US
+    WheelState apply(const WheelState &input, uint64_t now_us, uint64_t horizon_us);
+
+private:
+    struct Stage {
+        bool smooth = false;
+        bool predict = false;
+        OneEuroFilter filter;
+    };
+
+    Stage stages_[CHANNELS];
+    uint64_t last_us_ = 0;
+};
+
+#endif // RRC_FILTER_HPP
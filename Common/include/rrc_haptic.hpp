@@ -0,0 +1,102 @@
+#ifndef RRC_HAPTIC_HPP
+#define RRC_HAPTIC_HPP
+
+#include "rrc_proto.hpp"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// Uscita verso il volante. La molla di centraggio è un effetto del firmware (aggiornato
+// a ~1 kHz dal volante stesso), la coppia costante porta la sensazione della strada e gli urti.
+class HapticDevice {
+public:
+    virtual ~HapticDevice() = default;
+    virtual void setSpring(double stiffness) = 0; // 0..1
+    virtual void setForce(double force) = 0;      // -1..1, positivo verso destra
+};
+
+// Volante simulato per i test senza hardware: registra gli ultimi valori e il numero di aggiornamenti
+class SimulatedHaptic : public HapticDevice {
+public:
+    void setSpring(double stiffness) override;
+    void setForce(double force) override;
+
+    double spring() const { return spring_.load(); }
+    double force() const { return force_.load(); }
+    double peakForce() const { return peak_force_.load(); }
+    uint64_t updates() const { return updates_.load(); }
+
+private:
+    std::atomic<double> spring_{0.0};
+    std::atomic<double> force_{0.0};
+    std::atomic<double> peak_force_{0.0};
+    std::atomic<uint64_t> updates_{0};
+};
+
+struct HapticOutput {
+    double spring = 0.0;
+    double force = 0.0;
+};
+
+// Trasforma la telemetria in effetti: centraggio che cresce con la velocità, vibrazione della
+// strada proporzionale alla velocità, il carico laterale in curva quando c'è l'IMU e un
+// colpo che si smorza in ~150 ms dopo un urto. Senza telemetria recente resta solo il centraggio.
+class ForceFeedbackModel {
+public:
+    static constexpr double BASE_SPRING = 0.15;
+    static constexpr double SPEED_SPRING = 0.55;
+    static constexpr double FULL_SPEED_CM_S = 800.0;
+    static constexpr double ROAD_GAIN = 0.18;
+    static constexpr double ROAD_CUTOFF_RAD_S = 2.0 * 3.14159265358979 * 30.0; // ~30 Hz
+    static constexpr double IMPACT_THRESHOLD_MG = 1500.0;
+    static constexpr double IMPACT_DECAY_S = 0.15;
+    static constexpr double MAX_SLEW_PER_S = 20.0; // Limita i gradini di coppia
+
+    HapticOutput update(const Telemetry &telemetry, bool fresh, double dt);
+
+private:
+    double road_state_ = 0.0;
+    uint32_t noise_ = 0x9E3779B9;
+    double impact_ = 0.0;
+    uint32_t last_seq_ = 0;
+    double smooth_ = 0.0;
+};
+
+struct ForceFeedbackStats {
+    uint64_t updates = 0;
+    uint64_t telemetry = 0;
+    uint64_t overruns = 0;     // Scadenze saltate perché già passate al risveglio
+    uint64_t max_late_us = 0;  // Ritardo massimo di un tick rispetto alla scadenza
+};
+
+// Thread dedicato a RATE_HZ: legge l'ultima telemetria pubblicata dal thread di rete e
+// aggiorna il volante. Non tocca socket né joystick, quindi non rallenta mai l'invio dei comandi.
+class ForceFeedback {
+public:
+    static constexpr int RATE_HZ = 250;
+    static constexpr uint64_t TELEMETRY_TIMEOUT_US = 500000;
+
+    explicit ForceFeedback(HapticDevice &device) : device_(device) {}
+    ~ForceFeedback() { stop(); }
+
+    void start();
+    void stop();
+    void onTelemetry(const Telemetry &telemetry, uint64_t now_us); // Dal thread di rete, now_us da monotonicMicros()
+    ForceFeedbackStats stats() const;
+
+private:
+    void loop();
+
+    HapticDevice &device_;
+    ForceFeedbackModel model_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+
+    mutable std::mutex mutex_; // Protegge telemetry_, received_us_ e stats_
+    Telemetry telemetry_;
+    uint64_t received_us_ = 0;
+    ForceFeedbackStats stats_;
+};
+
+#endif // RRC_HAPTIC_HPP
@@ -0,0 +1,93 @@
+#ifndef RRC_JITTER_HPP
+#define RRC_JITTER_HPP
+
+#include "rrc_stream.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct JitterBufferStats {
+    uint64_t frames_in = 0;
+    uint64_t frames_out = 0;
+    uint64_t late_frames = 0;      // Arrivati dopo il proprio istante di riproduzione
+    uint64_t dropped_late = 0;     // Più vecchi di un frame già consegnato
+    uint64_t dropped_skip = 0;     // Saltati per raggiungere un keyframe dopo un blocco
+    uint64_t dropped_overflow = 0; // Buffer pieno
+    uint64_t catchup_frames = 0;   // Consegnati in anticipo per ridurre il ritardo
+    uint64_t restarts = 0;         // Riavvii dello streaming sul Pi (frame_id ripartito da 0)
+};
+
+// Buffer di riproduzione tra la ricezione dei frame e il decoder.
+// Ogni frame esce a capture_us + base + ritardo, dove base è il transito minimo recente
+// (l'offset tra gli orologi si annulla) e il ritardo è il 95° percentile del transito in
+// eccesso sugli ultimi frame: il buffer più piccolo che mantiene regolare la cadenza.
+// Il ritardo sale subito quando il jitter cresce e scende gradualmente (riproduzione
+// leggermente accelerata) quando cala. I frame in ritardo vengono consegnati subito, perché
+// scartarli corromperebbe i P-frame successivi, a meno che nel buffer ci sia già un keyframe.
+// Un frame_id molto più basso dell'ultimo consegnato è un riavvio del Pi: il buffer riparte da capo.
+class JitterBuffer {
+public:
+    static constexpr size_t CAPACITY = 32;
+    static constexpr uint64_t MAX_DELAY_US = 300000;
+
+    void push(const VideoFrame &frame, uint64_t arrival_us);
+    // Ritorna true se un frame va decodificato ora, disponibile in frame() fino alla prossima pop().
+    bool pop(uint64_t now_us);
+    // Istante del prossimo frame da consegnare, UINT64_MAX se il buffer è vuoto.
+    uint64_t nextPlayoutUs() const;
+
+    const VideoFrame &frame() const { return frame_; }
+    size_t depth() const { return count_; }
+    uint64_t delayUs() const { return delay_us_; }
+    uint64_t targetUs() const { return target_us_; }
+    const JitterBufferStats &stats() const { return stats_; }
+    void reset();
+
+private:
+    static constexpr size_t HISTORY = 128;
+    static constexpr uint64_t MARGIN_US = 2000;
+    static constexpr uint64_t MIN_WINDOW_US = 4000000;
+    static constexpr uint64_t SKIP_LATE_US = 150000;
+    static constexpr int CATCHUP_DIVISOR = 10; // Accelera la riproduzione al più del 10%
+    static constexpr uint64_t DEFAULT_INTERVAL_US = 33333;
+
+    struct Entry {
+        bool used = false;
+        uint32_t frame_id = 0;
+        bool keyframe = false;
+        uint64_t capture_us = 0;
+        std::vector<uint8_t> data;
+    };
+
+    uint64_t playoutUs(const Entry &entry) const;
+    Entry *oldest();
+    void updateTarget(int64_t excess_us);
+    void release(Entry &entry);
+    void restart(); // Come reset(), ma conserva le statistiche
+
+    Entry entries_[CAPACITY];
+    size_t count_ = 0;
+
+    bool have_released_ = false;
+    uint32_t last_released_ = 0;
+    uint64_t last_capture_us_ = 0;
+    uint64_t frame_interval_us_ = DEFAULT_INTERVAL_US;
+
+    int64_t min_transit_cur_ = INT64_MAX;
+    int64_t min_transit_prev_ = INT64_MAX;
+    uint64_t min_window_start_us_ = 0;
+    int64_t base_us_ = 0;
+
+    int64_t history_[HISTORY] = {};
+    int64_t scratch_[HISTORY] = {};
+    size_t history_count_ = 0;
+    size_t history_next_ = 0;
+    uint64_t target_us_ = MARGIN_US;
+    uint64_t delay_us_ = MARGIN_US;
+
+    std::vector<uint8_t> out_;
+    VideoFrame frame_;
+    JitterBufferStats stats_;
+};
+
+#endif // RRC_JITTER_HPP
@@ -0,0 +1,64 @@
+#ifndef RRC_LINK_HPP
+#define RRC_LINK_HPP
+
+#include "rrc_proto.hpp"
+#include <cstdint>
+
+// Misura la qualità del collegamento video lato client e prepara i ReceiverReport per il Pi.
+// Il ritardo di coda è il ritardo one-way (con offset di orologio ignoto) meno il minimo
+// visto negli ultimi secondi: l'offset si annulla e una deriva lenta viene assorbita.
+class LinkMonitor {
+public:
+    static constexpr uint64_t REPORT_INTERVAL_US = 250000;
+
+    void onPacket(uint32_t seq, uint32_t send_us, uint64_t recv_us, size_t bytes);
+    bool reportDue(uint64_t now_us) const;
+    // frames_dropped_total: contatore cumulativo dei frame persi dopo la FEC
+    ReceiverReport makeReport(uint64_t now_us, uint64_t frames_dropped_total);
+
+private:
+    static constexpr uint64_t MIN_WINDOW_US = 5000000;
+
+    bool started_ = false;
+    uint32_t highest_seq_ = 0;
+    uint32_t interval_base_seq_ = 0; // Ultimo seq atteso nell'intervallo precedente
+    uint32_t interval_received_ = 0;
+    uint64_t interval_bytes_ = 0;
+    uint64_t interval_start_us_ = 0;
+    uint64_t last_frames_dropped_ = 0;
+
+    int64_t send_ext_us_ = 0; // send_us esteso a 64 bit
+    uint32_t last_send_us_ = 0;
+    int64_t min_transit_cur_ = INT64_MAX;
+    int64_t min_transit_prev_ = INT64_MAX;
+    uint64_t min_window_start_us_ = 0;
+    double queue_delay_us_ = 0.0;
+    double jitter_us_ = 0.0;
+    int64_t last_transit_ = 0;
+};
+
+// Stima l'offset tra l'orologio del Pi e quello locale dagli scambi TimeSync.
+// Tra gli ultimi campioni usa quello con RTT minimo, il meno disturbato dalle code.
+class ClockSync {
+public:
+    void onReply(const TimeSync &sync, uint64_t client_recv_us);
+
+    bool valid() const { return count_ > 0; }
+    int64_t offsetUs() const; // Orologio del Pi meno orologio locale
+    uint64_t rttUs() const;
+    int64_t toServer(uint64_t client_us) const { return static_cast<int64_t>(client_us) + offsetUs(); }
+
+private:
+    static constexpr size_t WINDOW = 16;
+
+    struct Sample {
+        int64_t offset_us;
+        uint64_t rtt_us;
+    };
+
+    Sample samples_[WINDOW] = {};
+    size_t count_ = 0;
+    size_t next_ = 0;
+};
+
+#endif // RRC_LINK_HPP
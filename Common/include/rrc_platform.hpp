@@ -0,0 +1,77 @@
+#ifndef RRC_PLATFORM_HPP
+#define RRC_PLATFORM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Strato sottile tra il nucleo del client e il sistema: socket UDP, orologio, attese e la pipe
+// verso ffplay. Winsock su Windows, POSIX altrove; gli header di sistema restano in Platform.cpp.
+#ifdef _WIN32
+typedef uintptr_t NetSocket; // SOCKET
+const NetSocket INVALID_NET_SOCKET = ~static_cast<NetSocket>(0);
+#else
+typedef int NetSocket;
+const NetSocket INVALID_NET_SOCKET = -1;
+#endif
+
+// Da chiamare una volta all'avvio e all'uscita (WSAStartup/WSACleanup, SIGPIPE ignorato su Linux)
+bool platformStartup();
+void platformCleanup();
+
+// Ultimo errore di rete in forma leggibile (strerror o codice Winsock)
+std::string netLastError();
+
+NetSocket openUdpSocket();
+void closeSocket(NetSocket sock);
+bool parseIpv4(const std::string &ip, uint32_t &addr); // addr in ordine di rete
+bool connectUdp(NetSocket sock, uint32_t addr, int port);
+bool bindUdp(NetSocket sock, int port);
+void setReceiveBuffer(NetSocket sock, int bytes);
+// DSCP EF: gli access point con WMM mettono i datagrammi nella coda voce.
+// Windows applica IP_TOS solo se consentito dai criteri QoS, altrimenti viene ignorato.
+void setExpeditedForwarding(NetSocket sock);
+
+// Ritornano i byte trasferiti o -1
+int netSend(NetSocket sock, const uint8_t *data, size_t len);
+int netRecv(NetSocket sock, uint8_t *data, size_t len);
+int netRecvFrom(NetSocket sock, uint8_t *data, size_t len, uint32_t &from_addr);
+
+// Attende al più timeout_us che uno dei due socket diventi leggibile
+void waitReadable(NetSocket first, NetSocket second, uint64_t timeout_us, bool &first_ready, bool &second_ready);
+
+// Orologio monotono del client (CLOCK_MONOTONIC su Linux, QueryPerformanceCounter su Windows)
+uint64_t monotonicMicros();
+
+// Attesa fino a una scadenza di monotonicMicros: il timer del sistema dorme fino a spin_us prima,
+// poi un'attesa attiva copre l'ultimo tratto. Su Linux clock_nanosleep assoluto con timer slack
+// minimo; su Windows un waitable timer ad alta risoluzione (con timeBeginPeriod(1) sulle versioni
+// che non lo hanno), che senza spin sbaglierebbe di un tick. Un timer per thread.
+class PacingTimer {
+public:
+#ifdef _WIN32
+    static constexpr uint64_t DEFAULT_SPIN_US = 1000;
+#else
+    static constexpr uint64_t DEFAULT_SPIN_US = 100;
+#endif
+
+    explicit PacingTimer(uint64_t spin_us = DEFAULT_SPIN_US);
+    ~PacingTimer();
+    PacingTimer(const PacingTimer &) = delete;
+    PacingTimer &operator=(const PacingTimer &) = delete;
+
+    void sleepUntil(uint64_t deadline_us);
+    uint64_t spinUs() const { return spin_us_; }
+
+private:
+    uint64_t spin_us_;
+    void *timer_ = nullptr;     // Windows: HANDLE del waitable timer
+    bool coarse_period_ = false; // Windows: timeBeginPeriod(1) da annullare
+};
+
+// Avvia un programma che legge dati binari da stdin, con l'output scartato
+FILE *openPlayerPipe(const std::string &command);
+void closePlayerPipe(FILE *pipe);
+
+#endif // RRC_PLATFORM_HPP
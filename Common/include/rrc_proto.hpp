@@ -0,0 +1,488 @@
+#ifndef RRC_PROTO_HPP
+#define RRC_PROTO_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Formato dei datagrammi condiviso tra Raspberry Pi e client.
+// Tutti i campi multi-byte sono in network order (big-endian).
+
+inline void putU16(uint8_t *p, uint16_t v) {
+    p[0] = static_cast<uint8_t>(v >> 8);
+    p[1] = static_cast<uint8_t>(v);
+}
+
+inline void putU32(uint8_t *p, uint32_t v) {
+    putU16(p, static_cast<uint16_t>(v >> 16));
+    putU16(p + 2, static_cast<uint16_t>(v));
+}
+
+inline void putU64(uint8_t *p, uint64_t v) {
+    putU32(p, static_cast<uint32_t>(v >> 32));
+    putU32(p + 4, static_cast<uint32_t>(v));
+}
+
+inline uint16_t getU16(const uint8_t *p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+inline uint32_t getU32(const uint8_t *p) {
+    return (static_cast<uint32_t>(getU16(p)) << 16) | getU16(p + 2);
+}
+
+inline uint64_t getU64(const uint8_t *p) {
+    return (static_cast<uint64_t>(getU32(p)) << 32) | getU32(p + 4);
+}
+
+// --- Video ---------------------------------------------------------------
+
+constexpr uint16_t VIDEO_MAGIC = 0x5256; // "RV"
+constexpr uint8_t VIDEO_VERSION = 3;
+constexpr size_t VIDEO_MAX_DATAGRAM = 1200; // Sotto l'MTU Wi-Fi anche con incapsulamenti
+constexpr size_t VIDEO_HEADER_SIZE = 32;
+constexpr size_t VIDEO_MAX_PAYLOAD = VIDEO_MAX_DATAGRAM - VIDEO_HEADER_SIZE;
+// Frame più grande accettato: ben oltre un keyframe 1080p, ma limita la memoria che un'intestazione
+// falsificata può far riservare al ricevitore
+constexpr size_t VIDEO_MAX_FRAME_BYTES = 4 * 1024 * 1024;
+constexpr size_t VIDEO_MAX_FRAME_PACKETS = (VIDEO_MAX_FRAME_BYTES + VIDEO_MAX_PAYLOAD - 1) / VIDEO_MAX_PAYLOAD;
+constexpr uint8_t VIDEO_MAX_FEC_DIM = 64; // Righe e colonne dei blocchi FEC, come parseFecParams
+
+enum VideoFlags : uint8_t {
+    VIDEO_FLAG_KEYFRAME = 0x01, // Il frame contiene SPS/IDR
+    VIDEO_FLAG_PARITY = 0x02,   // Pacchetto di parità FEC
+    VIDEO_FLAG_COLUMN = 0x04,   // Parità di colonna (altrimenti di riga)
+};
+
+// Ogni frame H.264 viene diviso in data_count pacchetti dati.
+// Con FEC attiva i pacchetti sono disposti in blocchi di fec_cols x fec_rows:
+// - parità di riga r: XOR dei dati [r*cols, r*cols + cols)
+// - parità di colonna b*cols + c: XOR dei dati (b*rows + r)*cols + c, r in [0, rows)
+struct VideoPacketHeader {
+    uint8_t flags = 0;
+    uint32_t frame_id = 0;
+    uint16_t index = 0;      // Dati: indice nel frame. Parità: indice di riga o colonna
+    uint16_t data_count = 0; // Pacchetti dati del frame
+    uint8_t fec_cols = 0;    // 0 = FEC disattivata
+    uint8_t fec_rows = 0;    // 1 = solo parità di riga
+    uint16_t length = 0;     // Dati: lunghezza payload. Parità: XOR delle lunghezze coperte
+    uint32_t seq = 0;        // Progressivo di ogni datagramma video, per misurare le perdite
+    uint32_t send_us = 0;    // Orologio monotono del Pi all'invio (µs, modulo 2^32)
+    uint64_t capture_us = 0; // Orologio monotono del Pi all'uscita del frame dall'encoder (µs)
+};
+
+inline void writeVideoHeader(uint8_t *p, const VideoPacketHeader &h) {
+    putU16(p, VIDEO_MAGIC);
+    p[2] = VIDEO_VERSION;
+    p[3] = h.flags;
+    putU32(p + 4, h.frame_id);
+    putU16(p + 8, h.index);
+    putU16(p + 10, h.data_count);
+    p[12] = h.fec_cols;
+    p[13] = h.fec_rows;
+    putU16(p + 14, h.length);
+    putU32(p + 16, h.seq);
+    putU32(p + 20, h.send_us);
+    putU64(p + 24, h.capture_us);
+}
+
+inline bool parseVideoHeader(const uint8_t *p, size_t len, VideoPacketHeader &h) {
+    if (len < VIDEO_HEADER_SIZE || getU16(p) != VIDEO_MAGIC || p[2] != VIDEO_VERSION) {
+        return false;
+    }
+    h.flags = p[3];
+    h.frame_id = getU32(p + 4);
+    h.index = getU16(p + 8);
+    h.data_count = getU16(p + 10);
+    h.fec_cols = p[12];
+    h.fec_rows = p[13];
+    h.length = getU16(p + 14);
+    h.seq = getU32(p + 16);
+    h.send_us = getU32(p + 20);
+    h.capture_us = getU64(p + 24);
+    if (h.data_count == 0 || h.data_count > VIDEO_MAX_FRAME_PACKETS) {
+        return false;
+    }
+    // FEC spenta: niente righe né parità. Accesa: blocchi entro i limiti
+    if (h.fec_cols == 0) {
+        return h.fec_rows <= 1 && !(h.flags & VIDEO_FLAG_PARITY) && h.index < h.data_count;
+    }
+    if (h.fec_cols < 2 || h.fec_cols > VIDEO_MAX_FEC_DIM || h.fec_rows < 1 || h.fec_rows > VIDEO_MAX_FEC_DIM) {
+        return false;
+    }
+    if (!(h.flags & VIDEO_FLAG_PARITY)) {
+        return h.index < h.data_count;
+    }
+    // Parità: l'indice deve cadere tra le righe o le colonne che data_count produce
+    const size_t rows_total = (h.data_count + h.fec_cols - 1) / h.fec_cols;
+    if (!(h.flags & VIDEO_FLAG_COLUMN)) {
+        return h.index < rows_total;
+    }
+    return h.fec_rows > 1 && h.index < (rows_total + h.fec_rows - 1) / h.fec_rows * h.fec_cols;
+}
+
+// --- Messaggi binari sul canale di controllo (porta 8080) -----------------
+
+constexpr uint16_t CONTROL_MAGIC = 0x5243; // "RC"
+constexpr size_t CONTROL_HEADER_SIZE = 3;  // magic + tipo
+
+enum ControlMessageType : uint8_t {
+    MSG_RECEIVER_REPORT = 1, // Client -> Pi: qualità del collegamento video
+    MSG_TIME_REQUEST = 2,    // Client -> Pi: richiesta di sincronizzazione dell'orologio
+    MSG_TIME_REPLY = 3,      // Pi -> Client: risposta con i tempi di ricezione e invio
+    MSG_RECORD_CONTROL = 4,  // Client -> Pi: avvia, ferma o commuta la registrazione a bordo
+    MSG_RECORD_STATUS = 5,   // Pi -> Client: stato della registrazione
+    MSG_TELEMETRY = 6,       // Pi -> Client: stato dell'auto per il force feedback
+    MSG_HELLO = 7,           // Client -> Pi: richiesta del lease di guida
+    MSG_ACCEPT = 8,          // Pi -> Client: esito della richiesta, token del lease
+    MSG_CONTROL = 9,         // Client -> Pi: comandi di guida con token e numero di sequenza
+    MSG_BYE = 10,            // Client -> Pi: rilascio del lease
+};
+
+inline bool isControlMessage(const uint8_t *p, size_t len) {
+    return len >= CONTROL_HEADER_SIZE && getU16(p) == CONTROL_MAGIC;
+}
+
+inline uint8_t controlMessageType(const uint8_t *p) {
+    return p[2];
+}
+
+// Statistiche del flusso video misurate dal client in un intervallo
+struct ReceiverReport {
+    uint16_t interval_ms = 0;
+    uint16_t loss_permille = 0;  // Datagrammi video persi prima della FEC
+    uint16_t frames_dropped = 0; // Frame non ricostruibili nell'intervallo
+    uint32_t queue_delay_us = 0; // Ritardo one-way oltre il minimo recente (coda sul percorso)
+    uint32_t jitter_us = 0;      // Jitter di interarrivo (RFC 3550)
+    uint32_t receive_kbps = 0;
+};
+
+constexpr size_t RECEIVER_REPORT_SIZE = CONTROL_HEADER_SIZE + 18;
+
+inline size_t writeReceiverReport(uint8_t *p, const ReceiverReport &r) {
+    putU16(p, CONTROL_MAGIC);
+    p[2] = MSG_RECEIVER_REPORT;
+    putU16(p + 3, r.interval_ms);
+    putU16(p + 5, r.loss_permille);
+    putU16(p + 7, r.frames_dropped);
+    putU32(p + 9, r.queue_delay_us);
+    putU32(p + 13, r.jitter_us);
+    putU32(p + 17, r.receive_kbps);
+    return RECEIVER_REPORT_SIZE;
+}
+
+inline bool parseReceiverReport(const uint8_t *p, size_t len, ReceiverReport &r) {
+    if (len < RECEIVER_REPORT_SIZE || !isControlMessage(p, len) || controlMessageType(p) != MSG_RECEIVER_REPORT) {
+        return false;
+    }
+    r.interval_ms = getU16(p + 3);
+    r.loss_permille = getU16(p + 5);
+    r.frames_dropped = getU16(p + 7);
+    r.queue_delay_us = getU32(p + 9);
+    r.jitter_us = getU32(p + 13);
+    r.receive_kbps = getU32(p + 17);
+    return true;
+}
+
+// Scambio in stile NTP: t0/t3 sull'orologio del client, t1/t2 su quello monotono del Pi
+struct TimeSync {
+    uint64_t client_send_us = 0; // t0
+    uint64_t server_recv_us = 0; // t1
+    uint64_t server_send_us = 0; // t2
+};
+
+constexpr size_t TIME_SYNC_SIZE = CONTROL_HEADER_SIZE + 24;
+
+inline size_t writeTimeSync(uint8_t *p, ControlMessageType type, const TimeSync &t) {
+    putU16(p, CONTROL_MAGIC);
+    p[2] = type;
+    putU64(p + 3, t.client_send_us);
+    putU64(p + 11, t.server_recv_us);
+    putU64(p + 19, t.server_send_us);
+    return TIME_SYNC_SIZE;
+}
+
+inline bool parseTimeSync(const uint8_t *p, size_t len, ControlMessageType type, TimeSync &t) {
+    if (len < TIME_SYNC_SIZE || !isControlMessage(p, len) || controlMessageType(p) != type) {
+        return false;
+    }
+    t.client_send_us = getU64(p + 3);
+    t.server_recv_us = getU64(p + 11);
+    t.server_send_us = getU64(p + 19);
+    return true;
+}
+
+enum RecordAction : uint8_t {
+    RECORD_STOP = 0,
+    RECORD_START = 1,
+    RECORD_TOGGLE = 2,
+    RECORD_QUERY = 3, // Solo stato, nessuna modifica
+};
+
+constexpr size_t RECORD_CONTROL_SIZE = CONTROL_HEADER_SIZE + 1;
+
+inline size_t writeRecordControl(uint8_t *p, RecordAction action) {
+    putU16(p, CONTROL_MAGIC);
+    p[2] = MSG_RECORD_CONTROL;
+    p[3] = action;
+    return RECORD_CONTROL_SIZE;
+}
+
+inline bool parseRecordControl(const uint8_t *p, size_t len, RecordAction &action) {
+    if (len < RECORD_CONTROL_SIZE || !isControlMessage(p, len) || controlMessageType(p) != MSG_RECORD_CONTROL ||
+        p[3] > RECORD_QUERY) {
+        return false;
+    }
+    action = static_cast<RecordAction>(p[3]);
+    return true;
+}
+
+struct RecordStatus {
+    uint8_t active = 0;
+    uint32_t segments = 0;
+    uint32_t frames_written = 0;
+    uint32_t frames_dropped = 0;
+};
+
+constexpr size_t RECORD_STATUS_SIZE = CONTROL_HEADER_SIZE + 13;
+
+inline size_t writeRecordStatus(uint8_t *p, const RecordStatus &s) {
+    putU16(p, CONTROL_MAGIC);
+    p[2] = MSG_RECORD_STATUS;
+    p[3] = s.active;
+    putU32(p + 4, s.segments);
+    putU32(p + 8, s.frames_written);
+    putU32(p + 12, s.frames_dropped);
+    return RECORD_STATUS_SIZE;
+}
+
+inline bool parseRecordStatus(const uint8_t *p, size_t len, RecordStatus &s) {
+    if (len < RECORD_STATUS_SIZE || !isControlMessage(p, len) || controlMessageType(p) != MSG_RECORD_STATUS) {
+        return false;
+    }
+    s.active = p[3];
+    s.segments = getU32(p + 4);
+    s.frames_written = getU32(p + 8);
+    s.frames_dropped = getU32(p + 12);
+    return true;
+}
+
+constexpr uint8_t TELEMETRY_FLAG_REVERSE = 1;
+constexpr uint8_t TELEMETRY_FLAG_IMU = 2; // Accelerazioni misurate; altrimenti valgono 0
+constexpr uint8_t TELEMETRY_FLAG_LOW_POWER = 4; // Batteria scarica o sottotensione: gas e video limitati
+
+// Stato dell'auto inviato dal Pi a 50 Hz
+struct Telemetry {
+    uint32_t seq = 0;
+    uint16_t steering_us = 1500; // Impulsi PWM applicati
+    uint16_t throttle_us = 1500;
+    int16_t speed_cm_s = 0;      // Velocità (stimata dal comando motore senza sensori)
+    int16_t accel_x_mg = 0;      // Longitudinale, positivo in avanti
+    int16_t accel_y_mg = 0;      // Laterale, positivo verso destra
+    uint16_t impact_mg = 0;      // Picco di accelerazione dall'ultimo invio
+    uint8_t flags = 0;
+};
+
+constexpr size_t TELEMETRY_SIZE = CONTROL_HEADER_SIZE + 17;
+
+inline size_t writeTelemetry(uint8_t *p, const Telemetry &t) {
+    putU16(p, CONTROL_MAGIC);
+    p[2] = MSG_TELEMETRY;
+    putU32(p + 3, t.seq);
+    putU16(p + 7, t.steering_us);
+    putU16(p + 9, t.throttle_us);
+    putU16(p + 11, static_cast<uint16_t>(t.speed_cm_s));
+    putU16(p + 13, static_cast<uint16_t>(t.accel_x_mg));
+    putU16(p + 15, static_cast<uint16_t>(t.accel_y_mg));
+    putU16(p + 17, t.impact_mg);
+    p[19] = t.flags;
+    return TELEMETRY_SIZE;
+}
+
+inline bool parseTelemetry(const uint8_t *p, size_t len, Telemetry &t) {
+    if (len < TELEMETRY_SIZE || !isControlMessage(p, len) || controlMessageType(p) != MSG_TELEMETRY) {
+        return false;
+    }
+    t.seq = getU32(p + 3);
+    t.steering_us = getU16(p + 7);
+    t.throttle_us = getU16(p + 9);
+    t.speed_cm_s = static_cast<int16_t>(getU16(p + 11));
+    t.accel_x_mg = static_cast<int16_t>(getU16(p + 13));
+    t.accel_y_mg = static_cast<int16_t>(getU16(p + 15));
+    t.impact_mg = getU16(p + 17);
+    t.flags = p[19];
+    return true;
+}
+
+// --- Sessione: un solo client alla volta guida l'auto e riceve il video ---
+
+constexpr uint16_t SESSION_LEASE_MS = 500; // Senza comandi validi per questo tempo l'auto va in folle
+
+enum SessionStatus : uint8_t {
+    SESSION_GRANTED = 0, // Lease assegnato o rinnovato
+    SESSION_BUSY = 1,    // Un altro client ha un lease valido
+    SESSION_INVALID = 2, // Token scaduto o sconosciuto: serve un nuovo hello
+    SESSION_CHALLENGE = 3, // Con l'autenticazione: ripetere l'hello con la sfida nel campo token
+};
+
+// La sfida del Pi, firmata dal client nell'hello successivo, lega l'hello all'indirizzo del client
+// e a un intervallo di pochi secondi: un hello catturato e ripetuto non ottiene il lease.
+constexpr size_t HELLO_SIZE = CONTROL_HEADER_SIZE + 8;
+constexpr size_t HELLO_V1_SIZE = CONTROL_HEADER_SIZE + 4; // Senza sfida: client precedenti
+
+inline size_t writeHello(uint8_t *p, uint32_t nonce, uint32_t challenge) {
+    putU16(p, CONTROL_MAGIC);
+    p[2] = MSG_HELLO;
+    putU32(p + 3, nonce);
+    putU32(p + 7, challenge);
+    return HELLO_SIZE;
+}
+
+inline bool parseHello(const uint8_t *p, size_t len, uint32_t &nonce, uint32_t &challenge) {
+    if (len < HELLO_V1_SIZE || !isControlMessage(p, len) || controlMessageType(p) != MSG_HELLO) {
+        return false;
+    }
+    nonce = getU32(p + 3);
+    challenge = len >= HELLO_SIZE ? getU32(p + 7) : 0;
+    return true;
+}
+
+struct SessionAccept {
+    uint8_t status = SESSION_INVALID;
+    uint32_t nonce = 0; // Copiato dall'hello a cui risponde (0 se risponde a un comando)
+    uint32_t token = 0; // Con SESSION_CHALLENGE: la sfida da copiare nel prossimo hello
+    uint16_t lease_ms = SESSION_LEASE_MS;
+    uint16_t period_ms = 0; // Periodo dei comandi chiesto dal Pi, 0 se non indicato
+};
+
+constexpr size_t ACCEPT_SIZE = CONTROL_HEADER_SIZE + 13;
+constexpr size_t ACCEPT_V1_SIZE = CONTROL_HEADER_SIZE + 11; // Senza periodo: server precedenti
+
+inline size_t writeAccept(uint8_t *p, const SessionAccept &a) {
+    putU16(p, CONTROL_MAGIC);
+    p[2] = MSG_ACCEPT;
+    p[3] = a.status;
+    putU32(p + 4, a.nonce);
+    putU32(p + 8, a.token);
+    putU16(p + 12, a.lease_ms);
+    putU16(p + 14, a.period_ms);
+    return ACCEPT_SIZE;
+}
+
+inline bool parseAccept(const uint8_t *p, size_t len, SessionAccept &a) {
+    if (len < ACCEPT_V1_SIZE || !isControlMessage(p, len) || controlMessageType(p) != MSG_ACCEPT) {
+        return false;
+    }
+    a.status = p[3];
+    a.nonce = getU32(p + 4);
+    a.token = getU32(p + 8);
+    a.lease_ms = getU16(p + 12);
+    a.period_ms = len >= ACCEPT_SIZE ? getU16(p + 14) : 0;
+    return true;
+}
+
+// Comandi del volante (stessi valori del vecchio formato testuale "sterzo acceleratore freno paddle")
+struct ControlState {
+    uint16_t steering = 1000;
+    uint16_t accelerator = 0;
+    uint16_t brake = 0;
+    int8_t paddle = 0;
+};
+
+// Fino a CONTROL_HISTORY_MAX stati precedenti in coda al comando, il più recente per primo
+// (seq - 1, seq - 2, ...): chi ha perso un datagramma li ricostruisce dal successivo.
+constexpr size_t CONTROL_HISTORY_MAX = 4;
+constexpr size_t CONTROL_STATE_SIZE = 7;
+
+struct ControlFrame {
+    uint32_t token = 0;
+    uint32_t seq = 0;
+    uint16_t steering = 1000;
+    uint16_t accelerator = 0;
+    uint16_t brake = 0;
+    int8_t paddle = 0;
+    uint8_t history_count = 0;
+    ControlState history[CONTROL_HISTORY_MAX];
+};
+
+constexpr size_t CONTROL_FRAME_SIZE = CONTROL_HEADER_SIZE + 15; // Senza storia: formato dei server precedenti
+constexpr size_t CONTROL_FRAME_MAX_SIZE = CONTROL_FRAME_SIZE + 1 + CONTROL_HISTORY_MAX * CONTROL_STATE_SIZE;
+
+inline void putControlState(uint8_t *p, const ControlState &s) {
+    putU16(p, s.steering);
+    putU16(p + 2, s.accelerator);
+    putU16(p + 4, s.brake);
+    p[6] = static_cast<uint8_t>(s.paddle);
+}
+
+inline ControlState getControlState(const uint8_t *p) {
+    ControlState s;
+    s.steering = getU16(p);
+    s.accelerator = getU16(p + 2);
+    s.brake = getU16(p + 4);
+    s.paddle = static_cast<int8_t>(p[6]);
+    return s;
+}
+
+// Ritorna la lunghezza effettiva: CONTROL_FRAME_SIZE senza storia
+inline size_t writeControlFrame(uint8_t *p, const ControlFrame &c) {
+    putU16(p, CONTROL_MAGIC);
+    p[2] = MSG_CONTROL;
+    putU32(p + 3, c.token);
+    putU32(p + 7, c.seq);
+    putU16(p + 11, c.steering);
+    putU16(p + 13, c.accelerator);
+    putU16(p + 15, c.brake);
+    p[17] = static_cast<uint8_t>(c.paddle);
+    const size_t count = c.history_count < CONTROL_HISTORY_MAX ? c.history_count : CONTROL_HISTORY_MAX;
+    if (count == 0) {
+        return CONTROL_FRAME_SIZE;
+    }
+    p[CONTROL_FRAME_SIZE] = static_cast<uint8_t>(count);
+    for (size_t i = 0; i < count; ++i) {
+        putControlState(p + CONTROL_FRAME_SIZE + 1 + i * CONTROL_STATE_SIZE, c.history[i]);
+    }
+    return CONTROL_FRAME_SIZE + 1 + count * CONTROL_STATE_SIZE;
+}
+
+inline bool parseControlFrame(const uint8_t *p, size_t len, ControlFrame &c) {
+    if (len < CONTROL_FRAME_SIZE || !isControlMessage(p, len) || controlMessageType(p) != MSG_CONTROL) {
+        return false;
+    }
+    c.token = getU32(p + 3);
+    c.seq = getU32(p + 7);
+    c.steering = getU16(p + 11);
+    c.accelerator = getU16(p + 13);
+    c.brake = getU16(p + 15);
+    c.paddle = static_cast<int8_t>(p[17]);
+    c.history_count = 0;
+    if (len > CONTROL_FRAME_SIZE) {
+        const size_t count = p[CONTROL_FRAME_SIZE];
+        if (count > CONTROL_HISTORY_MAX || len < CONTROL_FRAME_SIZE + 1 + count * CONTROL_STATE_SIZE) {
+            return false;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            c.history[i] = getControlState(p + CONTROL_FRAME_SIZE + 1 + i * CONTROL_STATE_SIZE);
+        }
+        c.history_count = static_cast<uint8_t>(count);
+    }
+    return true;
+}
+
+constexpr size_t BYE_SIZE = CONTROL_HEADER_SIZE + 4;
+
+inline size_t writeBye(uint8_t *p, uint32_t token) {
+    putU16(p, CONTROL_MAGIC);
+    p[2] = MSG_BYE;
+    putU32(p + 3, token);
+    return BYE_SIZE;
+}
+
+inline bool parseBye(const uint8_t *p, size_t len, uint32_t &token) {
+    if (len < BYE_SIZE || !isControlMessage(p, len) || controlMessageType(p) != MSG_BYE) {
+        return false;
+    }
+    token = getU32(p + 3);
+    return true;
+}
+
+#endif // RRC_PROTO_HPP
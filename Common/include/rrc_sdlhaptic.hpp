@@ -0,0 +1,27 @@
+#ifndef RRC_SDLHAPTIC_HPP
+#define RRC_SDLHAPTIC_HPP
+
+#include "rrc_haptic.hpp"
+#include <SDL2/SDL.h>
+
+// Force feedback del G29 tramite SDL_haptic: un effetto molla per il centraggio e un effetto a
+// coppia costante, entrambi infiniti e aggiornati solo quando il valore cambia davvero.
+class SdlHaptic : public HapticDevice {
+public:
+    ~SdlHaptic() override { close(); }
+
+    bool open(SDL_Joystick *joystick);
+    void close();
+
+    void setSpring(double stiffness) override;
+    void setForce(double force) override;
+
+private:
+    SDL_Haptic *haptic_ = nullptr;
+    int spring_id_ = -1;
+    int constant_id_ = -1;
+    SDL_HapticEffect spring_{};
+    SDL_HapticEffect constant_{};
+};
+
+#endif // RRC_SDLHAPTIC_HPP
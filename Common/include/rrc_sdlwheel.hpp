@@ -0,0 +1,24 @@
+#ifndef RRC_SDLWHEEL_HPP
+#define RRC_SDLWHEEL_HPP
+
+#include "rrc_client.hpp"
+#include <SDL2/SDL.h>
+
+// Logitech G29 letto con SDL_joystick: sterzo e pedali sugli assi 0-2, paddle sui pulsanti 4 e 5
+class SdlWheel : public WheelSource {
+public:
+    static constexpr int AXIS_STEERING = 0;
+    static constexpr int AXIS_ACCELERATOR = 1;
+    static constexpr int AXIS_BRAKE = 2;
+    static constexpr int BUTTON_REVERSE = 4;
+    static constexpr int BUTTON_DRIVE = 5;
+
+    explicit SdlWheel(SDL_Joystick *joystick) : joystick_(joystick) {}
+
+    WheelState sample() override;
+
+private:
+    SDL_Joystick *joystick_;
+};
+
+#endif // RRC_SDLWHEEL_HPP
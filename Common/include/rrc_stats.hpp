@@ -0,0 +1,40 @@
+#ifndef RRC_STATS_HPP
+#define RRC_STATS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Istogramma log-lineare per latenze (in µs salvo diversa indicazione): 16 sotto-intervalli per
+// ogni potenza di due (errore relativo < 7%), memoria fissa e nessuna allocazione in record().
+class LatencyHistogram {
+public:
+    void record(int64_t value_us);
+    void reset();
+
+    uint64_t count() const { return count_; }
+    uint64_t negatives() const { return negatives_; } // Campioni < 0 (es. offset di orologio errato)
+    int64_t min() const { return count_ ? min_ : 0; }
+    int64_t max() const { return count_ ? max_ : 0; }
+    double mean() const { return count_ ? static_cast<double>(sum_) / count_ : 0.0; }
+    int64_t percentile(double p) const;
+
+    // "n=120 p50=850 p95=1200 p99=1900 max=2300 us"
+    std::string summary(const char *unit = "us") const;
+
+private:
+    static constexpr int SUB_BITS = 4;
+    static constexpr size_t BUCKETS = (64 - SUB_BITS + 1) << SUB_BITS;
+
+    static size_t bucketOf(uint64_t value);
+    static uint64_t bucketLow(size_t bucket);
+
+    uint32_t buckets_[BUCKETS] = {};
+    uint64_t count_ = 0;
+    uint64_t negatives_ = 0;
+    int64_t sum_ = 0;
+    int64_t min_ = 0;
+    int64_t max_ = 0;
+};
+
+#endif // RRC_STATS_HPP
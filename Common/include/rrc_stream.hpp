@@ -0,0 +1,99 @@
+#ifndef RRC_STREAM_HPP
+#define RRC_STREAM_HPP
+
+#include "rrc_fec.hpp"
+#include "rrc_proto.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Divide i frame H.264 in datagrammi video e aggiunge la parità FEC.
+// I buffer vengono riutilizzati tra un frame e l'altro: nessuna allocazione a regime.
+class VideoPacketizer {
+public:
+    // Prepara i datagrammi del frame: prima i dati, poi la parità di riga e di colonna.
+    // send_us e capture_us sono sull'orologio monotono del mittente: il primo serve al client per
+    // stimare la coda, il secondo per misurare la latenza dall'encoder alla decodifica.
+    void packetize(const uint8_t *frame, size_t len, bool keyframe, const FecParams &fec,
+                   uint32_t send_us, uint64_t capture_us);
+
+    size_t count() const { return sizes_.size(); }
+    const uint8_t *datagram(size_t i) const { return buffer_.data() + i * VIDEO_MAX_DATAGRAM; }
+    size_t datagramSize(size_t i) const { return sizes_[i]; }
+    uint32_t lastFrameId() const { return next_frame_id_ - 1; }
+
+private:
+    uint8_t *slot(size_t i) { return buffer_.data() + i * VIDEO_MAX_DATAGRAM; }
+
+    uint32_t next_frame_id_ = 0;
+    uint32_t next_seq_ = 0;
+    std::vector<uint8_t> buffer_; // Slot contigui da VIDEO_MAX_DATAGRAM byte
+    std::vector<uint16_t> sizes_;
+};
+
+// Distanza oltre la quale un frame_id più basso indica il riavvio dello streaming sul Pi
+constexpr uint32_t FRAME_RESTART_GAP = 256;
+
+struct VideoFrame {
+    uint32_t frame_id = 0;
+    bool keyframe = false;
+    uint64_t capture_us = 0; // Orologio del Pi, vedi VideoPacketizer::packetize
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+};
+
+struct VideoReceiveStats {
+    uint64_t packets = 0;
+    uint64_t parity_packets = 0;
+    uint64_t recovered = 0;       // Pacchetti ricostruiti dalla FEC
+    uint64_t frames_complete = 0;
+    uint64_t frames_dropped = 0;  // Frame incompleti superati da un frame più recente
+    uint64_t late_packets = 0;    // Pacchetti di frame già consegnati o scartati
+};
+
+// Riassembla i frame dai datagrammi video e ricostruisce i pacchetti persi prima della decodifica.
+// Un frame viene consegnato appena completo; quelli più vecchi ancora incompleti vengono scartati.
+class VideoDepacketizer {
+public:
+    // Ritorna true se il datagramma completa un frame, disponibile in frame() fino alla prossima push().
+    bool push(const uint8_t *datagram, size_t len);
+
+    const VideoFrame &frame() const { return frame_; }
+    const VideoReceiveStats &stats() const { return stats_; }
+    void reset();
+
+private:
+    static constexpr size_t SLOT_COUNT = 8;
+
+    struct Slot {
+        bool used = false;
+        uint32_t frame_id = 0;
+        uint16_t data_count = 0;
+        FecParams fec;
+        bool keyframe = false;
+        uint64_t capture_us = 0;
+        size_t received = 0;
+        size_t row_count = 0;
+        std::vector<uint8_t> data;      // data_count slot da VIDEO_MAX_PAYLOAD
+        std::vector<uint16_t> lengths;
+        std::vector<uint8_t> have;
+        std::vector<uint8_t> parity;    // Prima le righe, poi le colonne
+        std::vector<uint16_t> parity_len_xor;
+        std::vector<uint16_t> parity_size;
+        std::vector<uint8_t> have_parity;
+    };
+
+    Slot *findSlot(const VideoPacketHeader &header);
+    void recover(Slot &slot);
+    void rebuild(Slot &slot, size_t parity_index, size_t missing, const FecSpan &span);
+    void complete(Slot &slot);
+
+    Slot slots_[SLOT_COUNT];
+    bool have_emitted_ = false;
+    uint32_t last_emitted_ = 0;
+    std::vector<uint8_t> frame_buf_;
+    VideoFrame frame_;
+    VideoReceiveStats stats_;
+};
+
+#endif // RRC_STREAM_HPP
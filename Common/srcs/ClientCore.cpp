@@ -0,0 +1,280 @@
+#include "../include/rrc_client.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+constexpr double RAW_AXIS_FULL_RANGE = 65535.0;
+constexpr double RAW_AXIS_HALF_RANGE = 32768.0;
+
+int normalizeAxis(int raw) {
+    const double scaled = (static_cast<double>(raw) + RAW_AXIS_HALF_RANGE) * AXIS_MAX_VALUE / RAW_AXIS_FULL_RANGE;
+    const int value = static_cast<int>(std::lround(scaled));
+    return std::clamp(value, 0, AXIS_MAX_VALUE);
+}
+
+WheelState wheelFromRaw(int steering, int accelerator, int brake, bool reverse_paddle, bool drive_paddle) {
+    WheelState state;
+    state.steering = normalizeAxis(steering);
+    state.accelerator = AXIS_MAX_VALUE - normalizeAxis(accelerator);
+    state.brake = AXIS_MAX_VALUE - normalizeAxis(brake);
+    state.paddle = reverse_paddle ? -1 : (drive_paddle ? 1 : 0);
+    return state;
+}
+
+ControlSession::ControlSession(NetSocket sock, ControlAuth &auth)
+    : sock_(sock), auth_(auth), nonces_(std::random_device{}()) {}
+
+void ControlSession::sealAndSend(uint8_t *message, size_t len) {
+    if (netSend(sock_, message, auth_.seal(message, len)) < 0) {
+        send_errors_++;
+    }
+}
+
+bool RedundancyOptions::parse(const std::string &spec, std::string &error) {
+    RedundancyOptions options;
+    std::stringstream entries(spec);
+    std::string entry;
+    while (std::getline(entries, entry, ',')) {
+        const size_t equal = entry.find('=');
+        const std::string key = entry.substr(0, equal);
+        char *end = nullptr;
+        const long value = equal == std::string::npos ? -1 : std::strtol(entry.c_str() + equal + 1, &end, 10);
+        if (entry.empty()) {
+            continue;
+        } else if (value < 0 || *end != '\0') {
+            error = "valore non valido in '" + entry + "'";
+            return false;
+        } else if (key == "history" && value <= static_cast<long>(CONTROL_HISTORY_MAX)) {
+            options.history = static_cast<int>(value);
+        } else if (key == "duplicate_us") {
+            options.duplicate_us = static_cast<uint64_t>(value);
+        } else {
+            error = "opzione non valida '" + entry + "' (history=0.." + std::to_string(CONTROL_HISTORY_MAX) +
+                    ", duplicate_us=N)";
+            return false;
+        }
+    }
+    *this = options;
+    return true;
+}
+
+bool RedundancyOptions::loadFromEnv() {
+    const char *spec = std::getenv("RRC_REDUNDANCY");
+    if (!spec || !*spec) {
+        return false;
+    }
+    std::string error;
+    if (!parse(spec, error)) {
+        std::cerr << "RRC_REDUNDANCY ignorata: " << error << std::endl;
+        return false;
+    }
+    return enabled();
+}
+
+bool ControlSession::sendInput(const WheelState &state, uint64_t now_us) {
+    // Senza lease si chiede l'accesso; con il lease ogni comando porta token e sequenza
+    const uint32_t token = token_.load();
+    if (token == 0) {
+        // Una sfida nuova del Pi si restituisce subito, senza aspettare il prossimo hello periodico
+        const uint32_t challenge = challenge_.load();
+        if (last_hello_us_ == 0 || now_us - last_hello_us_ >= HELLO_INTERVAL_US || challenge != hello_challenge_) {
+            nonce_.store(nonces_() | 1);
+            hello_challenge_ = challenge;
+            uint8_t hello[HELLO_SIZE + AUTH_TRAILER_SIZE];
+            writeHello(hello, nonce_.load(), challenge);
+            sealAndSend(hello, HELLO_SIZE);
+            hellos_++;
+            last_hello_us_ = now_us;
+        }
+        history_size_ = 0;
+        return false;
+    }
+
+    ControlFrame &control = last_frame_;
+    control.token = token;
+    control.seq = ++seq_;
+    control.steering = static_cast<uint16_t>(std::clamp(state.steering, 0, AXIS_MAX_VALUE));
+    control.accelerator = static_cast<uint16_t>(std::clamp(state.accelerator, 0, AXIS_MAX_VALUE));
+    control.brake = static_cast<uint16_t>(std::clamp(state.brake, 0, AXIS_MAX_VALUE));
+    control.paddle = static_cast<int8_t>(state.paddle);
+    control.history_count = static_cast<uint8_t>(std::min<size_t>(history_size_, redundancy_.history));
+    std::copy(history_, history_ + control.history_count, control.history);
+
+    uint8_t frame[CONTROL_FRAME_MAX_SIZE + AUTH_TRAILER_SIZE];
+    sealAndSend(frame, writeControlFrame(frame, control));
+    controls_++;
+    if (echo_ && now_us - last_echo_us_ >= ECHO_INTERVAL_US) {
+        std::cout << control.steering << " " << control.accelerator << " " << control.brake << " "
+                  << static_cast<int>(control.paddle) << "\n";
+        last_echo_us_ = now_us;
+    }
+
+    // Lo stato appena inviato diventa il primo della storia del prossimo comando
+    std::copy_backward(history_, history_ + CONTROL_HISTORY_MAX - 1, history_ + CONTROL_HISTORY_MAX);
+    history_[0] = ControlState{control.steering, control.accelerator, control.brake, control.paddle};
+    history_size_ = std::min(history_size_ + 1, CONTROL_HISTORY_MAX);
+    return true;
+}
+
+void ControlSession::sendDuplicate() {
+    if (last_frame_.token == 0 || last_frame_.token != token_.load()) {
+        return; // Lease perso nel frattempo
+    }
+    uint8_t frame[CONTROL_FRAME_MAX_SIZE + AUTH_TRAILER_SIZE];
+    sealAndSend(frame, writeControlFrame(frame, last_frame_));
+    duplicates_++;
+}
+
+// Scadenze fisse invece di una pausa dopo ogni invio: il tempo speso a leggere il volante e a
+// inviare non allunga il periodo. Dopo un ritardo di oltre un periodo si riparte da adesso
+// invece di recuperare con una raffica di comandi vecchi.
+void ControlSession::runSender(WheelSource &wheel, const std::atomic<bool> &running) {
+    PacingTimer timer(spin_us_);
+    uint64_t deadline_us = monotonicMicros();
+    uint64_t last_send_us = 0;
+    uint64_t last_period_us = 0;
+    while (running) {
+        const uint64_t now_us = monotonicMicros();
+        const uint64_t late_us = now_us > deadline_us ? now_us - deadline_us : 0;
+        if (late_us > max_late_us_.load()) {
+            max_late_us_.store(late_us);
+        }
+
+        if (last_sync_us_ == 0 || now_us - last_sync_us_ >= TIME_SYNC_INTERVAL_US) {
+            sendTimeRequest(now_us);
+            last_sync_us_ = now_us;
+        }
+        WheelState state = wheel.sample();
+        if (filter_) {
+            state = filter_->apply(state, now_us, one_way_us_.load());
+        }
+        const bool sent = sendInput(state, now_us);
+
+        const uint64_t period_us = static_cast<uint64_t>(period_ms_.load()) * 1000;
+        if (sent && redundancy_.duplicate_us > 0) {
+            // La copia parte dopo il primo invio ma ben prima del comando successivo
+            timer.sleepUntil(now_us + std::min(redundancy_.duplicate_us, period_us / 2));
+            sendDuplicate();
+        }
+        if (last_send_us != 0 && period_us == last_period_us) {
+            const int64_t interval_us = static_cast<int64_t>(now_us - last_send_us);
+            std::lock_guard<std::mutex> lock(interval_mutex_);
+            interval_error_us_.record(std::abs(interval_us - static_cast<int64_t>(period_us)));
+        }
+        last_send_us = now_us;
+        last_period_us = period_us;
+
+        deadline_us += period_us;
+        if (now_us >= deadline_us) {
+            overruns_++;
+            deadline_us = now_us + period_us;
+        }
+        timer.sleepUntil(deadline_us);
+    }
+}
+
+void ControlSession::sendTimeRequest(uint64_t now_us) {
+    TimeSync sync;
+    sync.client_send_us = now_us;
+    uint8_t request[TIME_SYNC_SIZE + AUTH_TRAILER_SIZE];
+    writeTimeSync(request, MSG_TIME_REQUEST, sync);
+    sealAndSend(request, TIME_SYNC_SIZE);
+}
+
+void ControlSession::sendRecordToggle() {
+    uint8_t request[RECORD_CONTROL_SIZE + AUTH_TRAILER_SIZE];
+    writeRecordControl(request, RECORD_TOGGLE);
+    sealAndSend(request, RECORD_CONTROL_SIZE);
+}
+
+void ControlSession::sendReceiverReport(const ReceiverReport &report) {
+    uint8_t message[RECEIVER_REPORT_SIZE + AUTH_TRAILER_SIZE];
+    writeReceiverReport(message, report);
+    sealAndSend(message, RECEIVER_REPORT_SIZE);
+}
+
+void ControlSession::sendBye() {
+    const uint32_t token = token_.exchange(0);
+    if (token != 0) {
+        uint8_t bye[BYE_SIZE + AUTH_TRAILER_SIZE];
+        writeBye(bye, token);
+        sealAndSend(bye, BYE_SIZE);
+    }
+}
+
+// Esito di hello e comandi: con GRANTED il thread dei comandi inizia a guidare,
+// con INVALID (lease scaduto) torna a mandare hello, con CHALLENGE li manda con la sfida
+void ControlSession::handleAccept(const SessionAccept &accept) {
+    // Il Pi indica il periodo dei comandi con ogni ACCEPT, anche fuori dall'hello se la sua configurazione cambia
+    if (accept.status == SESSION_GRANTED && accept.period_ms != 0 &&
+        (accept.nonce == nonce_.load() || accept.token == token_.load())) {
+        if (period_ms_.exchange(accept.period_ms) != accept.period_ms) {
+            std::cout << "Periodo dei comandi: " << accept.period_ms << " ms" << std::endl;
+        }
+    }
+    if (accept.status == SESSION_GRANTED && accept.nonce == nonce_.load()) {
+        if (token_.exchange(accept.token) != accept.token) {
+            std::cout << "Lease di guida ottenuto (" << accept.lease_ms << " ms)." << std::endl;
+        }
+        busy_reported_ = false;
+    } else if (accept.status == SESSION_BUSY) {
+        token_.store(0);
+        if (!busy_reported_) {
+            std::cout << "Il Raspberry Pi è già guidato da un altro client, in attesa..." << std::endl;
+            busy_reported_ = true;
+        }
+    } else if (accept.status == SESSION_INVALID) {
+        token_.store(0);
+    } else if (accept.status == SESSION_CHALLENGE && accept.nonce == nonce_.load()) {
+        challenge_.store(accept.token);
+    }
+}
+
+void ControlSession::onReply(const uint8_t *data, size_t len, ForceFeedback *feedback, uint64_t now_us) {
+    RecordStatus status;
+    Telemetry telemetry;
+    SessionAccept accept;
+    TimeSync sync;
+    uint32_t counter;
+    if (!auth_.open(data, len, len, counter)) {
+        return; // Non firmato con la nostra chiave: ignorato
+    }
+    if (parseAccept(data, len, accept)) {
+        handleAccept(accept);
+    } else if (parseTimeSync(data, len, MSG_TIME_REPLY, sync)) {
+        clock_.onReply(sync, now_us);
+        one_way_us_.store(clock_.rttUs() / 2);
+    } else if (parseTelemetry(data, len, telemetry)) {
+        const bool low_power = (telemetry.flags & TELEMETRY_FLAG_LOW_POWER) != 0;
+        if (low_power != low_power_) {
+            low_power_ = low_power;
+            if (low_power) {
+                std::cerr << "Attenzione: batteria dell'auto scarica, gas e video limitati. Rientrare." << std::endl;
+            } else {
+                std::cout << "Alimentazione dell'auto tornata normale." << std::endl;
+            }
+        }
+        if (feedback) {
+            feedback->onTelemetry(telemetry, now_us);
+        }
+    } else if (parseRecordStatus(data, len, status)) {
+        std::cout << "Registrazione " << (status.active ? "attiva" : "ferma") << ": file " << status.segments
+                  << ", frame scritti " << status.frames_written << ", persi " << status.frames_dropped << std::endl;
+    }
+}
+
+SenderStats ControlSession::stats() const {
+    SenderStats stats;
+    stats.controls = controls_.load();
+    stats.hellos = hellos_.load();
+    stats.send_errors = send_errors_.load();
+    stats.overruns = overruns_.load();
+    stats.max_late_us = max_late_us_.load();
+    stats.duplicates = duplicates_.load();
+    stats.one_way_us = one_way_us_.load();
+    std::lock_guard<std::mutex> lock(interval_mutex_);
+    stats.interval_error_us = interval_error_us_;
+    return stats;
+}
@@ -0,0 +1,126 @@
+#include "../include/rrc_client.hpp"
+#include "../include/rrc_jitter.hpp"
+#include "../include/rrc_link.hpp"
+#include "../include/rrc_stream.hpp"
+#include <algorithm>
+#include <iostream>
+
+constexpr uint64_t VIDEO_WAIT_MAX_US = 200000; // Al più 200 ms senza controllare running
+constexpr uint64_t STATS_INTERVAL_US = 5000000;
+constexpr int VIDEO_RCVBUF = 1 << 20;          // Buffer ampio per assorbire le raffiche di un keyframe
+
+static void logStats(const VideoDepacketizer &depacketizer, const JitterBuffer &jitter, const ControlSession &session,
+                     ForceFeedback *feedback) {
+    const VideoReceiveStats &stats = depacketizer.stats();
+    std::cout << "Video: frame " << stats.frames_complete << ", persi " << stats.frames_dropped
+              << ", pacchetti recuperati " << stats.recovered << std::endl;
+    const JitterBufferStats &buffer = jitter.stats();
+    std::cout << "Jitter buffer: ritardo " << jitter.delayUs() / 1000 << " ms (obiettivo "
+              << jitter.targetUs() / 1000 << " ms), profondità " << jitter.depth() << " frame, in ritardo "
+              << buffer.late_frames << ", scartati " << buffer.dropped_late + buffer.dropped_skip + buffer.dropped_overflow
+              << ", accelerati " << buffer.catchup_frames << ", riavvii " << buffer.restarts << std::endl;
+    const SenderStats sender = session.stats();
+    std::cout << "Comandi: " << sender.controls << " inviati ogni " << session.periodMs() << " ms, ritardo max "
+              << sender.max_late_us << " us, periodi saltati " << sender.overruns << ", errori di invio "
+              << sender.send_errors << ", copie ridondanti " << sender.duplicates << ", latenza one-way "
+              << sender.one_way_us << " us" << std::endl;
+    std::cout << "Scarto dal periodo: " << sender.interval_error_us.summary() << std::endl;
+    if (feedback) {
+        const ForceFeedbackStats haptic = feedback->stats();
+        std::cout << "Force feedback: " << haptic.updates << " aggiornamenti, ritardo max "
+                  << haptic.max_late_us << " us, tick saltati " << haptic.overruns << ", telemetria "
+                  << haptic.telemetry << std::endl;
+    }
+}
+
+// Riceve il flusso video dal Raspberry Pi, ricostruisce i pacchetti persi con la FEC
+// e passa i frame completi a ffplay tramite stdin, attraverso il jitter buffer che ne regola la cadenza.
+// Sul socket dei comandi invia periodicamente al Pi le statistiche del collegamento, usate per
+// adattare il bitrate, e ne riceve la telemetria.
+void streamVideo(const std::string &raspberry_ip, ControlSession &session, ForceFeedback *feedback,
+                 const std::atomic<bool> &running) {
+    NetSocket video_sock = openUdpSocket();
+    if (video_sock == INVALID_NET_SOCKET) {
+        std::cerr << "Errore nella creazione del socket video." << std::endl;
+        return;
+    }
+    setReceiveBuffer(video_sock, VIDEO_RCVBUF);
+
+    if (!bindUdp(video_sock, VIDEO_PORT)) {
+        std::cerr << "Impossibile ricevere il video sulla porta " << VIDEO_PORT << ": " << netLastError() << std::endl;
+        closeSocket(video_sock);
+        return;
+    }
+
+    uint32_t raspberry_addr = 0;
+    parseIpv4(raspberry_ip, raspberry_addr);
+
+    FILE *player = openPlayerPipe("ffplay -fflags nobuffer -flags low_delay -framedrop -probesize 32 -f h264 -i pipe:0");
+    if (!player) {
+        std::cerr << "Errore nell'esecuzione del comando ffplay." << std::endl;
+        closeSocket(video_sock);
+        return;
+    }
+
+    VideoDepacketizer depacketizer;
+    LinkMonitor monitor;
+    JitterBuffer jitter;
+    uint8_t datagram[2048];
+    uint64_t last_log_us = monotonicMicros();
+    bool player_ok = true;
+
+    while (running && player_ok) {
+        // Attende un datagramma o l'istante del prossimo frame
+        const uint64_t before_us = monotonicMicros();
+        const uint64_t playout_us = jitter.nextPlayoutUs();
+        uint64_t wait_us = VIDEO_WAIT_MAX_US;
+        if (playout_us != UINT64_MAX) {
+            wait_us = playout_us > before_us ? std::min(playout_us - before_us, VIDEO_WAIT_MAX_US) : 0;
+        }
+        bool readable = false;
+        bool reply_ready = false;
+        waitReadable(video_sock, session.socket(), wait_us, readable, reply_ready);
+
+        if (reply_ready) {
+            const int reply = netRecv(session.socket(), datagram, sizeof(datagram));
+            if (reply > 0) {
+                session.onReply(datagram, reply, feedback, monotonicMicros());
+            }
+        }
+
+        uint32_t from_addr = 0;
+        const int n = readable ? netRecvFrom(video_sock, datagram, sizeof(datagram), from_addr) : -1;
+        const uint64_t now_us = monotonicMicros();
+
+        if (n > 0 && from_addr == raspberry_addr) {
+            VideoPacketHeader header;
+            if (parseVideoHeader(datagram, n, header)) {
+                monitor.onPacket(header.seq, header.send_us, now_us, n);
+            }
+            if (depacketizer.push(datagram, n)) {
+                jitter.push(depacketizer.frame(), now_us);
+            }
+        }
+
+        while (jitter.pop(now_us)) {
+            const VideoFrame &frame = jitter.frame();
+            if (fwrite(frame.data, 1, frame.size, player) != frame.size || fflush(player) != 0) {
+                std::cerr << "ffplay non accetta più dati, video interrotto." << std::endl;
+                player_ok = false;
+                break;
+            }
+        }
+
+        if (monitor.reportDue(now_us)) {
+            session.sendReceiverReport(monitor.makeReport(now_us, depacketizer.stats().frames_dropped));
+        }
+
+        if (now_us - last_log_us >= STATS_INTERVAL_US) {
+            logStats(depacketizer, jitter, session, feedback);
+            last_log_us = now_us;
+        }
+    }
+
+    closePlayerPipe(player);
+    closeSocket(video_sock);
+}
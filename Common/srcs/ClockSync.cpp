@@ -0,0 +1,38 @@
+#include "../include/rrc_link.hpp"
+
+void ClockSync::onReply(const TimeSync &sync, uint64_t client_recv_us) {
+    const int64_t t0 = static_cast<int64_t>(sync.client_send_us);
+    const int64_t t1 = static_cast<int64_t>(sync.server_recv_us);
+    const int64_t t2 = static_cast<int64_t>(sync.server_send_us);
+    const int64_t t3 = static_cast<int64_t>(client_recv_us);
+    const int64_t rtt = (t3 - t0) - (t2 - t1);
+    if (rtt < 0) {
+        return;
+    }
+
+    samples_[next_] = {((t1 - t0) + (t2 - t3)) / 2, static_cast<uint64_t>(rtt)};
+    next_ = (next_ + 1) % WINDOW;
+    if (count_ < WINDOW) {
+        count_++;
+    }
+}
+
+int64_t ClockSync::offsetUs() const {
+    size_t best = 0;
+    for (size_t i = 1; i < count_; ++i) {
+        if (samples_[i].rtt_us < samples_[best].rtt_us) {
+            best = i;
+        }
+    }
+    return count_ ? samples_[best].offset_us : 0;
+}
+
+uint64_t ClockSync::rttUs() const {
+    uint64_t best = count_ ? samples_[0].rtt_us : 0;
+    for (size_t i = 1; i < count_; ++i) {
+        if (samples_[i].rtt_us < best) {
+            best = samples_[i].rtt_us;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,194 @@
+#include "../include/rrc_auth.hpp"
+#include "../include/rrc_proto.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+static inline uint64_t rotl(uint64_t x, int b) {
+    return (x << b) | (x >> (64 - b));
+}
+
+static inline uint64_t loadLe64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+#define SIPROUND                                                                                   \
+    do {                                                                                           \
+        v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);                                  \
+        v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;                                                     \
+        v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;                                                     \
+        v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);                                  \
+    } while (0)
+
+uint64_t siphash24(const uint8_t key[16], const uint8_t *data, size_t len) {
+    const uint64_t k0 = loadLe64(key);
+    const uint64_t k1 = loadLe64(key + 8);
+    uint64_t v0 = 0x736f6d6570736575ULL ^ k0;
+    uint64_t v1 = 0x646f72616e646f6dULL ^ k1;
+    uint64_t v2 = 0x6c7967656e657261ULL ^ k0;
+    uint64_t v3 = 0x7465646279746573ULL ^ k1;
+
+    const uint8_t *end = data + (len & ~static_cast<size_t>(7));
+    for (; data != end; data += 8) {
+        const uint64_t m = loadLe64(data);
+        v3 ^= m;
+        SIPROUND;
+        SIPROUND;
+        v0 ^= m;
+    }
+
+    uint64_t b = static_cast<uint64_t>(len) << 56;
+    for (size_t i = 0; i < (len & 7); ++i) {
+        b |= static_cast<uint64_t>(data[i]) << (8 * i);
+    }
+    v3 ^= b;
+    SIPROUND;
+    SIPROUND;
+    v0 ^= b;
+
+    v2 ^= 0xff;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+#undef SIPROUND
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+bool ControlAuth::loadFromEnv() {
+    const char *psk = std::getenv("RRC_PSK");
+    if (!psk || !*psk) {
+        return false;
+    }
+
+    uint8_t key[16];
+    const std::string text = psk;
+    bool hex = text.size() == 32;
+    for (size_t i = 0; hex && i < 16; ++i) {
+        const int hi = hexValue(text[2 * i]);
+        const int lo = hexValue(text[2 * i + 1]);
+        hex = hi >= 0 && lo >= 0;
+        key[i] = static_cast<uint8_t>(hi << 4 | lo);
+    }
+
+    if (!hex) {
+        // Passphrase: due SipHash con chiavi fisse diverse danno i 128 bit della chiave
+        static const uint8_t derive[2][16] = {
+            {'R', 'e', 'm', 'o', 't', 'e', 'R', 'c', '-', 'p', 's', 'k', '-', 'k', '0', 0},
+            {'R', 'e', 'm', 'o', 't', 'e', 'R', 'c', '-', 'p', 's', 'k', '-', 'k', '1', 0},
+        };
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(text.data());
+        const uint64_t k0 = siphash24(derive[0], bytes, text.size());
+        const uint64_t k1 = siphash24(derive[1], bytes, text.size());
+        for (int i = 0; i < 8; ++i) {
+            key[i] = static_cast<uint8_t>(k0 >> (8 * i));
+            key[8 + i] = static_cast<uint8_t>(k1 >> (8 * i));
+        }
+    }
+
+    setKey(key);
+    return true;
+}
+
+void ControlAuth::setKey(const uint8_t key[16]) {
+    std::memcpy(key_, key, sizeof(key_));
+    enabled_ = true;
+}
+
+size_t ControlAuth::seal(uint8_t *p, size_t len) {
+    if (!enabled_) {
+        return len;
+    }
+    putU32(p + len, counter_.fetch_add(1) + 1);
+    putU64(p + len + AUTH_COUNTER_SIZE, siphash24(key_, p, len + AUTH_COUNTER_SIZE));
+    return len + AUTH_TRAILER_SIZE;
+}
+
+bool ControlAuth::open(const uint8_t *p, size_t len, size_t &payload_len, uint32_t &counter) const {
+    if (!enabled_) {
+        payload_len = len;
+        counter = 0;
+        return true;
+    }
+    if (len < CONTROL_HEADER_SIZE + AUTH_TRAILER_SIZE) {
+        return false;
+    }
+
+    payload_len = len - AUTH_TRAILER_SIZE;
+    const uint64_t expected = siphash24(key_, p, payload_len + AUTH_COUNTER_SIZE);
+    const uint64_t received = getU64(p + payload_len + AUTH_COUNTER_SIZE);
+    // Confronto senza uscite anticipate: il tempo non rivela quanti byte coincidono
+    if ((expected ^ received) != 0) {
+        return false;
+    }
+    counter = getU32(p + payload_len);
+    return true;
+}
+
+bool ReplayWindow::accept(uint32_t counter) {
+    if (!started_) {
+        started_ = true;
+        highest_ = counter;
+        bitmap_ = 1;
+        return true;
+    }
+
+    const int32_t ahead = static_cast<int32_t>(counter - highest_);
+    if (ahead > 0) {
+        bitmap_ = ahead >= 64 ? 1 : (bitmap_ << ahead) | 1;
+        highest_ = counter;
+        return true;
+    }
+
+    const uint32_t behind = static_cast<uint32_t>(-ahead);
+    if (behind >= 64 || (bitmap_ & (1ULL << behind))) {
+        return false;
+    }
+    bitmap_ |= 1ULL << behind;
+    return true;
+}
+
+HelloChallenge::HelloChallenge() {
+    std::random_device random;
+    for (size_t i = 0; i < sizeof(secret_); i += 4) {
+        putU32(secret_ + i, random());
+    }
+}
+
+uint32_t HelloChallenge::compute(uint32_t addr, uint16_t port, uint64_t epoch) const {
+    uint8_t input[14];
+    putU32(input, addr);
+    putU16(input + 4, port);
+    putU64(input + 6, epoch);
+    const uint32_t challenge = static_cast<uint32_t>(siphash24(secret_, input, sizeof(input)));
+    return challenge != 0 ? challenge : 1;
+}
+
+uint32_t HelloChallenge::issue(uint32_t addr, uint16_t port, uint64_t now_ms) const {
+    return compute(addr, port, now_ms / EPOCH_MS);
+}
+
+bool HelloChallenge::verify(uint32_t challenge, uint32_t addr, uint16_t port, uint64_t now_ms) const {
+    const uint64_t epoch = now_ms / EPOCH_MS;
+    return challenge != 0 &&
+           (challenge == compute(addr, port, epoch) || (epoch > 0 && challenge == compute(addr, port, epoch - 1)));
+}
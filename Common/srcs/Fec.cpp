@@ -0,0 +1,131 @@
+#include "../include/rrc_fec.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+bool parseFecParams(const std::string &text, FecParams &out) {
+    if (text == "off" || text == "0") {
+        out = FecParams{};
+        return true;
+    }
+
+    char *end = nullptr;
+    long cols = std::strtol(text.c_str(), &end, 10);
+    long rows = 1;
+    if (*end == 'x' || *end == 'X') {
+        rows = std::strtol(end + 1, &end, 10);
+    }
+    if (*end != '\0' || cols < 2 || cols > 64 || rows < 1 || rows > 64) {
+        return false;
+    }
+    out.cols = static_cast<uint8_t>(cols);
+    out.rows = static_cast<uint8_t>(rows);
+    return true;
+}
+
+std::string fecParamsToString(const FecParams &params) {
+    if (!params.enabled()) {
+        return "off";
+    }
+    return std::to_string(params.cols) + "x" + std::to_string(params.rows);
+}
+
+namespace {
+
+// Ogni kernel elabora i blocchi interi e ritorna quanti byte ha coperto
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+size_t xorSimd(uint8_t *dst, const uint8_t *src, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        uint8x16_t a0 = veorq_u8(vld1q_u8(dst + i), vld1q_u8(src + i));
+        uint8x16_t a1 = veorq_u8(vld1q_u8(dst + i + 16), vld1q_u8(src + i + 16));
+        vst1q_u8(dst + i, a0);
+        vst1q_u8(dst + i + 16, a1);
+    }
+    return i;
+}
+#elif defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2"))) size_t xorAvx2(uint8_t *dst, const uint8_t *src, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_xor_si256(a, b));
+    }
+    return i;
+}
+
+__attribute__((target("sse2"))) size_t xorSse2(uint8_t *dst, const uint8_t *src, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_xor_si128(a, b));
+    }
+    return i;
+}
+
+// AVX2 non è garantita su tutti i PC client: scelta a runtime
+size_t xorSimd(uint8_t *dst, const uint8_t *src, size_t len) {
+    static const bool has_avx2 = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+    return has_avx2 ? xorAvx2(dst, src, len) : xorSse2(dst, src, len);
+}
+#else
+size_t xorSimd(uint8_t *, const uint8_t *, size_t) {
+    return 0;
+}
+#endif
+
+} // namespace
+
+void fecXor(uint8_t *dst, const uint8_t *src, size_t len) {
+    size_t i = xorSimd(dst, src, len);
+    // Coda (o fallback senza SIMD) a parole da 64 bit
+    for (; i + 8 <= len; i += 8) {
+        uint64_t a, b;
+        std::memcpy(&a, dst + i, 8);
+        std::memcpy(&b, src + i, 8);
+        a ^= b;
+        std::memcpy(dst + i, &a, 8);
+    }
+    for (; i < len; ++i) {
+        dst[i] ^= src[i];
+    }
+}
+
+size_t fecRowCount(const FecParams &params, size_t data_count) {
+    if (!params.enabled()) {
+        return 0;
+    }
+    return (data_count + params.cols - 1) / params.cols;
+}
+
+size_t fecColumnCount(const FecParams &params, size_t data_count) {
+    if (!params.hasColumns()) {
+        return 0;
+    }
+    const size_t block = static_cast<size_t>(params.cols) * params.rows;
+    const size_t full_blocks = data_count / block;
+    const size_t tail = data_count % block;
+    // L'ultimo blocco parziale ha tante colonne quante sono occupate nella sua prima riga
+    return full_blocks * params.cols + std::min<size_t>(tail, params.cols);
+}
+
+FecSpan fecRowSpan(const FecParams &params, size_t data_count, size_t row) {
+    const size_t first = row * params.cols;
+    return {first, 1, std::min(first + params.cols, data_count)};
+}
+
+FecSpan fecColumnSpan(const FecParams &params, size_t data_count, size_t column) {
+    const size_t block = column / params.cols;
+    const size_t col = column % params.cols;
+    const size_t first = block * params.cols * params.rows + col;
+    const size_t end = std::min(first + static_cast<size_t>(params.cols) * params.rows, data_count);
+    return {first, params.cols, end};
+}
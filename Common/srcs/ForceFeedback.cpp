@@ -0,0 +1,114 @@
+#include "../include/rrc_haptic.hpp"
+#include "../include/rrc_platform.hpp"
+#include <algorithm>
+#include <cmath>
+
+void SimulatedHaptic::setSpring(double stiffness) {
+    spring_.store(stiffness);
+}
+
+void SimulatedHaptic::setForce(double force) {
+    force_.store(force);
+    if (std::fabs(force) > peak_force_.load()) {
+        peak_force_.store(std::fabs(force));
+    }
+    updates_.fetch_add(1);
+}
+
+HapticOutput ForceFeedbackModel::update(const Telemetry &telemetry, bool fresh, double dt) {
+    HapticOutput out;
+    const double speed = fresh ? std::min(std::fabs(telemetry.speed_cm_s) / FULL_SPEED_CM_S, 1.0) : 0.0;
+    out.spring = BASE_SPRING + SPEED_SPRING * speed;
+
+    // Rumore bianco filtrato passa basso: vibrazione dell'asfalto
+    noise_ ^= noise_ << 13;
+    noise_ ^= noise_ >> 17;
+    noise_ ^= noise_ << 5;
+    const double white = (noise_ & 0xffff) / 32767.5 - 1.0;
+    road_state_ += (white - road_state_) * std::min(dt * ROAD_CUTOFF_RAD_S, 1.0);
+    double target = road_state_ * ROAD_GAIN * speed;
+
+    if (fresh && (telemetry.flags & TELEMETRY_FLAG_IMU)) {
+        // Il carico laterale in curva si sente come coppia che riporta il volante al centro
+        target -= std::clamp(telemetry.accel_y_mg / 2000.0, -1.0, 1.0) * 0.3;
+    }
+
+    // Urto: un colpo nella direzione dell'accelerazione laterale, che poi si smorza
+    if (fresh && telemetry.seq != last_seq_ && telemetry.impact_mg >= IMPACT_THRESHOLD_MG) {
+        const double strength = std::min(telemetry.impact_mg / 4000.0, 1.0);
+        impact_ = telemetry.accel_y_mg < 0 ? -strength : strength;
+    }
+    last_seq_ = telemetry.seq;
+    impact_ *= std::exp(-dt / IMPACT_DECAY_S);
+
+    // L'urto passa senza limiti di pendenza, il resto viene addolcito
+    const double max_step = MAX_SLEW_PER_S * dt;
+    smooth_ += std::clamp(target - smooth_, -max_step, max_step);
+    out.force = std::clamp(smooth_ + impact_, -1.0, 1.0);
+    return out;
+}
+
+void ForceFeedback::onTelemetry(const Telemetry &telemetry, uint64_t now_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    telemetry_ = telemetry;
+    received_us_ = now_us;
+    stats_.telemetry++;
+}
+
+ForceFeedbackStats ForceFeedback::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void ForceFeedback::start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+    thread_ = std::thread(&ForceFeedback::loop, this);
+}
+
+void ForceFeedback::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    device_.setForce(0.0);
+    device_.setSpring(ForceFeedbackModel::BASE_SPRING);
+}
+
+// Scadenze assolute sul PacingTimer: su Windows sleep_until arrotonda al tick di sistema da 15.6 ms
+// e il ciclo uscirebbe a raffiche. Il ritardo di un tick non si accumula sui successivi.
+void ForceFeedback::loop() {
+    const uint64_t period_us = 1000000 / RATE_HZ;
+    const double dt = 1.0 / RATE_HZ;
+    PacingTimer timer;
+    uint64_t deadline_us = monotonicMicros();
+
+    while (running_.load()) {
+        deadline_us += period_us;
+        timer.sleepUntil(deadline_us);
+
+        const uint64_t now_us = monotonicMicros();
+        const uint64_t late_us = now_us > deadline_us ? now_us - deadline_us : 0;
+        // Scadenze già passate: si salta alla prossima ancora futura invece di recuperarle a raffica
+        const uint64_t missed = late_us / period_us;
+        deadline_us += missed * period_us;
+
+        Telemetry telemetry;
+        bool fresh;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            telemetry = telemetry_;
+            fresh = received_us_ != 0 && now_us - received_us_ < TELEMETRY_TIMEOUT_US;
+            stats_.updates++;
+            stats_.max_late_us = std::max(stats_.max_late_us, late_us);
+            stats_.overruns += missed;
+        }
+
+        const HapticOutput output = model_.update(telemetry, fresh, dt);
+        device_.setSpring(output.spring);
+        device_.setForce(output.force);
+    }
+}
@@ -0,0 +1,134 @@
+#include "../include/rrc_filter.hpp"
+#include "../include/rrc_client.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+constexpr double PI = 3.14159265358979;
+constexpr double MAX_DT_S = 0.5; // Dopo una pausa lunga si riparte dal valore letto
+static const char *const CHANNEL_NAMES[InputFilter::CHANNELS] = {"steering", "accelerator", "brake"};
+
+// Coefficiente del passa-basso esponenziale per la frequenza di taglio e il passo dati
+static double smoothingFactor(double cutoff_hz, double dt_s) {
+    const double tau = 1.0 / (2.0 * PI * cutoff_hz);
+    return 1.0 / (1.0 + tau / dt_s);
+}
+
+double OneEuroFilter::filter(double value, double dt_s) {
+    if (!started_ || dt_s <= 0.0 || dt_s > MAX_DT_S) {
+        started_ = true;
+        raw_ = value;
+        value_ = value;
+        derivative_ = 0.0;
+        return value_;
+    }
+    const double raw_derivative = (value - raw_) / dt_s;
+    derivative_ += smoothingFactor(derivative_cutoff_hz_, dt_s) * (raw_derivative - derivative_);
+    const double cutoff_hz = min_cutoff_hz_ + beta_ * std::fabs(derivative_);
+    value_ += smoothingFactor(cutoff_hz, dt_s) * (value - value_);
+    raw_ = value;
+    return value_;
+}
+
+InputFilter::InputFilter()
+    : stages_{{false, false, OneEuroFilter(STEERING_MIN_CUTOFF_HZ, BETA, DERIVATIVE_CUTOFF_HZ)},
+              {false, false, OneEuroFilter(PEDAL_MIN_CUTOFF_HZ, BETA, DERIVATIVE_CUTOFF_HZ)},
+              {false, false, OneEuroFilter(PEDAL_MIN_CUTOFF_HZ, BETA, DERIVATIVE_CUTOFF_HZ)}} {}
+
+bool InputFilter::configure(const std::string &spec, std::string &error) {
+    bool smooth[CHANNELS] = {};
+    bool predict[CHANNELS] = {};
+    std::stringstream entries(spec);
+    std::string entry;
+    while (std::getline(entries, entry, ',')) {
+        if (entry.empty()) {
+            continue;
+        }
+        const size_t colon = entry.find(':');
+        const std::string name = entry.substr(0, colon);
+        const int channel = static_cast<int>(std::find(CHANNEL_NAMES, CHANNEL_NAMES + CHANNELS, name) - CHANNEL_NAMES);
+        if (channel == CHANNELS || colon == std::string::npos) {
+            error = "canale non valido in '" + entry + "'";
+            return false;
+        }
+        std::stringstream stages(entry.substr(colon + 1));
+        std::string stage;
+        while (std::getline(stages, stage, '+')) {
+            if (stage == "smooth") {
+                smooth[channel] = true;
+            } else if (stage == "predict") {
+                predict[channel] = true;
+            } else {
+                error = "stadio sconosciuto '" + stage + "' per " + name;
+                return false;
+            }
+        }
+    }
+    for (int i = 0; i < CHANNELS; ++i) {
+        stages_[i].smooth = smooth[i];
+        stages_[i].predict = predict[i];
+        stages_[i].filter.reset();
+    }
+    return true;
+}
+
+bool InputFilter::loadFromEnv() {
+    const char *spec = std::getenv("RRC_FILTER");
+    if (!spec || !*spec) {
+        return false;
+    }
+    std::string error;
+    if (!configure(spec, error)) {
+        std::cerr << "RRC_FILTER ignorata: " << error << std::endl;
+        return false;
+    }
+    return enabled();
+}
+
+bool InputFilter::enabled() const {
+    for (const Stage &stage : stages_) {
+        if (stage.smooth || stage.predict) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string InputFilter::describe() const {
+    std::string text;
+    for (int i = 0; i < CHANNELS; ++i) {
+        if (!stages_[i].smooth && !stages_[i].predict) {
+            continue;
+        }
+        text += text.empty() ? "" : ", ";
+        text += std::string(CHANNEL_NAMES[i]) + " " +
+                (stages_[i].smooth ? (stages_[i].predict ? "smooth+predict" : "smooth") : "predict");
+    }
+    return text.empty() ? "nessuno" : text;
+}
+
+// Solo aritmetica su tre canali: pochi microsecondi anche su un portatile lento
+WheelState InputFilter::apply(const WheelState &input, uint64_t now_us, uint64_t horizon_us) {
+    const double dt_s = last_us_ != 0 && now_us > last_us_ ? (now_us - last_us_) / 1e6 : 0.0;
+    last_us_ = now_us;
+    const double horizon_s = std::min(horizon_us, MAX_HORIZON_US) / 1e6;
+
+    WheelState output = input;
+    int *values[CHANNELS] = {&output.steering, &output.accelerator, &output.brake};
+    for (int i = 0; i < CHANNELS; ++i) {
+        Stage &stage = stages_[i];
+        if (!stage.smooth && !stage.predict) {
+            continue;
+        }
+        // Il filtro gira anche solo per la previsione: la derivata grezza sarebbe tutta rumore
+        const double smoothed = stage.filter.filter(*values[i], dt_s);
+        double value = stage.smooth ? smoothed : *values[i];
+        if (stage.predict) {
+            value += stage.filter.derivative() * horizon_s;
+        }
+        *values[i] = std::clamp(static_cast<int>(std::lround(value)), 0, AXIS_MAX_VALUE);
+    }
+    return output;
+}
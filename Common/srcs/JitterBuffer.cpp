@@ -0,0 +1,179 @@
+#include "../include/rrc_jitter.hpp"
+#include <algorithm>
+
+uint64_t JitterBuffer::playoutUs(const Entry &entry) const {
+    return static_cast<uint64_t>(static_cast<int64_t>(entry.capture_us) + base_us_) + delay_us_;
+}
+
+JitterBuffer::Entry *JitterBuffer::oldest() {
+    Entry *found = nullptr;
+    for (Entry &entry : entries_) {
+        if (entry.used && (!found || static_cast<int32_t>(entry.frame_id - found->frame_id) < 0)) {
+            found = &entry;
+        }
+    }
+    return found;
+}
+
+// Ritardo obiettivo: 95° percentile del transito oltre il minimo, più un piccolo margine
+void JitterBuffer::updateTarget(int64_t excess_us) {
+    history_[history_next_] = excess_us;
+    history_next_ = (history_next_ + 1) % HISTORY;
+    history_count_ = std::min(history_count_ + 1, HISTORY);
+
+    std::copy(history_, history_ + history_count_, scratch_);
+    const size_t rank = history_count_ * 95 / 100;
+    std::nth_element(scratch_, scratch_ + rank, scratch_ + history_count_);
+    const int64_t p95 = std::max<int64_t>(scratch_[rank], 0);
+    target_us_ = std::min<uint64_t>(static_cast<uint64_t>(p95) + MARGIN_US, MAX_DELAY_US);
+
+    if (target_us_ > delay_us_) {
+        delay_us_ = target_us_; // Salire subito evita altri scatti
+    }
+}
+
+void JitterBuffer::push(const VideoFrame &frame, uint64_t arrival_us) {
+    stats_.frames_in++;
+    if (have_released_ && frame.frame_id + FRAME_RESTART_GAP < last_released_) {
+        restart(); // Stessa regola del depacketizer: il nuovo stream non va scartato come in ritardo
+        stats_.restarts++;
+    }
+    if (have_released_ && static_cast<int32_t>(frame.frame_id - last_released_) <= 0) {
+        stats_.dropped_late++;
+        return;
+    }
+
+    if (last_capture_us_ && frame.capture_us > last_capture_us_) {
+        const uint64_t interval = frame.capture_us - last_capture_us_;
+        if (interval < 1000000) {
+            frame_interval_us_ += (static_cast<int64_t>(interval) - static_cast<int64_t>(frame_interval_us_)) / 8;
+        }
+    }
+    last_capture_us_ = std::max(last_capture_us_, frame.capture_us);
+
+    // Transito con offset di orologio ignoto: conta solo la differenza dal minimo recente
+    const int64_t transit = static_cast<int64_t>(arrival_us) - static_cast<int64_t>(frame.capture_us);
+    if (min_window_start_us_ == 0 || arrival_us - min_window_start_us_ >= MIN_WINDOW_US / 2) {
+        min_transit_prev_ = min_transit_cur_;
+        min_transit_cur_ = INT64_MAX;
+        min_window_start_us_ = arrival_us;
+    }
+    min_transit_cur_ = std::min(min_transit_cur_, transit);
+    base_us_ = std::min(min_transit_cur_, min_transit_prev_);
+    updateTarget(transit - base_us_);
+
+    Entry *slot = nullptr;
+    for (Entry &entry : entries_) {
+        if (!entry.used) {
+            slot = &entry;
+            break;
+        }
+    }
+    if (!slot) {
+        slot = oldest();
+        stats_.dropped_overflow++;
+        count_--;
+    }
+
+    slot->used = true;
+    slot->frame_id = frame.frame_id;
+    slot->keyframe = frame.keyframe;
+    slot->capture_us = frame.capture_us;
+    slot->data.assign(frame.data, frame.data + frame.size);
+    count_++;
+
+    if (arrival_us > playoutUs(*slot)) {
+        stats_.late_frames++;
+    }
+}
+
+void JitterBuffer::release(Entry &entry) {
+    out_.swap(entry.data); // Nessuna copia: il buffer precedente torna all'entry libera
+    frame_.frame_id = entry.frame_id;
+    frame_.keyframe = entry.keyframe;
+    frame_.capture_us = entry.capture_us;
+    frame_.data = out_.data();
+    frame_.size = out_.size();
+
+    entry.used = false;
+    count_--;
+    have_released_ = true;
+    last_released_ = entry.frame_id;
+    stats_.frames_out++;
+
+    // Recupero graduale: ogni frame esce un po' prima finché il ritardo non torna all'obiettivo
+    if (delay_us_ > target_us_) {
+        delay_us_ -= std::min(delay_us_ - target_us_, frame_interval_us_ / CATCHUP_DIVISOR);
+        stats_.catchup_frames++;
+    }
+}
+
+bool JitterBuffer::pop(uint64_t now_us) {
+    Entry *next = oldest();
+    if (!next) {
+        return false;
+    }
+
+    // Dopo un blocco lungo, se è già arrivato un keyframe conviene saltare direttamente a quello
+    const uint64_t playout = playoutUs(*next);
+    if (now_us > playout && now_us - playout > SKIP_LATE_US && !next->keyframe) {
+        Entry *key = nullptr;
+        for (Entry &entry : entries_) {
+            if (entry.used && entry.keyframe && (!key || static_cast<int32_t>(entry.frame_id - key->frame_id) > 0)) {
+                key = &entry;
+            }
+        }
+        if (key) {
+            for (Entry &entry : entries_) {
+                if (entry.used && static_cast<int32_t>(entry.frame_id - key->frame_id) < 0) {
+                    entry.used = false;
+                    count_--;
+                    stats_.dropped_skip++;
+                }
+            }
+            next = key;
+        }
+    }
+
+    if (now_us < playoutUs(*next)) {
+        return false;
+    }
+    release(*next);
+    return true;
+}
+
+uint64_t JitterBuffer::nextPlayoutUs() const {
+    uint64_t next = UINT64_MAX;
+    const Entry *found = nullptr;
+    for (const Entry &entry : entries_) {
+        if (entry.used && (!found || static_cast<int32_t>(entry.frame_id - found->frame_id) < 0)) {
+            found = &entry;
+        }
+    }
+    if (found) {
+        next = playoutUs(*found);
+    }
+    return next;
+}
+
+void JitterBuffer::restart() {
+    for (Entry &entry : entries_) {
+        entry.used = false;
+    }
+    count_ = 0;
+    have_released_ = false;
+    last_capture_us_ = 0;
+    frame_interval_us_ = DEFAULT_INTERVAL_US;
+    min_transit_cur_ = INT64_MAX;
+    min_transit_prev_ = INT64_MAX;
+    min_window_start_us_ = 0;
+    history_count_ = 0;
+    history_next_ = 0;
+    target_us_ = MARGIN_US;
+    delay_us_ = MARGIN_US;
+}
+
+void JitterBuffer::reset() {
+    restart();
+    stats_ = JitterBufferStats();
+}
@@ -0,0 +1,66 @@
+#include "../include/rrc_stats.hpp"
+#include <cstring>
+
+size_t LatencyHistogram::bucketOf(uint64_t value) {
+    if (value < (1u << SUB_BITS)) {
+        return static_cast<size_t>(value);
+    }
+    const int msb = 63 - __builtin_clzll(value);
+    const uint64_t sub = (value >> (msb - SUB_BITS)) & ((1u << SUB_BITS) - 1);
+    return (static_cast<size_t>(msb - SUB_BITS + 1) << SUB_BITS) + sub;
+}
+
+uint64_t LatencyHistogram::bucketLow(size_t bucket) {
+    if (bucket < (1u << SUB_BITS)) {
+        return bucket;
+    }
+    const int msb = static_cast<int>(bucket >> SUB_BITS) + SUB_BITS - 1;
+    const uint64_t sub = bucket & ((1u << SUB_BITS) - 1);
+    return ((1ULL << SUB_BITS) | sub) << (msb - SUB_BITS);
+}
+
+void LatencyHistogram::record(int64_t value_us) {
+    if (value_us < 0) {
+        negatives_++;
+    }
+    const uint64_t clamped = value_us < 0 ? 0 : static_cast<uint64_t>(value_us);
+    const size_t bucket = bucketOf(clamped);
+    buckets_[bucket < BUCKETS ? bucket : BUCKETS - 1]++;
+
+    if (count_ == 0 || value_us < min_) {
+        min_ = value_us;
+    }
+    if (count_ == 0 || value_us > max_) {
+        max_ = value_us;
+    }
+    sum_ += value_us;
+    count_++;
+}
+
+void LatencyHistogram::reset() {
+    std::memset(buckets_, 0, sizeof(buckets_));
+    count_ = negatives_ = 0;
+    sum_ = min_ = max_ = 0;
+}
+
+int64_t LatencyHistogram::percentile(double p) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    const uint64_t rank = static_cast<uint64_t>(p / 100.0 * (count_ - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets_[i];
+        if (seen >= rank) {
+            const int64_t low = static_cast<int64_t>(bucketLow(i));
+            return low > max_ ? max_ : low;
+        }
+    }
+    return max_;
+}
+
+std::string LatencyHistogram::summary(const char *unit) const {
+    return "n=" + std::to_string(count_) + " p50=" + std::to_string(percentile(50)) +
+           " p95=" + std::to_string(percentile(95)) + " p99=" + std::to_string(percentile(99)) +
+           " max=" + std::to_string(max()) + " " + unit;
+}
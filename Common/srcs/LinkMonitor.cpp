@@ -0,0 +1,64 @@
+#include "../include/rrc_link.hpp"
+#include <algorithm>
+#include <cmath>
+
+void LinkMonitor::onPacket(uint32_t seq, uint32_t send_us, uint64_t recv_us, size_t bytes) {
+    if (!started_) {
+        started_ = true;
+        highest_seq_ = seq;
+        interval_base_seq_ = seq - 1;
+        interval_start_us_ = recv_us;
+        min_window_start_us_ = recv_us;
+        last_send_us_ = send_us;
+        send_ext_us_ = send_us;
+        last_transit_ = static_cast<int64_t>(recv_us) - send_ext_us_;
+    }
+
+    if (static_cast<int32_t>(seq - highest_seq_) > 0) {
+        highest_seq_ = seq;
+    }
+    interval_received_++;
+    interval_bytes_ += bytes;
+
+    send_ext_us_ += static_cast<int32_t>(send_us - last_send_us_);
+    last_send_us_ = send_us;
+    const int64_t transit = static_cast<int64_t>(recv_us) - send_ext_us_;
+
+    // Minimo su una finestra scorrevole a due metà
+    if (recv_us - min_window_start_us_ >= MIN_WINDOW_US / 2) {
+        min_transit_prev_ = min_transit_cur_;
+        min_transit_cur_ = INT64_MAX;
+        min_window_start_us_ = recv_us;
+    }
+    min_transit_cur_ = std::min(min_transit_cur_, transit);
+    const int64_t base = std::min(min_transit_cur_, min_transit_prev_);
+
+    queue_delay_us_ += (static_cast<double>(transit - base) - queue_delay_us_) / 8.0;
+    jitter_us_ += (std::fabs(static_cast<double>(transit - last_transit_)) - jitter_us_) / 16.0;
+    last_transit_ = transit;
+}
+
+bool LinkMonitor::reportDue(uint64_t now_us) const {
+    return started_ && now_us - interval_start_us_ >= REPORT_INTERVAL_US;
+}
+
+ReceiverReport LinkMonitor::makeReport(uint64_t now_us, uint64_t frames_dropped_total) {
+    ReceiverReport report;
+    const uint64_t interval_us = std::max<uint64_t>(now_us - interval_start_us_, 1);
+    const uint32_t expected = highest_seq_ - interval_base_seq_;
+    const uint32_t lost = expected > interval_received_ ? expected - interval_received_ : 0;
+
+    report.interval_ms = static_cast<uint16_t>(std::min<uint64_t>(interval_us / 1000, UINT16_MAX));
+    report.loss_permille = expected ? static_cast<uint16_t>(std::min<uint64_t>(1000ULL * lost / expected, 1000)) : 0;
+    report.frames_dropped = static_cast<uint16_t>(std::min<uint64_t>(frames_dropped_total - last_frames_dropped_, UINT16_MAX));
+    report.queue_delay_us = static_cast<uint32_t>(std::max(queue_delay_us_, 0.0));
+    report.jitter_us = static_cast<uint32_t>(jitter_us_);
+    report.receive_kbps = static_cast<uint32_t>(interval_bytes_ * 8000 / interval_us);
+
+    interval_base_seq_ = highest_seq_;
+    interval_received_ = 0;
+    interval_bytes_ = 0;
+    interval_start_us_ = now_us;
+    last_frames_dropped_ = frames_dropped_total;
+    return report;
+}
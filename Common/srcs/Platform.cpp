@@ -0,0 +1,249 @@
+#include "../include/rrc_platform.hpp"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <mmsystem.h>
+
+#pragma comment(lib, "ws2_32.lib")
+#pragma comment(lib, "winmm.lib")
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002 // Windows 10 1803, assente nei vecchi header
+#endif
+
+bool platformStartup() {
+    WSADATA wsaData;
+    return WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+}
+
+void platformCleanup() {
+    WSACleanup();
+}
+
+std::string netLastError() {
+    return "errore Winsock " + std::to_string(WSAGetLastError());
+}
+
+NetSocket openUdpSocket() {
+    return static_cast<NetSocket>(socket(AF_INET, SOCK_DGRAM, 0));
+}
+
+void closeSocket(NetSocket sock) {
+    closesocket(static_cast<SOCKET>(sock));
+}
+
+static int setOption(NetSocket sock, int level, int name, int value) {
+    return setsockopt(static_cast<SOCKET>(sock), level, name, (const char*)&value, sizeof(value));
+}
+
+int netSend(NetSocket sock, const uint8_t *data, size_t len) {
+    const int n = send(static_cast<SOCKET>(sock), (const char*)data, static_cast<int>(len), 0);
+    return n == SOCKET_ERROR ? -1 : n;
+}
+
+int netRecv(NetSocket sock, uint8_t *data, size_t len) {
+    const int n = recv(static_cast<SOCKET>(sock), (char*)data, static_cast<int>(len), 0);
+    return n == SOCKET_ERROR ? -1 : n;
+}
+
+int netRecvFrom(NetSocket sock, uint8_t *data, size_t len, uint32_t &from_addr) {
+    struct sockaddr_in from{};
+    int from_len = sizeof(from);
+    const int n = recvfrom(static_cast<SOCKET>(sock), (char*)data, static_cast<int>(len), 0,
+                           (struct sockaddr*)&from, &from_len);
+    from_addr = from.sin_addr.s_addr;
+    return n == SOCKET_ERROR ? -1 : n;
+}
+
+void waitReadable(NetSocket first, NetSocket second, uint64_t timeout_us, bool &first_ready, bool &second_ready) {
+    fd_set readfds;
+    FD_ZERO(&readfds);
+    FD_SET(static_cast<SOCKET>(first), &readfds);
+    FD_SET(static_cast<SOCKET>(second), &readfds);
+    struct timeval wait{static_cast<long>(timeout_us / 1000000), static_cast<long>(timeout_us % 1000000)};
+    const bool ready = select(0, &readfds, nullptr, nullptr, &wait) > 0;
+    first_ready = ready && FD_ISSET(static_cast<SOCKET>(first), &readfds);
+    second_ready = ready && FD_ISSET(static_cast<SOCKET>(second), &readfds);
+}
+
+FILE *openPlayerPipe(const std::string &command) {
+    return popen((command + " > NUL 2>&1").c_str(), "wb");
+}
+
+uint64_t monotonicMicros() {
+    static const uint64_t frequency = [] {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        return static_cast<uint64_t>(f.QuadPart);
+    }();
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    const uint64_t ticks = static_cast<uint64_t>(counter.QuadPart);
+    return ticks / frequency * 1000000 + ticks % frequency * 1000000 / frequency;
+}
+
+PacingTimer::PacingTimer(uint64_t spin_us) : spin_us_(spin_us) {
+    timer_ = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (!timer_) {
+        // Versioni precedenti: timer normale, con la risoluzione del sistema portata a 1 ms
+        timer_ = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+        coarse_period_ = timeBeginPeriod(1) == TIMERR_NOERROR;
+    }
+}
+
+PacingTimer::~PacingTimer() {
+    if (timer_) {
+        CloseHandle(timer_);
+    }
+    if (coarse_period_) {
+        timeEndPeriod(1);
+    }
+}
+
+static void sleepSystem(void *timer, uint64_t wake_us) {
+    const uint64_t now_us = monotonicMicros();
+    if (wake_us <= now_us) {
+        return;
+    }
+    LARGE_INTEGER due;
+    due.QuadPart = -static_cast<LONGLONG>((wake_us - now_us) * 10); // Relativa, in unità di 100 ns
+    if (timer && SetWaitableTimer(timer, &due, 0, nullptr, nullptr, FALSE)) {
+        WaitForSingleObject(timer, INFINITE);
+    } else {
+        Sleep(static_cast<DWORD>((wake_us - now_us) / 1000));
+    }
+}
+
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <poll.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+bool platformStartup() {
+    signal(SIGPIPE, SIG_IGN); // Se ffplay viene chiuso la scrittura sulla pipe fallisce senza terminare il client
+    return true;
+}
+
+void platformCleanup() {
+}
+
+std::string netLastError() {
+    return strerror(errno);
+}
+
+NetSocket openUdpSocket() {
+    return socket(AF_INET, SOCK_DGRAM, 0);
+}
+
+void closeSocket(NetSocket sock) {
+    close(sock);
+}
+
+static int setOption(NetSocket sock, int level, int name, int value) {
+    return setsockopt(sock, level, name, &value, sizeof(value));
+}
+
+int netSend(NetSocket sock, const uint8_t *data, size_t len) {
+    return static_cast<int>(send(sock, data, len, 0));
+}
+
+int netRecv(NetSocket sock, uint8_t *data, size_t len) {
+    return static_cast<int>(recv(sock, data, len, 0));
+}
+
+int netRecvFrom(NetSocket sock, uint8_t *data, size_t len, uint32_t &from_addr) {
+    sockaddr_in from{};
+    socklen_t from_len = sizeof(from);
+    const ssize_t n = recvfrom(sock, data, len, 0, reinterpret_cast<sockaddr *>(&from), &from_len);
+    from_addr = from.sin_addr.s_addr;
+    return static_cast<int>(n);
+}
+
+void waitReadable(NetSocket first, NetSocket second, uint64_t timeout_us, bool &first_ready, bool &second_ready) {
+    pollfd fds[2] = {{first, POLLIN, 0}, {second, POLLIN, 0}};
+    const int wait_ms = static_cast<int>((timeout_us + 999) / 1000);
+    const bool ready = poll(fds, 2, wait_ms) > 0;
+    first_ready = ready && (fds[0].revents & POLLIN);
+    second_ready = ready && (fds[1].revents & POLLIN);
+}
+
+FILE *openPlayerPipe(const std::string &command) {
+    return popen((command + " >/dev/null 2>&1").c_str(), "w");
+}
+
+uint64_t monotonicMicros() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+PacingTimer::PacingTimer(uint64_t spin_us) : spin_us_(spin_us) {
+    // Il kernel ritarda i risvegli fino a 50 us per accorparli: su questo thread non serve
+    prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+}
+
+PacingTimer::~PacingTimer() {
+}
+
+static void sleepSystem(void *, uint64_t wake_us) {
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(wake_us / 1000000);
+    ts.tv_nsec = static_cast<long>(wake_us % 1000000) * 1000;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    }
+}
+
+#endif
+
+bool parseIpv4(const std::string &ip, uint32_t &addr) {
+    in_addr parsed{};
+    if (inet_pton(AF_INET, ip.c_str(), &parsed) <= 0) {
+        return false;
+    }
+    addr = parsed.s_addr;
+    return true;
+}
+
+bool connectUdp(NetSocket sock, uint32_t addr, int port) {
+    sockaddr_in serv_addr{};
+    serv_addr.sin_family = AF_INET;
+    serv_addr.sin_addr.s_addr = addr;
+    serv_addr.sin_port = htons(static_cast<uint16_t>(port));
+    return connect(sock, reinterpret_cast<sockaddr *>(&serv_addr), sizeof(serv_addr)) == 0;
+}
+
+bool bindUdp(NetSocket sock, int port) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    return bind(sock, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+}
+
+void setReceiveBuffer(NetSocket sock, int bytes) {
+    setOption(sock, SOL_SOCKET, SO_RCVBUF, bytes);
+}
+
+void setExpeditedForwarding(NetSocket sock) {
+    setOption(sock, IPPROTO_IP, IP_TOS, 0xB8); // DSCP EF (46) << 2
+}
+
+void closePlayerPipe(FILE *pipe) {
+    pclose(pipe);
+}
+
+void PacingTimer::sleepUntil(uint64_t deadline_us) {
+    if (deadline_us > monotonicMicros() + spin_us_) {
+        sleepSystem(timer_, deadline_us - spin_us_);
+    }
+    // Senza yield: cedere la CPU a un altro thread pronto costa spesso un intero time slice
+    while (monotonicMicros() < deadline_us) {
+    }
+}
@@ -0,0 +1,91 @@
+#include "../include/rrc_sdlhaptic.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+bool SdlHaptic::open(SDL_Joystick *joystick) {
+    if (SDL_InitSubSystem(SDL_INIT_HAPTIC) < 0) {
+        std::cerr << "Force feedback non disponibile: " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    haptic_ = SDL_HapticOpenFromJoystick(joystick);
+    if (!haptic_) {
+        std::cerr << "Il volante non supporta il force feedback: " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    const unsigned int supported = SDL_HapticQuery(haptic_);
+    if (!(supported & SDL_HAPTIC_CONSTANT) || !(supported & SDL_HAPTIC_SPRING)) {
+        std::cerr << "Il volante non supporta gli effetti molla e coppia costante." << std::endl;
+        close();
+        return false;
+    }
+
+    // Il centraggio automatico del driver verrebbe sommato alla nostra molla
+    if (supported & SDL_HAPTIC_AUTOCENTER) {
+        SDL_HapticSetAutocenter(haptic_, 0);
+    }
+    if (supported & SDL_HAPTIC_GAIN) {
+        SDL_HapticSetGain(haptic_, 100);
+    }
+
+    spring_.type = SDL_HAPTIC_SPRING;
+    spring_.condition.type = SDL_HAPTIC_SPRING;
+    spring_.condition.length = SDL_HAPTIC_INFINITY;
+    spring_.condition.right_sat[0] = 0xFFFF;
+    spring_.condition.left_sat[0] = 0xFFFF;
+
+    constant_.type = SDL_HAPTIC_CONSTANT;
+    constant_.constant.type = SDL_HAPTIC_CONSTANT;
+    constant_.constant.direction.type = SDL_HAPTIC_CARTESIAN;
+    constant_.constant.direction.dir[0] = 1; // Asse X: positivo verso destra
+    constant_.constant.length = SDL_HAPTIC_INFINITY;
+
+    spring_id_ = SDL_HapticNewEffect(haptic_, &spring_);
+    constant_id_ = SDL_HapticNewEffect(haptic_, &constant_);
+    if (spring_id_ < 0 || constant_id_ < 0) {
+        std::cerr << "Impossibile creare gli effetti di force feedback: " << SDL_GetError() << std::endl;
+        close();
+        return false;
+    }
+    SDL_HapticRunEffect(haptic_, spring_id_, 1);
+    SDL_HapticRunEffect(haptic_, constant_id_, 1);
+    return true;
+}
+
+void SdlHaptic::close() {
+    if (!haptic_) {
+        return;
+    }
+    SDL_HapticStopAll(haptic_);
+    SDL_HapticClose(haptic_);
+    haptic_ = nullptr;
+    spring_id_ = -1;
+    constant_id_ = -1;
+}
+
+void SdlHaptic::setSpring(double stiffness) {
+    if (spring_id_ < 0) {
+        return;
+    }
+    const Sint16 coeff = static_cast<Sint16>(std::clamp(stiffness, 0.0, 1.0) * 0x7FFF);
+    if (std::abs(coeff - spring_.condition.right_coeff[0]) < 0x7FFF / 100) {
+        return; // Variazione sotto l'1%: evita traffico USB inutile
+    }
+    spring_.condition.right_coeff[0] = coeff;
+    spring_.condition.left_coeff[0] = coeff;
+    SDL_HapticUpdateEffect(haptic_, spring_id_, &spring_);
+}
+
+void SdlHaptic::setForce(double force) {
+    if (constant_id_ < 0) {
+        return;
+    }
+    const Sint16 level = static_cast<Sint16>(std::clamp(force, -1.0, 1.0) * 0x7FFF);
+    if (level == constant_.constant.level) {
+        return;
+    }
+    constant_.constant.level = level;
+    SDL_HapticUpdateEffect(haptic_, constant_id_, &constant_);
+}
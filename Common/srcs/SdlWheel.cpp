@@ -0,0 +1,8 @@
+#include "../include/rrc_sdlwheel.hpp"
+
+WheelState SdlWheel::sample() {
+    SDL_JoystickUpdate();
+    return wheelFromRaw(SDL_JoystickGetAxis(joystick_, AXIS_STEERING), SDL_JoystickGetAxis(joystick_, AXIS_ACCELERATOR),
+                        SDL_JoystickGetAxis(joystick_, AXIS_BRAKE), SDL_JoystickGetButton(joystick_, BUTTON_REVERSE),
+                        SDL_JoystickGetButton(joystick_, BUTTON_DRIVE));
+}
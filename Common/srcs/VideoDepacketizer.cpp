@@ -0,0 +1,188 @@
+#include "../include/rrc_stream.hpp"
+#include <algorithm>
+#include <cstring>
+
+void VideoDepacketizer::reset() {
+    for (Slot &slot : slots_) {
+        slot.used = false;
+    }
+    have_emitted_ = false;
+    last_emitted_ = 0;
+}
+
+VideoDepacketizer::Slot *VideoDepacketizer::findSlot(const VideoPacketHeader &header) {
+    for (Slot &slot : slots_) {
+        if (slot.used && slot.frame_id == header.frame_id) {
+            return &slot;
+        }
+    }
+
+    // Slot libero oppure, in mancanza, il frame incompleto più vecchio
+    Slot *victim = nullptr;
+    for (Slot &slot : slots_) {
+        if (!slot.used) {
+            victim = &slot;
+            break;
+        }
+        if (!victim || slot.frame_id < victim->frame_id) {
+            victim = &slot;
+        }
+    }
+
+    if (victim->used) {
+        stats_.frames_dropped++;
+    }
+
+    Slot &slot = *victim;
+    slot.used = true;
+    slot.frame_id = header.frame_id;
+    slot.data_count = header.data_count;
+    slot.fec.cols = header.fec_cols;
+    slot.fec.rows = header.fec_rows ? header.fec_rows : 1;
+    slot.keyframe = (header.flags & VIDEO_FLAG_KEYFRAME) != 0;
+    slot.capture_us = header.capture_us;
+    slot.received = 0;
+    slot.row_count = fecRowCount(slot.fec, slot.data_count);
+
+    const size_t parity_count = slot.row_count + fecColumnCount(slot.fec, slot.data_count);
+    slot.data.resize(slot.data_count * VIDEO_MAX_PAYLOAD);
+    slot.lengths.assign(slot.data_count, 0);
+    slot.have.assign(slot.data_count, 0);
+    slot.parity.resize(parity_count * VIDEO_MAX_PAYLOAD);
+    slot.parity_len_xor.assign(parity_count, 0);
+    slot.parity_size.assign(parity_count, 0);
+    slot.have_parity.assign(parity_count, 0);
+    return &slot;
+}
+
+bool VideoDepacketizer::push(const uint8_t *datagram, size_t len) {
+    VideoPacketHeader header;
+    if (len > VIDEO_MAX_DATAGRAM || !parseVideoHeader(datagram, len, header)) {
+        return false;
+    }
+    stats_.packets++;
+
+    if (have_emitted_ && header.frame_id + FRAME_RESTART_GAP < last_emitted_) {
+        reset();
+    }
+    if (have_emitted_ && header.frame_id <= last_emitted_) {
+        stats_.late_packets++;
+        return false;
+    }
+
+    Slot *slot = findSlot(header);
+    if (slot->data_count != header.data_count || slot->fec.cols != header.fec_cols ||
+        slot->fec.rows != (header.fec_rows ? header.fec_rows : 1)) {
+        return false; // Intestazione incoerente con i pacchetti già ricevuti
+    }
+
+    const uint8_t *payload = datagram + VIDEO_HEADER_SIZE;
+    const size_t payload_len = len - VIDEO_HEADER_SIZE;
+
+    if (header.flags & VIDEO_FLAG_PARITY) {
+        stats_.parity_packets++;
+        size_t index = header.index;
+        if (header.flags & VIDEO_FLAG_COLUMN) {
+            index += slot->row_count;
+        }
+        if (index >= slot->have_parity.size() || slot->have_parity[index]) {
+            return false;
+        }
+        uint8_t *dst = slot->parity.data() + index * VIDEO_MAX_PAYLOAD;
+        std::memcpy(dst, payload, payload_len);
+        std::memset(dst + payload_len, 0, VIDEO_MAX_PAYLOAD - payload_len);
+        slot->parity_len_xor[index] = header.length;
+        slot->parity_size[index] = static_cast<uint16_t>(payload_len);
+        slot->have_parity[index] = 1;
+    } else {
+        if (header.index >= slot->data_count || slot->have[header.index] || payload_len != header.length) {
+            return false;
+        }
+        std::memcpy(slot->data.data() + header.index * VIDEO_MAX_PAYLOAD, payload, payload_len);
+        slot->lengths[header.index] = header.length;
+        slot->have[header.index] = 1;
+        slot->received++;
+    }
+
+    if (slot->received < slot->data_count && slot->fec.enabled()) {
+        recover(*slot);
+    }
+    if (slot->received < slot->data_count) {
+        return false;
+    }
+
+    complete(*slot);
+    return true;
+}
+
+void VideoDepacketizer::recover(Slot &slot) {
+    // Decodifica iterativa: ogni pacchetto ricostruito può sbloccare una riga o una colonna
+    bool progress = true;
+    while (progress && slot.received < slot.data_count) {
+        progress = false;
+        for (size_t p = 0; p < slot.have_parity.size(); ++p) {
+            if (!slot.have_parity[p]) {
+                continue;
+            }
+            const FecSpan span = p < slot.row_count ? fecRowSpan(slot.fec, slot.data_count, p)
+                                                    : fecColumnSpan(slot.fec, slot.data_count, p - slot.row_count);
+            size_t missing = span.end;
+            size_t missing_count = 0;
+            for (size_t i = span.first; i < span.end && missing_count < 2; i += span.step) {
+                if (!slot.have[i]) {
+                    missing = i;
+                    missing_count++;
+                }
+            }
+            if (missing_count == 1) {
+                rebuild(slot, p, missing, span);
+                progress = true;
+            }
+        }
+    }
+}
+
+void VideoDepacketizer::rebuild(Slot &slot, size_t parity_index, size_t missing, const FecSpan &span) {
+    uint8_t *dst = slot.data.data() + missing * VIDEO_MAX_PAYLOAD;
+    std::memcpy(dst, slot.parity.data() + parity_index * VIDEO_MAX_PAYLOAD, slot.parity_size[parity_index]);
+    uint16_t length = slot.parity_len_xor[parity_index];
+
+    for (size_t i = span.first; i < span.end; i += span.step) {
+        if (i != missing) {
+            fecXor(dst, slot.data.data() + i * VIDEO_MAX_PAYLOAD, slot.lengths[i]);
+            length ^= slot.lengths[i];
+        }
+    }
+
+    slot.lengths[missing] = std::min<uint16_t>(length, VIDEO_MAX_PAYLOAD);
+    slot.have[missing] = 1;
+    slot.received++;
+    stats_.recovered++;
+}
+
+void VideoDepacketizer::complete(Slot &slot) {
+    frame_buf_.clear();
+    for (size_t i = 0; i < slot.data_count; ++i) {
+        const uint8_t *chunk = slot.data.data() + i * VIDEO_MAX_PAYLOAD;
+        frame_buf_.insert(frame_buf_.end(), chunk, chunk + slot.lengths[i]);
+    }
+
+    frame_.frame_id = slot.frame_id;
+    frame_.keyframe = slot.keyframe;
+    frame_.capture_us = slot.capture_us;
+    frame_.data = frame_buf_.data();
+    frame_.size = frame_buf_.size();
+
+    have_emitted_ = true;
+    last_emitted_ = slot.frame_id;
+    stats_.frames_complete++;
+
+    for (Slot &other : slots_) {
+        if (other.used && other.frame_id <= last_emitted_) {
+            if (&other != &slot) {
+                stats_.frames_dropped++;
+            }
+            other.used = false;
+        }
+    }
+}
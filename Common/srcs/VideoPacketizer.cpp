@@ -0,0 +1,63 @@
+#include "../include/rrc_stream.hpp"
+#include <algorithm>
+#include <cstring>
+
+void VideoPacketizer::packetize(const uint8_t *frame, size_t len, bool keyframe, const FecParams &fec,
+                                uint32_t send_us, uint64_t capture_us) {
+    sizes_.clear();
+    if (len == 0 || len > VIDEO_MAX_FRAME_BYTES) {
+        return; // Il ricevitore lo scarterebbe comunque
+    }
+
+    const size_t data_count = (len + VIDEO_MAX_PAYLOAD - 1) / VIDEO_MAX_PAYLOAD;
+    const size_t row_count = fecRowCount(fec, data_count);
+    const size_t column_count = fecColumnCount(fec, data_count);
+    const size_t total = data_count + row_count + column_count;
+    if (buffer_.size() < total * VIDEO_MAX_DATAGRAM) {
+        buffer_.resize(total * VIDEO_MAX_DATAGRAM);
+    }
+
+    VideoPacketHeader header;
+    header.frame_id = next_frame_id_++;
+    header.data_count = static_cast<uint16_t>(data_count);
+    header.fec_cols = fec.cols;
+    header.fec_rows = fec.rows;
+    header.send_us = send_us;
+    header.capture_us = capture_us;
+    const uint8_t base_flags = keyframe ? VIDEO_FLAG_KEYFRAME : 0;
+
+    for (size_t i = 0; i < data_count; ++i) {
+        const size_t offset = i * VIDEO_MAX_PAYLOAD;
+        const size_t chunk = std::min(VIDEO_MAX_PAYLOAD, len - offset);
+        header.flags = base_flags;
+        header.index = static_cast<uint16_t>(i);
+        header.length = static_cast<uint16_t>(chunk);
+        header.seq = next_seq_++;
+        writeVideoHeader(slot(i), header);
+        std::memcpy(slot(i) + VIDEO_HEADER_SIZE, frame + offset, chunk);
+        sizes_.push_back(static_cast<uint16_t>(VIDEO_HEADER_SIZE + chunk));
+    }
+
+    // Parità: XOR dei payload coperti, allineati a sinistra e completati con zeri
+    for (size_t p = 0; p < row_count + column_count; ++p) {
+        const bool column = p >= row_count;
+        const FecSpan span = column ? fecColumnSpan(fec, data_count, p - row_count)
+                                    : fecRowSpan(fec, data_count, p);
+        uint8_t *out = slot(data_count + p);
+        size_t max_len = 0;
+        uint16_t len_xor = 0;
+        std::memset(out + VIDEO_HEADER_SIZE, 0, VIDEO_MAX_PAYLOAD);
+        for (size_t i = span.first; i < span.end; i += span.step) {
+            const size_t chunk = sizes_[i] - VIDEO_HEADER_SIZE;
+            fecXor(out + VIDEO_HEADER_SIZE, slot(i) + VIDEO_HEADER_SIZE, chunk);
+            len_xor ^= static_cast<uint16_t>(chunk);
+            max_len = std::max(max_len, chunk);
+        }
+        header.flags = base_flags | VIDEO_FLAG_PARITY | (column ? VIDEO_FLAG_COLUMN : 0);
+        header.index = static_cast<uint16_t>(column ? p - row_count : p);
+        header.length = len_xor;
+        header.seq = next_seq_++;
+        writeVideoHeader(out, header);
+        sizes_.push_back(static_cast<uint16_t>(VIDEO_HEADER_SIZE + max_len));
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef RRC_CONFIG_HPP
+#define RRC_CONFIG_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Parametri modificabili senza ricompilare. File di testo "chiave = valore" (# per i commenti),
+// con le opzioni --set=chiave=valore applicate sopra il file a ogni caricamento.
+struct RuntimeConfig {
+    // Letti solo all'avvio: cambiarli nel file richiede di riavviare il server
+    int control_port = 8080;
+    int servo_pin = 24;
+    int motor_pin = 1;
+    int sensor_rate_hz = 200;    // Frequenza di lettura di IMU e batteria
+    std::string i2c_bus = "/dev/i2c-1";
+    int imu_i2c_address = 104;   // 0x68, MPU-6050 con AD0 a massa
+    int adc_i2c_address = 72;    // 0x48, ADS1115 con ADDR a massa
+    int battery_scale_x1000 = 3000; // Partitore davanti all'ADC: tensione della batteria / tensione letta, x1000
+    int sim_battery_mv = 8200;   // make sim: tensione iniziale della batteria simulata (LiPo 2S)
+
+    // Applicati a caldo
+    int pwm_min_us = 1000;       // Retromarcia massima / sterzo tutto a sinistra
+    int pwm_max_us = 2000;       // Avanti massima / sterzo tutto a destra
+    int pwm_neutral_us = 1500;
+    int dead_zone_us = 15;       // Attorno al neutro il motore resta in folle
+    int esc_brake_ms = 40;       // Freno minimo prima del folle che arma la retromarcia dell'ESC
+    int esc_gap_ms = 40;         // Folle minimo tra freno e retromarcia; almeno un frame PWM (20 ms)
+    int esc_arm_window_ms = 1000; // Folle dopo il freno oltre il quale l'ESC disarma la retromarcia; 0 mai
+    int traction_control = 0;    // 1: rampa di partenza, limiti di accelerazione e pattinamento, sterzo graduale
+    int launch_ramp_ms = 300;    // Da fermo, tempo per arrivare a gas pieno; 0 senza rampa
+    int launch_speed_cm_s = 50;  // Sotto questa velocità una pressione del gas è una partenza
+    int accel_limit_cm_s2 = 500; // Oltre, il gas viene tagliato; 0 senza limite. Serve un IMU o il modello
+    int slip_limit_pct = 15;     // Ruote più veloci dell'auto di così: pattinamento; 0 spento
+    int steer_rate_us_s = 8000;  // Velocità massima dell'impulso di sterzo da fermo; 0 senza limite
+    int steer_rate_speed_cm_s = 300; // A questa velocità il limite dello sterzo si dimezza
+    int battery_low_mv = 7000;   // Sotto per 0.5 s: basso consumo (LiPo 2S, 3.5 V per cella); 0 spento
+    int battery_hysteresis_mv = 300; // Si torna alla normalità sopra soglia + isteresi per 10 s
+    int low_power_throttle_pct = 50; // Gas massimo in basso consumo
+    int video_port = 1234;       // Dal prossimo avvio del processo video
+    int client_period_ms = 100;  // Periodo dei comandi del client, comunicato con l'ACCEPT
+    std::string camera_command = "rpicam-vid"; // Programma e opzioni extra; risoluzione e bitrate li aggiunge il relay
+};
+
+struct ConfigStats {
+    uint64_t reloads = 0;
+    uint64_t errors = 0;   // Caricamenti scartati: resta in uso la configurazione precedente
+    uint64_t applied = 0;  // Configurazioni adottate dal ciclo dei comandi
+};
+
+// Legge file e override; in caso di errore out non viene toccato e error descrive il problema
+bool loadConfig(const std::string &path, const std::vector<std::string> &overrides, RuntimeConfig &out,
+                std::string &error);
+
+// Primo caricamento, prima di creare i thread. path vuoto: solo default e override, niente ricarica.
+bool initConfig(const std::string &path, const std::vector<std::string> &overrides);
+
+// Configurazione in uso dal ciclo dei comandi. Solo il thread dei comandi la legge, quindi il
+// riferimento resta valido fino alla prossima adoptPendingConfig dello stesso thread.
+const RuntimeConfig &activeConfig();
+
+// Avvia il thread che osserva il file con inotify, lo rilegge e pubblica il risultato.
+// Ritorna un eventfd che diventa leggibile a ogni nuova configurazione, o -1 senza file.
+int startConfigWatcher();
+// Sul thread dei comandi: adotta l'ultima configurazione pubblicata con un solo scambio di
+// puntatore. Ritorna la precedente, valida fino alla prossima chiamata, o nullptr se non c'è nulla di nuovo.
+const RuntimeConfig *adoptPendingConfig();
+void stopConfigWatcher();
+ConfigStats configStats();
+
+#endif // RRC_CONFIG_HPP
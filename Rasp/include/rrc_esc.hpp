@@ -0,0 +1,52 @@
+#ifndef RRC_ESC_HPP
+#define RRC_ESC_HPP
+
+#include <cstdint>
+#include "rrc_config.hpp"
+
+// Sequenza dell'ESC bidirezionale sul canale motore. L'ESC innesta la retromarcia solo con
+// freno, almeno un impulso in folle e un secondo impulso sotto il neutro; l'hardware PWM
+// campiona il valore una volta per frame (20 ms), quindi uno stato più breve di un frame
+// può non arrivare mai all'ESC. Qui ogni fase ha una durata minima garantita dal timer
+// dell'uscita: la retromarcia parte dopo esc_brake_ms + esc_gap_ms, qualunque sia la
+// cadenza dei comandi del client. Dopo esc_arm_window_ms di folle l'ESC disarma da solo e
+// un impulso sotto il neutro torna a frenare.
+class EscSequencer {
+public:
+    enum State { NEUTRAL, FORWARD, BRAKING, NEUTRAL_GAP, REVERSE };
+    enum Intent { WANT_NEUTRAL, WANT_FORWARD, WANT_BRAKE, WANT_REVERSE };
+
+    // Nuova richiesta del pilota con l'impulso corrispondente (avanti, freno o retromarcia).
+    // Ritorna l'impulso da scrivere subito sul pin del motore.
+    int request(Intent intent, int pulse_us, uint64_t now_us, const RuntimeConfig &config);
+    // Dal timer dell'uscita alla scadenza di una fase: la fa avanzare e ritorna l'impulso
+    int tick(uint64_t now_us, const RuntimeConfig &config);
+    // Folle immediato senza sequenza (lease scaduto, arresto): l'ESC resta armato se veniva dal freno
+    int forceNeutral(uint64_t now_us, const RuntimeConfig &config);
+
+    // Istante assoluto in cui una fase a tempo finisce, 0 se nessuna è in corso
+    uint64_t deadlineUs(const RuntimeConfig &config) const;
+    State state() const { return state_; }
+    uint64_t reverseEngagements() const { return reverse_engagements_; }
+
+private:
+    void enter(State state, uint64_t now_us);
+    bool armed(uint64_t now_us, const RuntimeConfig &config) const;
+    void expireArming(uint64_t now_us, const RuntimeConfig &config);
+    int advance(uint64_t now_us, const RuntimeConfig &config);
+    int output(const RuntimeConfig &config) const;
+
+    State state_ = NEUTRAL;
+    Intent intent_ = WANT_NEUTRAL;
+    int pulse_us_ = 0;
+    int backward_pulse_us_ = 0;     // Ultimo impulso di freno o retromarcia richiesto
+    uint64_t since_us_ = 0;         // Inizio dello stato corrente
+    uint64_t neutral_since_us_ = 0; // Inizio del folle, anche attraverso NEUTRAL_GAP
+    bool after_backward_ = false;   // Il folle corrente segue un impulso sotto il neutro
+    bool after_reverse_ = false;    // ... ed era retromarcia: l'ESC è già in retromarcia o armato
+    uint64_t reverse_engagements_ = 0;
+};
+
+const char *escStateName(EscSequencer::State state);
+
+#endif // RRC_ESC_HPP
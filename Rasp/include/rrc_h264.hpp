@@ -0,0 +1,46 @@
+#ifndef RRC_H264_HPP
+#define RRC_H264_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct H264AccessUnit {
+    const uint8_t *data;
+    size_t size;
+    bool keyframe;
+};
+
+// Divide il flusso Annex-B di rpicam-vid in access unit (un frame ciascuna).
+// Un nuovo frame inizia con AUD/SEI/SPS/PPS o con la prima slice di un'immagine.
+// L'ultimo NAL è completo solo quando arriva lo start code successivo, oppure
+// quando la pipe è vuota (rpicam-vid scrive un frame per volta): in quel caso chiamare flush().
+class H264Framer {
+public:
+    void feed(const uint8_t *data, size_t len);
+    void flush();
+
+    size_t readyCount() const { return ready_.size(); }
+    size_t pendingBytes() const { return buffer_.size() - unit_start_; }
+    H264AccessUnit ready(size_t i) const;
+    // Libera i frame già letti con ready(); i puntatori precedenti non sono più validi.
+    void consume();
+
+private:
+    struct Span {
+        size_t start;
+        size_t size;
+        bool keyframe;
+    };
+
+    void closeUnit(size_t end);
+
+    std::vector<uint8_t> buffer_;
+    std::vector<Span> ready_;
+    size_t scan_ = 0;
+    size_t unit_start_ = 0;
+    bool unit_has_slice_ = false;
+    bool unit_keyframe_ = false;
+};
+
+#endif // RRC_H264_HPP
@@ -0,0 +1,45 @@
+#ifndef RRC_LEASE_HPP
+#define RRC_LEASE_HPP
+
+#include <cstdint>
+#include <netinet/in.h>
+#include <random>
+
+// Lease di guida: un solo client (indirizzo e porta) alla volta comanda l'auto e riceve il video.
+// Il lease si ottiene con un hello se è libero o scaduto, e si rinnova con ogni comando che
+// porta il token giusto dallo stesso indirizzo. Un hello dal titolare lo rinnova con lo stesso token.
+class DriverLease {
+public:
+    enum HelloResult {
+        HELLO_RENEWED,    // Stesso titolare, stesso token
+        HELLO_NEW_HOLDER, // Nuovo titolare: il video va reindirizzato
+        HELLO_BUSY,
+    };
+
+    explicit DriverLease(uint32_t lease_ms) : lease_ms_(lease_ms), rng_(std::random_device{}()) {}
+
+    HelloResult onHello(const struct sockaddr_in &from, uint64_t now_ms);
+    bool renew(uint32_t token, const struct sockaddr_in &from, uint64_t now_ms);
+    bool release(uint32_t token, const struct sockaddr_in &from);
+    // True una sola volta, quando il lease scade senza rinnovi
+    bool expire(uint64_t now_ms);
+
+    bool active() const { return active_; }
+    bool isHolder(const struct sockaddr_in &from) const;
+    uint32_t token() const { return token_; }
+    const struct sockaddr_in &holder() const { return holder_; }
+    uint64_t idleMs(uint64_t now_ms) const { return now_ms - last_renew_ms_; }
+
+private:
+    static bool sameEndpoint(const struct sockaddr_in &a, const struct sockaddr_in &b);
+
+    uint32_t lease_ms_;
+    std::mt19937 rng_;
+    bool active_ = false;
+    bool has_holder_ = false; // Resta vero dopo la scadenza: il video non viene spostato finché nessuno subentra
+    struct sockaddr_in holder_{};
+    uint32_t token_ = 0;
+    uint64_t last_renew_ms_ = 0;
+};
+
+#endif // RRC_LEASE_HPP
@@ -0,0 +1,39 @@
+#ifndef RRC_POWER_HPP
+#define RRC_POWER_HPP
+
+#include <cstdint>
+#include "rrc_config.hpp"
+#include "rrc_sensors.hpp"
+
+// Sorveglianza dell'alimentazione: tensione della batteria dall'ADC e sottotensione segnalata dal
+// firmware del Pi. Sotto soglia l'auto passa in basso consumo (gas limitato, video ridotto) prima
+// che un calo di tensione blocchi il Pi a metà corsa; ne esce solo con la batteria stabilmente sopra
+// la soglia più l'isteresi, per non alternare le modalità a ogni accelerata.
+class PowerMonitor {
+public:
+    enum Reason { NONE, BATTERY_LOW, UNDERVOLTAGE };
+
+    // Dal tick di telemetria, dopo pollSensors. Ritorna true se la modalità cambia.
+    bool update(const SensorSnapshot &sensors, uint64_t now_us, const RuntimeConfig &config);
+
+    bool lowPower() const { return low_power_; }
+    Reason reason() const { return reason_; }
+    int batteryMv() const { return battery_mv_; }     // 0 senza lettura recente
+    int minBatteryMv() const { return min_battery_mv_; }
+    uint32_t powerFlags() const { return power_flags_; }
+    uint64_t entries() const { return entries_; }
+
+private:
+    bool low_power_ = false;
+    Reason reason_ = NONE;
+    uint64_t low_since_us_ = 0;   // Inizio della condizione di soglia in corso, 0 se assente
+    uint64_t good_since_us_ = 0;  // Inizio della batteria di nuovo buona, 0 se non lo è
+    int battery_mv_ = 0;
+    int min_battery_mv_ = 0;
+    uint32_t power_flags_ = 0;
+    uint64_t entries_ = 0;
+};
+
+const char *powerReasonName(PowerMonitor::Reason reason);
+
+#endif // RRC_POWER_HPP
@@ -2,7 +2,11 @@
 #define RRC_RASP_HPP
 
 #include <iostream>
-#include <wiringPi.h>
+#ifdef RRC_SIMULATION
+# include "rrc_simgpio.hpp"
+#else
+# include <wiringPi.h>
+#endif
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -14,27 +18,105 @@
 #include <mutex>
 #include <cstdlib>  // Per usare system()
 #include <atomic>  // Aggiungi questa libreria per usare atomic
+#include "rrc_auth.hpp"
+#include "rrc_config.hpp"
+#include "rrc_fec.hpp"
+#include "rrc_rate.hpp"
+#include "rrc_record.hpp"
+#include "rrc_sensors.hpp"
+#include "rrc_stats.hpp"
+#include "rrc_traction.hpp"
 
- # define SERVO_PIN 24
-#define MOTOR_PIN 1
-#define PORT 8080
+// Sorgente del flusso H.264 letto dal relay
+enum VideoSource {
+    SOURCE_CAMERA,    // rpicam-vid
+    SOURCE_TESTSRC,   // ffmpeg con testsrc2 e libx264: decodificabile, senza telecamera
+    SOURCE_SYNTHETIC, // Generatore interno (--synthetic-video): nessuna dipendenza, non decodificabile
+    SOURCE_SIMVIEW,   // Solo make sim: auto simulata vista dall'alto (--sim-view), codificata con ffmpeg
+};
+
+// Orologio monotono in µs, usato per i timestamp del video e la sincronizzazione con il client
+inline uint64_t monotonicMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline uint64_t monotonicNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Stato del processo video, per il socket di amministrazione
+struct VideoSupervisorStats {
+    pid_t pid = -1;           // -1 se non è in esecuzione
+    uint64_t uptime_ms = 0;   // Da quanto è attivo il processo corrente
+    uint64_t backoff_ms = 0;  // Attesa residua prima del riavvio dopo un errore
+    uint64_t starts = 0;
+    uint64_t restarts = 0;    // Riavvii dopo un errore
+    uint64_t crashes = 0;     // Uscite non richieste
+    uint64_t stalls = 0;      // Processi uccisi perché non producevano più byte
+    int last_exit_code = 0;
+    int last_exit_signal = 0;
+    uint64_t max_control_stall_us = 0; // Tempo massimo speso dal supervisore sul thread dei comandi
+};
+
+class Reactor;
+
+// Opzioni del ciclo dei comandi
+struct ServerOptions {
+    std::string admin_path = "/tmp/rrc_admin.sock"; // Vuoto: niente socket di amministrazione
+    int rt_cpu = 3;       // CPU riservata al ciclo dei comandi (il Pi Zero 2W ne ha 4), -1 per non legarlo
+    int rt_priority = 50; // Priorità SCHED_FIFO, 0 per lo scheduler normale
+    bool low_latency = false; // Busy poll, buffer piccolo e DSCP EF sul socket dei comandi
+    int spin_us = 0;          // Attesa attiva del reactor prima di dormire
+    bool record = false;      // --record: la registrazione parte con il ciclo dei comandi, dopo enterRealtime
+#ifdef RRC_SIMULATION
+    SensorSource sensors = SENSORS_SIM;
+#else
+    SensorSource sensors = SENSORS_FIRMWARE; // IMU e ADC della batteria solo se montati
+#endif
+};
 
 // Modalità di guida
 enum Mode { DRIVE, REVERSE };
 extern Mode currentMode;
 
-extern pid_t stream_pid;  // Variabile per memorizzare il PID del processo di streaming
-extern std::mutex stream_mutex; // Mutex per gestire l'accesso al processo di streaming
-extern std::atomic<bool> stop_streaming;
-extern FILE* stream_proc;  // Pointer per popen()
+extern std::mutex stream_mutex; // Protegge livello e sorgente del video
+extern ControlAuth control_auth; // Chiave condivisa del canale di controllo (RRC_PSK)
 
 void setupGPIO();
-void handleCommand(int server_fd);
-void startVideoStream(struct sockaddr_in &client_addr);
+void handleCommand(int server_fd, int signal_fd, const ServerOptions &options);
+void initVideoSupervisor(Reactor &reactor);
+void startVideoStream(const struct sockaddr_in &client_addr);
 void stopVideoStream();
-void signalHandler(int signum);
+void shutdownVideoStream();
+void noteVideoOutput();
+VideoSupervisorStats videoSupervisorStats();
+void videoRelayLoop(int pipe_fd, struct sockaddr_in client_addr, VideoTier tier);
+void setRecordOptions(const std::string &dir, int segment_s);
+void setRecording(bool enabled);
+bool isRecording();
+RecorderStats recorderStats();
+void recordVideoFrame(const uint8_t *data, size_t len, bool keyframe, uint64_t capture_us,
+                      uint16_t width, uint16_t height);
+void shutdownRecorder();
+constexpr uint64_t TELEMETRY_PERIOD_US = 20000; // 50 Hz
+void sendTelemetry(int server_fd);
+void setTelemetryClient(const struct sockaddr_in &client_addr);
+void clearTelemetryClient();
+void publishActuators(int steering_us, int throttle_us);
+// Modalità a basso consumo, segnalata al client nella telemetria: solo thread dei comandi
+void publishLowPower(bool low_power);
+// Aggiornato da sendTelemetry, letto dal controllo di trazione: solo thread dei comandi
+const VehicleMotion &vehicleMotion();
+void setVideoFec(const FecParams &params);
+FecParams videoFec();
+void setVideoTier(const VideoTier &tier);
+void setVideoSource(VideoSource source);
+bool parseVideoSource(const std::string &text, VideoSource &out);
+int runSyntheticVideo(int bitrate, int framerate);
 void setupSocket(int &server_fd, struct sockaddr_in &address);
-void startServer();
+void startServer(int signal_fd, const ServerOptions &options);
 int map(int x, int in_min, int in_max, int out_min, int out_max);
 
 #endif // RRC_RASP_HPP
\ No newline at end of file
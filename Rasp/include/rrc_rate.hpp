@@ -0,0 +1,43 @@
+#ifndef RRC_RATE_HPP
+#define RRC_RATE_HPP
+
+#include "rrc_proto.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// Configurazione dell'encoder per un livello di qualità
+struct VideoTier {
+    int bitrate;   // bit/s
+    int width;
+    int height;
+    int framerate;
+};
+
+// Controllo di congestione semplificato (stile GCC): il bitrate obiettivo cresce
+// lentamente finché perdite e coda restano basse, e cala subito quando aumentano.
+// Il livello dell'encoder segue l'obiettivo con isteresi, perché cambiarlo costa
+// il riavvio di rpicam-vid: in discesa dopo 2 s, in salita un gradino ogni 10 s.
+class RateController {
+public:
+    RateController();
+
+    // Ritorna true se il livello dell'encoder deve cambiare
+    bool onReport(const ReceiverReport &report, uint64_t now_ms);
+    // Basso consumo: il livello non sale sopra uno piccolo, che alleggerisce encoder e Wi-Fi.
+    // Ritorna true se il livello deve cambiare subito.
+    bool setLowPower(bool low_power, uint64_t now_ms);
+
+    const VideoTier &tier() const;
+    size_t tierIndex() const { return tier_index_; }
+    double targetBitrate() const { return target_bps_; }
+
+private:
+    size_t tierFor(double bitrate) const;
+
+    double target_bps_;
+    size_t tier_index_;
+    uint64_t last_change_ms_ = 0;
+    size_t best_tier_ = 0; // Livello più alto concesso
+};
+
+#endif // RRC_RATE_HPP
@@ -0,0 +1,86 @@
+#ifndef RRC_REACTOR_HPP
+#define RRC_REACTOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+
+struct ReactorStats {
+    uint64_t wakeups = 0;
+    uint64_t dispatches = 0;
+    uint64_t timer_overruns = 0;  // Scadenze di timer perse perché il ciclo era occupato
+    uint64_t max_dispatch_us = 0; // Handler più lento: limite al ritardo di una sorgente urgente
+    uint64_t spin_hits = 0;       // Risvegli serviti durante l'attesa attiva, senza dormire
+    uint64_t spin_sleeps = 0;     // Attese attive esaurite senza eventi: il ciclo si è addormentato
+};
+
+// Ciclo a eventi su epoll per il thread dei comandi: socket, timerfd, signalfd e pidfd.
+// Le sorgenti stanno in una tabella fissa e l'handler è un puntatore a funzione con contesto,
+// quindi il dispatch ha costo costante e, dopo la registrazione, nessuna allocazione.
+// Le sorgenti urgenti (i segnali) vengono servite per prime tra quelle pronte nello stesso risveglio.
+class Reactor {
+public:
+    using Handler = void (*)(void *ctx, int fd, uint32_t events);
+
+    static constexpr size_t MAX_SOURCES = 16;
+    static constexpr int MAX_EVENTS = 16;
+
+    Reactor();
+    ~Reactor();
+
+    bool add(int fd, uint32_t events, Handler handler, void *ctx, bool urgent = false);
+    // Timer periodico su timerfd; l'handler parte una volta per risveglio anche se le scadenze sono più d'una.
+    // Ritorna il file descriptor del timer (chiuso da remove) o -1. Con period_us 0 il timer
+    // nasce disarmato e parte solo con armTimer.
+    int addTimer(uint64_t period_us, Handler handler, void *ctx);
+    // Scadenza singola a un istante assoluto di monotonicMicros(); 0 disarma il timer
+    bool armTimer(int fd, uint64_t deadline_us);
+    void remove(int fd);
+
+    void run(); // Fino a stop()
+    void stop() { running_ = false; }
+    // Dopo ogni risveglio interroga epoll senza bloccare per spin_us prima di dormire:
+    // niente latenza di risveglio per i datagrammi ravvicinati, al costo della CPU consumata. 0 la disattiva.
+    void setSpin(uint64_t spin_us) { spin_us_ = spin_us; }
+
+    uint64_t wokeUs() const { return woke_us_; } // Istante dell'ultimo ritorno di epoll_wait
+    const ReactorStats &stats() const { return stats_; }
+
+private:
+    struct Source {
+        int fd = -1;
+        Handler handler = nullptr;
+        void *ctx = nullptr;
+        bool urgent = false;
+        bool timer = false;
+    };
+
+    void dispatch(Source &source, uint32_t events);
+
+    int epoll_fd_;
+    bool running_ = false;
+    uint64_t spin_us_ = 0;
+    uint64_t woke_us_ = 0;
+    Source sources_[MAX_SOURCES];
+    ReactorStats stats_;
+};
+
+// Thread corrente in SCHED_FIFO con la priorità data e legato a una CPU. SCHED_RESET_ON_FORK:
+// thread e processi creati dopo tornano allo scheduler normale. priority 0 o cpu < 0 lo disattivano.
+bool enterRealtime(int cpu, int priority);
+// Sposta il thread (o il processo appena creato con fork) sulle CPU diverse da quella del ciclo
+// in tempo reale. Usa solo una syscall: si può chiamare nel figlio tra fork ed exec.
+void leaveRealtimeCpu();
+// Thread di servizio con una cadenza da rispettare (sensori): fuori dalla CPU del ciclo e, con
+// priority > 0, SCHED_FIFO a quella priorità, da tenere sotto quella del ciclo. I thread nascono
+// in SCHED_OTHER per SCHED_RESET_ON_FORK, quindi la priorità va data esplicitamente.
+bool enterHelperRealtime(int priority);
+// CPU su cui può girare il thread o processo id (0: il chiamante), es. "0-2"; "?" se non leggibile
+std::string cpuAffinityList(pid_t id);
+// Socket di ricezione a bassa latenza: busy poll del driver per busy_poll_us, buffer di ricezione
+// piccolo (i comandi vecchi si scartano invece di accodarsi), SO_PRIORITY e DSCP EF in uscita.
+// Ritorna false se una delle opzioni non è stata accettata; le altre restano applicate.
+bool tuneLowLatencySocket(int fd, int busy_poll_us, int rcvbuf_bytes);
+
+#endif // RRC_REACTOR_HPP
@@ -0,0 +1,45 @@
+#ifndef RRC_RECORD_HPP
+#define RRC_RECORD_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Scrive l'H.264 già codificato in un file Matroska, senza ricodifica.
+// Segment e Cluster hanno dimensione ignota: il file resta leggibile anche se la scrittura
+// si interrompe a metà (spegnimento, SD rimossa), a differenza di un MP4 senza moov.
+class MkvWriter {
+public:
+    // Intestazione del file; il keyframe deve contenere SPS e PPS (rpicam-vid --inline).
+    bool begin(const uint8_t *keyframe, size_t len, uint16_t width, uint16_t height, std::vector<uint8_t> &out);
+    // Frame Annex-B convertito in formato AVCC (NAL preceduti dalla lunghezza)
+    void addFrame(const uint8_t *frame, size_t len, bool keyframe, uint64_t capture_us, std::vector<uint8_t> &out);
+
+    // SPS dell'ultimo keyframe visto: se cambia (nuova risoluzione) serve un nuovo file
+    static bool extractParameterSets(const uint8_t *frame, size_t len, std::vector<uint8_t> &sps,
+                                     std::vector<uint8_t> &pps);
+    const std::vector<uint8_t> &sps() const { return sps_; }
+
+private:
+    static constexpr uint64_t MAX_CLUSTER_MS = 30000; // Il timecode relativo dei blocchi è a 16 bit
+
+    std::vector<uint8_t> sps_;
+    std::vector<uint8_t> pps_;
+    std::vector<uint8_t> block_;
+    bool have_start_ = false;
+    uint64_t start_us_ = 0;
+    bool cluster_open_ = false;
+    uint64_t cluster_ms_ = 0;
+};
+
+struct RecorderStats {
+    bool active = false;
+    uint64_t frames_written = 0;
+    uint64_t frames_dropped = 0; // Coda piena o SD troppo lenta: si riparte dal keyframe successivo
+    uint64_t bytes_written = 0;
+    uint64_t segments = 0;
+    uint64_t max_write_us = 0;   // Scrittura più lenta di un blocco sulla SD
+};
+
+#endif // RRC_RECORD_HPP
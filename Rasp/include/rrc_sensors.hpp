@@ -0,0 +1,82 @@
+#ifndef RRC_SENSORS_HPP
+#define RRC_SENSORS_HPP
+
+#include <cstdint>
+#include <string>
+
+// Sensori di bordo letti a frequenza fissa su un thread dedicato, mai su quello che scrive i PWM:
+// una lettura I2C lenta o bloccata non ritarda gli attuatori. I campioni passano al ciclo dei
+// comandi su un anello SPSC, svuotato a ogni tick di telemetria.
+enum SensorSource {
+    SENSORS_OFF,
+    SENSORS_FIRMWARE, // Solo i flag di alimentazione del firmware del Pi, a 1 Hz
+    SENSORS_I2C,      // IMU MPU-6050 e ADC ADS1115 della batteria sul bus I2C, più i flag del firmware
+    SENSORS_SIM,      // Solo make sim: IMU, batteria e alimentazione ricavati dal veicolo simulato
+};
+
+enum SensorFlags : uint8_t {
+    SENSOR_IMU = 1,
+    SENSOR_BATTERY = 2,
+    SENSOR_WHEEL = 4,
+    SENSOR_POWER = 8,
+};
+
+// Bit di get_throttled del firmware (vcgencmd get_throttled)
+constexpr uint32_t POWER_UNDERVOLTAGE_NOW = 1u << 0;
+constexpr uint32_t POWER_THROTTLED_NOW = 1u << 2;
+constexpr uint32_t POWER_UNDERVOLTAGE_SINCE_BOOT = 1u << 16;
+
+struct SensorSample {
+    uint64_t stamp_us = 0;       // monotonicMicros() della lettura
+    uint8_t flags = 0;           // Campi validi in questo campione
+    float accel_long_m_s2 = 0;   // Positiva in avanti
+    float accel_lat_m_s2 = 0;    // Positiva verso destra
+    float yaw_rate_rad_s = 0;    // Positiva in senso orario
+    float wheel_speed_m_s = 0;
+    uint16_t battery_mv = 0;
+    uint32_t power_flags = 0;
+};
+
+// Vista del ciclo dei comandi, aggiornata da pollSensors
+struct SensorSnapshot {
+    uint64_t imu_stamp_us = 0;     // 0: mai arrivato
+    uint64_t battery_stamp_us = 0;
+    uint64_t wheel_stamp_us = 0;
+    double accel_long_m_s2 = 0.0;
+    double accel_lat_m_s2 = 0.0;
+    double yaw_rate_rad_s = 0.0;
+    double wheel_speed_m_s = 0.0;
+    int battery_mv = 0;
+    uint64_t power_stamp_us = 0;
+    uint32_t power_flags = 0;
+    double peak_accel_m_s2 = 0.0;  // Picco del modulo dall'ultima pollSensors, a piena frequenza
+};
+
+struct SensorStats {
+    SensorSource source = SENSORS_OFF;
+    int rate_hz = 0;
+    uint64_t samples = 0;
+    uint64_t dropped = 0;      // Anello pieno: il ciclo dei comandi non svuota
+    uint64_t read_errors = 0;
+    uint64_t overruns = 0;     // Letture più lunghe del periodo
+    uint64_t max_read_us = 0;
+};
+
+bool parseSensorSource(const std::string &name, SensorSource &source);
+const char *sensorSourceName(SensorSource source);
+
+// Avvia il thread dei sensori con i valori di avvio della configurazione; false se l'hardware
+// non risponde (il server continua senza sensori). rt_priority > 0: SCHED_FIFO a quella priorità,
+// 0: scheduler normale.
+bool startSensors(SensorSource source, int rt_priority);
+void stopSensors();
+
+// Solo thread dei comandi: svuota l'anello e ritorna lo stato aggiornato
+const SensorSnapshot &pollSensors();
+// Solo thread dei comandi: lo stato dell'ultima pollSensors, senza svuotare
+const SensorSnapshot &sensorSnapshot();
+// Campione più recente di max_age_us, altrimenti il sensore va considerato assente
+bool sensorFresh(uint64_t stamp_us, uint64_t now_us, uint64_t max_age_us);
+SensorStats sensorStats();
+
+#endif // RRC_SENSORS_HPP
@@ -0,0 +1,20 @@
+#ifndef RRC_SIMGPIO_HPP
+#define RRC_SIMGPIO_HPP
+
+// Sostituto di wiringPi per la build di simulazione (make sim): stesse funzioni, nessun
+// accesso all'hardware. I valori PWM scritti restano leggibili con simPwmRead().
+
+#define PWM_OUTPUT 2
+#define PWM_MODE_MS 0
+
+int wiringPiSetup();
+void pinMode(int pin, int mode);
+void pwmSetMode(int mode);
+void pwmSetRange(unsigned int range);
+void pwmSetClock(int divisor);
+void pwmWrite(int pin, int value);
+void delay(unsigned int ms);
+
+int simPwmRead(int pin);
+
+#endif // RRC_SIMGPIO_HPP
@@ -0,0 +1,83 @@
+#ifndef RRC_SIMVEHICLE_HPP
+#define RRC_SIMVEHICLE_HPP
+
+#include <cstdint>
+#include "rrc_config.hpp"
+
+// Auto simulata per la build senza hardware (make sim): legge gli impulsi di servo ed ESC
+// un frame PWM alla volta, come l'hardware vero, e integra posizione, rotta e velocità.
+
+// ESC bidirezionale in modalità avanti/freno/retromarcia. Dopo la marcia avanti il primo
+// impulso sotto il neutro frena soltanto; la retromarcia parte solo dopo almeno un impulso
+// in folle seguito da un secondo impulso sotto il neutro (il "doppio tocco"). Dopo
+// esc_arm_window_ms di folle l'armamento decade e si torna a frenare.
+class SimEsc {
+public:
+    enum State { NEUTRAL, FORWARD, BRAKE, REVERSE_ARMED, REVERSE };
+
+    // Un frame PWM lungo frame_s secondi
+    State onPulse(int pulse_us, const RuntimeConfig &config, double frame_s);
+    State state() const { return state_; }
+    void reset() { state_ = NEUTRAL; armed_s_ = 0.0; }
+
+private:
+    State state_ = NEUTRAL;
+    double armed_s_ = 0.0; // Folle trascorso in REVERSE_ARMED
+};
+
+const char *simEscStateName(SimEsc::State state);
+
+struct SimVehicleState {
+    double x_m = 0.0;          // Est
+    double y_m = 0.0;          // Nord
+    double heading_rad = 0.0;  // 0 verso nord, positiva in senso orario (sterzando a destra cresce)
+    double speed_m_s = 0.0;    // Negativa in retromarcia
+    double wheel_speed_m_s = 0.0; // Ruote motrici: più veloci dell'auto quando slittano
+    double steer_rad = 0.0;    // Angolo delle ruote anteriori, positivo a destra
+    double accel_long_m_s2 = 0.0;
+    double accel_lat_m_s2 = 0.0; // Positiva verso destra
+    SimEsc::State esc = SimEsc::NEUTRAL;
+};
+
+// Modello cinematico a bicicletta di un'auto 1:10: servo con velocità limitata, motore e freno
+// del primo ordine, sottosterzo quando la curva chiede più aderenza di quella delle gomme e
+// ruote che pattinano quando il motore spinge più di quanto le gomme trasmettono.
+// Poche operazioni in virgola mobile per passo.
+class VehicleModel {
+public:
+    static constexpr double WHEELBASE_M = 0.26;
+    static constexpr double MAX_STEER_RAD = 0.45;      // Circa 26° a fine corsa
+    static constexpr double SERVO_RATE_RAD_S = 5.0;    // Servo standard: ~0.12 s per 60°
+    static constexpr double MAX_SPEED_M_S = 10.0;      // Fondo scala, ~36 km/h
+    static constexpr double ACCEL_TAU_S = 0.6;
+    static constexpr double COAST_TAU_S = 2.5;         // Rotolamento in folle
+    static constexpr double MAX_BRAKE_M_S2 = 8.0;      // Freno a fondo
+    static constexpr double REVERSE_SCALE = 0.4;       // L'ESC limita la retromarcia
+    static constexpr double MAX_LATERAL_M_S2 = 9.0;    // Aderenza delle gomme, circa 0.9 g
+    static constexpr double MAX_TRACTION_M_S2 = 6.0;   // Spinta massima delle sole ruote motrici
+    static constexpr double SLIP_TAU_S = 0.1;          // Le gomme riportano le ruote alla velocità dell'auto
+
+    // Un frame PWM: impulsi applicati per dt_s secondi
+    void step(int steering_us, int throttle_us, const RuntimeConfig &config, double dt_s);
+    const SimVehicleState &state() const { return state_; }
+    void reset();
+
+private:
+    SimEsc esc_;
+    SimVehicleState state_;
+};
+
+// Lato server (thread dei comandi): avanza il modello di un frame con i PWM scritti sui pin
+// simulati e pubblica la posa per la vista dall'alto
+const SimVehicleState &stepSimVehicle(double dt_s);
+const SimVehicleState &simVehicleState();
+// Dal thread dei sensori: ultima posa pubblicata, senza toccare il modello; false prima del primo passo
+bool readSimVehicle(SimVehicleState &state);
+
+// Processo video interno (--sim-view): disegna l'auto vista dall'alto con la posa pubblicata
+// dal server e la codifica in H.264 con ffmpeg sullo stdout. Nel processo figlio initConfig non
+// gira e activeConfig() darebbe solo i default: tutto ciò che serve arriva dalla riga di comando
+// (dimensioni, fps, bitrate) o dalla posa condivisa, già calcolata con la configurazione del server.
+int runSimView(int width, int height, int framerate, int bitrate);
+
+#endif // RRC_SIMVEHICLE_HPP
@@ -0,0 +1,45 @@
+#ifndef RRC_SPSC_HPP
+#define RRC_SPSC_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Anello a un produttore e un consumatore, senza lock né allocazioni: ognuno dei due lati
+// scrive solo il proprio indice. Capacity deve essere una potenza di due; T copiabile banalmente.
+// Pieno, push scarta il nuovo elemento: chi legge vede un buco invece di bloccare chi scrive.
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity deve essere una potenza di due");
+
+public:
+    // Solo il produttore
+    bool push(const T &item) {
+        const uint64_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        items_[head & (Capacity - 1)] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Solo il consumatore
+    bool pop(T &item) {
+        const uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items_[tail & (Capacity - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    // Indici su linee di cache diverse: produttore e consumatore non se le contendono
+    alignas(64) std::atomic<uint64_t> head_{0};
+    alignas(64) std::atomic<uint64_t> tail_{0};
+    alignas(64) T items_[Capacity];
+};
+
+#endif // RRC_SPSC_HPP
@@ -0,0 +1,53 @@
+#ifndef RRC_TRACTION_HPP
+#define RRC_TRACTION_HPP
+
+#include <cstdint>
+#include "rrc_config.hpp"
+
+// Stato di moto dell'auto per il controllo di trazione. Ogni sorgente riempie ciò che misura:
+// il modello della simulazione tutto, un IMU l'accelerazione, un sensore sulle ruote la loro
+// velocità; senza sensori resta la stima della velocità dal comando motore.
+struct VehicleMotion {
+    uint64_t stamp_us = 0;          // monotonicMicros() del campione, 0 se non ce n'è ancora
+    double speed_m_s = 0.0;         // Velocità dell'auto, negativa in retromarcia
+    bool speed_estimated = true;    // Stimata dal comando motore invece che misurata
+    bool has_accel = false;
+    double accel_long_m_s2 = 0.0;
+    bool has_wheel_speed = false;
+    double wheel_speed_m_s = 0.0;   // Ruote motrici
+};
+
+// Modella il comando del pilota prima dell'ESC e del servo: rampa di partenza da fermo, taglio
+// del gas quando l'accelerazione supera il limite o le ruote pattinano, velocità dello sterzo
+// che cala con la velocità dell'auto. Ridurre il gas non è mai rallentato. Poche operazioni in
+// virgola mobile per chiamata, sul thread dei comandi.
+class TractionControl {
+public:
+    // driving: impulso di marcia (avanti o retromarcia); freno e folle passano invariati e azzerano la rampa
+    int shapeThrottle(int pulse_us, bool driving, uint64_t now_us, const VehicleMotion &motion,
+                      const RuntimeConfig &config);
+    int shapeSteering(int pulse_us, uint64_t now_us, const VehicleMotion &motion, const RuntimeConfig &config);
+    // Uscite ancora lontane dalla richiesta: vanno riapplicate a ogni frame PWM anche senza comandi
+    bool pending() const { return throttle_limited_ || steering_limited_; }
+    // Dopo un folle forzato: gas da zero, servo fermo in steering_us
+    void reset(int steering_us);
+
+    uint64_t cuts() const { return cuts_; }          // Tagli per accelerazione o pattinamento
+    uint64_t launches() const { return launches_; }  // Partenze da fermo con la rampa
+
+private:
+    double throttle_us_ = 0.0;       // Distanza dal neutro dell'ultimo impulso di marcia
+    uint64_t throttle_at_us_ = 0;
+    bool forward_ = true;
+    uint64_t motion_seen_us_ = 0;    // Ultimo campione già usato per un taglio
+    bool throttle_limited_ = false;
+    bool recovering_ = false;        // Dopo un taglio il gas risale con la rampa
+    bool launching_ = false;
+    double steering_us_ = -1.0;
+    uint64_t steering_at_us_ = 0;
+    bool steering_limited_ = false;
+    uint64_t cuts_ = 0;
+    uint64_t launches_ = 0;
+};
+
+#endif // RRC_TRACTION_HPP
@@ -1,51 +1,472 @@
 #include "../include/rrc_rasp.hpp"
+#include "../include/rrc_reactor.hpp"
+#include <condition_variable>
+#include <cstring>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sstream>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <vector>
 
-void startVideoStream(struct sockaddr_in &client_addr) {
+static VideoTier video_tier = {4000000, 1280, 720, 30}; // Protetto da stream_mutex
+#ifdef RRC_SIMULATION
+static VideoSource video_source = SOURCE_SYNTHETIC; // In simulazione non c'è la telecamera
+#else
+static VideoSource video_source = SOURCE_CAMERA;
+#endif
+
+bool parseVideoSource(const std::string &text, VideoSource &out) {
+    if (text == "camera") {
+        out = SOURCE_CAMERA;
+    } else if (text == "testsrc") {
+        out = SOURCE_TESTSRC;
+    } else if (text == "synthetic") {
+        out = SOURCE_SYNTHETIC;
+#ifdef RRC_SIMULATION
+    } else if (text == "simview") {
+        out = SOURCE_SIMVIEW;
+#endif
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void setVideoSource(VideoSource source) {
+    std::lock_guard<std::mutex> lock(stream_mutex);
+    video_source = source;
+}
+
+// Argomenti del processo che scrive l'H.264 su stdout. Nessuna shell: il PID è quello dell'encoder
+static std::vector<std::string> buildVideoCommand(const VideoTier &tier, VideoSource source,
+                                                  const std::string &camera_command) {
+    const std::string fps = std::to_string(tier.framerate);
+    const std::string bitrate = std::to_string(tier.bitrate);
+
+    if (source == SOURCE_SYNTHETIC || source == SOURCE_SIMVIEW) {
+        char self[512];
+        ssize_t len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+        self[len > 0 ? len : 0] = '\0';
+        if (source == SOURCE_SIMVIEW) {
+            return {self, "--sim-view", std::to_string(tier.width), std::to_string(tier.height), fps, bitrate};
+        }
+        return {self, "--synthetic-video", bitrate, fps};
+    }
+    if (source == SOURCE_TESTSRC) {
+        return {"ffmpeg", "-loglevel", "quiet", "-re", "-f", "lavfi", "-i",
+                "testsrc2=size=" + std::to_string(tier.width) + "x" + std::to_string(tier.height) + ":rate=" + fps,
+                "-c:v", "libx264", "-preset", "ultrafast", "-tune", "zerolatency", "-g", fps, "-b:v", bitrate,
+                "-f", "h264", "-"};
+    }
+
+    // Programma e opzioni della configurazione (es. "rpicam-vid --hflip --vflip"), separati da spazi.
+    // --flush evita che l'ultimo frame resti nel buffer di stdio.
+    // --intra pari al framerate: un keyframe al secondo per recuperare dopo un frame perso.
+    std::vector<std::string> args;
+    std::istringstream words(camera_command);
+    for (std::string word; words >> word;) {
+        args.push_back(word);
+    }
+    args.insert(args.end(), {"-t", "0", "--inline", "--flush", "--nopreview",
+                             "--width", std::to_string(tier.width), "--height", std::to_string(tier.height),
+                             "--framerate", fps, "--intra", fps, "--bitrate", bitrate, "-o", "-"});
+    return args;
+}
+
+constexpr uint64_t HEALTH_PERIOD_US = 100000;  // Controllo di stallo e scadenza del backoff
+constexpr uint64_t STARTUP_GRACE_MS = 5000;    // rpicam-vid impiega circa un secondo a produrre il primo frame
+constexpr uint64_t STALL_MS = 2000;            // Nessun byte dall'encoder per questo tempo: processo bloccato
+constexpr uint64_t BACKOFF_MIN_MS = 250;
+constexpr uint64_t BACKOFF_MAX_MS = 10000;
+constexpr uint64_t STABLE_MS = 10000;          // Dopo questo tempo senza problemi il backoff riparte dal minimo
+
+// Supervisore del processo video. Gira tutto sul thread dei comandi, guidato dal reactor:
+// l'uscita del processo arriva dal pidfd (o da waitid sul timer, se pidfd_open manca), stallo e
+// backoff da un timer. Avvio del processo
+// e join dei relay terminati sono delegati al thread di avvio, quindi nessuna chiamata
+// del supervisore attende, tranne shutdownVideoStream all'uscita del programma.
+enum VideoState {
+    VIDEO_STOPPED,
+    VIDEO_STARTING, // Richiesta inviata al thread di avvio
+    VIDEO_RUNNING,
+    VIDEO_STOPPING, // Ucciso, in attesa che il pidfd ne segnali l'uscita
+    VIDEO_BACKOFF,  // Terminato per un errore, in attesa del riavvio
+};
+
+static Reactor *video_reactor = nullptr;
+static VideoState video_state = VIDEO_STOPPED;
+static bool video_wanted = false;       // Il client vuole il video: dopo un'uscita si riavvia
+static bool video_restart = false;      // Nuovo client o livello arrivato durante l'avvio
+static bool video_failed_exit = false;  // L'uscita in corso è dovuta a uno stallo
+static struct sockaddr_in video_dest{};
+static pid_t video_pid = -1;
+static int video_pidfd = -1;
+static uint64_t video_started_us = 0;
+static uint64_t video_restart_at_us = 0;
+static unsigned video_failures = 0;     // Errori consecutivi: esponente del backoff
+static std::atomic<uint64_t> video_output_us{0}; // Ultima lettura dalla pipe, scritta dal relay
+static VideoSupervisorStats video_stats;
+
+// Thread di avvio: posix_spawn (clone con CLONE_VFORK, nessuna copia delle tabelle delle pagine),
+// creazione del relay e join dei relay terminati. Il risultato torna al reactor tramite eventfd.
+struct LaunchResult {
+    pid_t pid = -1;
+    int pidfd = -1;
+    uint64_t spawn_us = 0; // Durata di posix_spawn sul thread di avvio
+};
+
+static std::mutex launcher_mutex;
+static std::condition_variable launcher_cv;
+static std::thread launcher_thread;
+static int launcher_event_fd = -1;
+static bool launcher_quit = false;
+static bool launch_pending = false;
+static std::vector<std::string> launch_argv;
+static struct sockaddr_in launch_dest{};
+static VideoTier launch_tier{};
+static bool launch_done = false;
+static LaunchResult launch_result;
+static std::vector<std::thread> retired_relays; // Relay di processi terminati, da unire
+static std::thread relay_thread;                // Relay del processo corrente, posseduto dal thread di avvio
+
+static LaunchResult spawnEncoder(const std::vector<std::string> &args, const struct sockaddr_in &dest,
+                                 const VideoTier &tier) {
+    LaunchResult result;
+    int video_pipe[2];
+    if (pipe2(video_pipe, O_CLOEXEC) < 0) {
+        perror("Creazione pipe video fallita");
+        return result;
+    }
+
+    std::vector<char *> argv;
+    for (const std::string &arg : args) {
+        argv.push_back(const_cast<char *>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    // stdout verso il relay, stdin e stderr su /dev/null; la maschera dei segnali sopravvive
+    // a exec, quindi il figlio parte con tutti i segnali sbloccati
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, video_pipe[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t none;
+    sigemptyset(&none);
+    posix_spawnattr_setsigmask(&attr, &none);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+
+    const uint64_t start = monotonicMicros();
+    const int error = posix_spawnp(&result.pid, argv[0], &actions, &attr, argv.data(), environ);
+    result.spawn_us = monotonicMicros() - start;
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    close(video_pipe[1]);
+
+    if (error != 0) {
+        std::cerr << "Impossibile avviare " << args[0] << ": " << strerror(error) << std::endl;
+        close(video_pipe[0]);
+        result.pid = -1;
+        return result;
+    }
+
+    result.pidfd = static_cast<int>(syscall(SYS_pidfd_open, result.pid, 0));
+    if (result.pidfd < 0) {
+        perror("pidfd_open failed"); // Il supervisore ripiega su waitid dal timer di salute
+    }
+    relay_thread = std::thread(videoRelayLoop, video_pipe[0], dest, tier);
+    return result;
+}
+
+static void launcherLoop() {
+    leaveRealtimeCpu(); // Thread e processi creati da qui restano fuori dalla CPU del ciclo dei comandi
+    std::unique_lock<std::mutex> lock(launcher_mutex);
+    while (true) {
+        launcher_cv.wait(lock, [] { return launcher_quit || launch_pending || !retired_relays.empty(); });
+
+        // Prima i relay terminati: due relay non girano mai insieme (condividono il packetizer)
+        std::vector<std::thread> relays;
+        relays.swap(retired_relays);
+        const bool pending = launch_pending;
+        launch_pending = false;
+        lock.unlock();
+        for (std::thread &relay : relays) {
+            relay.join();
+        }
+        LaunchResult result;
+        if (pending) {
+            result = spawnEncoder(launch_argv, launch_dest, launch_tier);
+        }
+        lock.lock();
+
+        if (pending) {
+            launch_result = result;
+            launch_done = true;
+            const uint64_t one = 1;
+            if (write(launcher_event_fd, &one, sizeof(one)) < 0) {
+                perror("eventfd write failed");
+            }
+        }
+        if (launcher_quit && !launch_pending && retired_relays.empty()) {
+            return;
+        }
+    }
+}
+
+// Misura quanto il supervisore occupa il thread dei comandi in ogni chiamata
+struct ControlStall {
+    uint64_t start = monotonicMicros();
+    ~ControlStall() {
+        video_stats.max_control_stall_us = std::max(video_stats.max_control_stall_us, monotonicMicros() - start);
+    }
+};
+
+void setVideoTier(const VideoTier &tier) {
     std::lock_guard<std::mutex> lock(stream_mutex);
+    video_tier = tier;
+}
 
-    // Prepara il comando per avviare rpicam-vid con streaming su UDP
-    std::string command = "rpicam-vid -t 0 --inline -o udp://" + 
-                          std::string(inet_ntoa(client_addr.sin_addr)) + ":1234" + 
-                          " > /dev/null 2>&1";  // Redirige sia stdout che stderr a /dev/null
-    std::cout << "Address: " << inet_ntoa(client_addr.sin_addr) << std::endl;
-    std::cout << "Port: " << ntohs(client_addr.sin_port) << std::endl;
+void noteVideoOutput() {
+    video_output_us.store(monotonicMicros(), std::memory_order_relaxed);
+}
+
+static void onVideoExit(void *ctx, int fd, uint32_t events);
 
-    // Crea un nuovo processo per lo streaming
-    stream_pid = fork();
+static void requestLaunch() {
+    VideoTier tier;
+    std::vector<std::string> args;
+    {
+        std::lock_guard<std::mutex> lock(stream_mutex);
+        tier = video_tier;
+        args = buildVideoCommand(video_tier, video_source, activeConfig().camera_command);
+    }
+    {
+        std::lock_guard<std::mutex> lock(launcher_mutex);
+        launch_argv.swap(args);
+        launch_dest = video_dest;
+        launch_dest.sin_port = htons(activeConfig().video_port);
+        launch_tier = tier;
+        launch_pending = true;
+    }
+    launcher_cv.notify_one();
+    video_restart = false;
+    video_state = VIDEO_STARTING;
+}
 
-    if (stream_pid == -1) {
-        // Se fork fallisce
-        std::cerr << "Errore nella creazione del processo di streaming!" << std::endl;
+static void killVideo() {
+    std::cout << "Invio del segnale di terminazione al processo di streaming con PID: " << video_pid << std::endl;
+    kill(video_pid, SIGKILL);
+    video_state = VIDEO_STOPPING;
+}
+
+// Il thread di avvio ha finito: il processo entra nella supervisione
+static void onLaunchDone(void *, int fd, uint32_t) {
+    ControlStall stall;
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+        return;
+    }
+    LaunchResult result;
+    {
+        std::lock_guard<std::mutex> lock(launcher_mutex);
+        if (!launch_done) {
+            return;
+        }
+        launch_done = false;
+        result = launch_result;
+    }
+
+    video_pid = result.pid;
+    video_pidfd = result.pidfd;
+    video_output_us.store(0);
+    video_started_us = monotonicMicros();
+    video_failed_exit = false;
+    video_stats.starts++;
+    if (video_pid <= 0) {
+        video_state = VIDEO_RUNNING; // Avvio fallito: gestito come un crash immediato
+        onVideoExit(nullptr, -1, 0);
+        return;
+    }
+    if (video_pidfd >= 0 && !video_reactor->add(video_pidfd, EPOLLIN, onVideoExit, nullptr)) {
+        close(video_pidfd);
+        video_pidfd = -1;
+    }
+    if (video_pidfd < 0) {
+        // Kernel senza pidfd: l'uscita la vede il timer di salute, con al più HEALTH_PERIOD_US di ritardo
+        std::cerr << "Processo video " << video_pid << " controllato con waitid ogni "
+                  << HEALTH_PERIOD_US / 1000 << " ms" << std::endl;
+    }
+    video_state = VIDEO_RUNNING;
+    std::cout << "Streaming avviato con PID: " << video_pid << " (posix_spawn " << result.spawn_us << " µs)" << std::endl;
+
+    // Nel frattempo il client è cambiato, è cambiato il livello o il video non serve più
+    if (!video_wanted || video_restart) {
+        killVideo();
+    }
+}
+
+// Raccoglie il processo già terminato; il relay, che ha ricevuto EOF, viene unito dal thread di avvio
+static void reapVideo(bool wait) {
+    siginfo_t info{};
+    if (video_pid > 0 && waitid(P_PID, video_pid, &info, WEXITED | (wait ? 0 : WNOHANG)) == 0 &&
+        info.si_pid == video_pid) {
+        video_stats.last_exit_signal = info.si_code == CLD_EXITED ? 0 : info.si_status;
+        video_stats.last_exit_code = info.si_code == CLD_EXITED ? info.si_status : 0;
+    }
+    if (video_pidfd >= 0) {
+        video_reactor->remove(video_pidfd);
+        close(video_pidfd);
+        video_pidfd = -1;
+    }
+    video_pid = -1;
+    {
+        std::lock_guard<std::mutex> lock(launcher_mutex);
+        if (relay_thread.joinable()) {
+            retired_relays.push_back(std::move(relay_thread));
+        }
+    }
+    launcher_cv.notify_one();
+}
+
+static void onVideoExit(void *, int, uint32_t) {
+    ControlStall stall;
+    const bool failure = video_state == VIDEO_RUNNING || video_failed_exit;
+    const uint64_t now_us = monotonicMicros();
+    const uint64_t uptime_ms = (now_us - video_started_us) / 1000;
+    reapVideo(false);
+
+    if (!failure) {
+        std::cout << "Streaming terminato." << std::endl;
+        video_state = VIDEO_STOPPED;
+        if (video_wanted) {
+            requestLaunch(); // Riavvio richiesto: nuovo livello dell'encoder o nuovo client
+        }
         return;
-    } else if (stream_pid == 0) {
-        // Codice del processo figlio (streaming)
-        // Usa execlp per eseguire il comando di streaming
-        execlp("sh", "sh", "-c", command.c_str(), (char*)NULL);
-
-        // Se execlp fallisce
-        std::cerr << "Errore nell'esecuzione del comando di streaming!" << std::endl;
-        exit(EXIT_FAILURE);
+    }
+
+    // Errore: riavvio con attesa esponenziale, azzerata se il processo era rimasto su a lungo
+    if (video_state == VIDEO_RUNNING) {
+        video_stats.crashes++;
+    }
+    video_failures = uptime_ms >= STABLE_MS ? 1 : video_failures + 1;
+    const uint64_t backoff_ms = std::min(BACKOFF_MIN_MS << std::min(video_failures - 1, 16u), BACKOFF_MAX_MS);
+    video_restart_at_us = now_us + backoff_ms * 1000;
+    video_state = video_wanted ? VIDEO_BACKOFF : VIDEO_STOPPED;
+    std::cerr << "Processo video terminato dopo " << uptime_ms << " ms (";
+    if (video_stats.last_exit_signal != 0) {
+        std::cerr << "segnale " << video_stats.last_exit_signal;
     } else {
-        // Codice del processo padre (continua l'esecuzione normalmente)
-        std::cout << "Streaming avviato con PID: " << stream_pid << std::endl;
+        std::cerr << "uscita " << video_stats.last_exit_code;
     }
+    std::cerr << ")" << (video_wanted ? ", riavvio tra " + std::to_string(backoff_ms) + " ms" : "") << std::endl;
+}
+
+// Senza pidfd: il processo è uscito? WNOWAIT lascia a reapVideo la raccolta dello stato
+static bool videoExitedPolled() {
+    siginfo_t info{};
+    return video_pid > 0 && video_pidfd < 0 &&
+           waitid(P_PID, video_pid, &info, WEXITED | WNOHANG | WNOWAIT) == 0 && info.si_pid == video_pid;
 }
 
+static void onVideoHealth(void *, int, uint32_t) {
+    const uint64_t now_us = monotonicMicros();
+    if ((video_state == VIDEO_RUNNING || video_state == VIDEO_STOPPING) && videoExitedPolled()) {
+        onVideoExit(nullptr, -1, 0);
+    } else if (video_state == VIDEO_BACKOFF && now_us >= video_restart_at_us) {
+        ControlStall stall;
+        video_stats.restarts++;
+        requestLaunch();
+    } else if (video_state == VIDEO_RUNNING) {
+        // Un encoder vivo ma muto (telecamera bloccata, driver in errore) non esce da solo
+        const uint64_t output_us = video_output_us.load(std::memory_order_relaxed);
+        const uint64_t since_us = output_us != 0 ? output_us : video_started_us;
+        const uint64_t limit_ms = output_us != 0 ? STALL_MS : STARTUP_GRACE_MS;
+        if (now_us > since_us && now_us - since_us >= limit_ms * 1000) {
+            std::cerr << "Processo video fermo da " << (now_us - since_us) / 1000 << " ms" << std::endl;
+            video_stats.stalls++;
+            video_failed_exit = true;
+            killVideo();
+        }
+    }
+}
+
+void initVideoSupervisor(Reactor &reactor) {
+    video_reactor = &reactor;
+    launcher_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (launcher_event_fd < 0 || !reactor.add(launcher_event_fd, EPOLLIN, onLaunchDone, nullptr) ||
+        reactor.addTimer(HEALTH_PERIOD_US, onVideoHealth, nullptr) < 0) {
+        std::cerr << "Supervisione del video non disponibile" << std::endl;
+    }
+    launcher_thread = std::thread(launcherLoop);
+}
+
+// Video verso client_addr; se è già attivo il processo viene riavviato (nuovo client o nuovo livello)
+void startVideoStream(const struct sockaddr_in &client_addr) {
+    ControlStall stall;
+    video_wanted = true;
+    video_dest = client_addr;
+    if (video_state == VIDEO_STOPPED) {
+        requestLaunch();
+    } else if (video_state == VIDEO_STARTING) {
+        video_restart = true; // Riavviato appena l'avvio in corso termina
+    } else if (video_state == VIDEO_RUNNING) {
+        killVideo(); // Il riavvio parte quando il pidfd segnala l'uscita
+    }
+    // In arresto o in backoff: ripartirà da solo verso il nuovo indirizzo
+}
+
+// Non attende il processo: l'uscita viene raccolta dal reactor
 void stopVideoStream() {
-    stop_streaming.store(true);  // Imposta il flag di stop a true
-
-    // Se il processo di streaming è attivo, invia un segnale di terminazione
-    if (stream_pid != -1) {
-        std::cout << "Invio del segnale di terminazione al processo di streaming con PID: " << stream_pid << std::endl;
-        kill(stream_pid, SIGKILL);  // Invia SIGTERM al processo di streaming
-        waitpid(stream_pid, nullptr, 0);  // Attendi la terminazione del processo figlio
-        stream_pid = -1;  // Resetta il PID del processo
+    ControlStall stall;
+    video_wanted = false;
+    if (video_state == VIDEO_RUNNING) {
+        killVideo();
+    } else if (video_state == VIDEO_BACKOFF) {
+        video_state = VIDEO_STOPPED;
+    }
+    // VIDEO_STARTING: il processo viene ucciso appena l'avvio termina
+}
+
+// All'uscita del programma: attende l'avvio in corso, la fine del processo e dei relay
+void shutdownVideoStream() {
+    video_wanted = false;
+    {
+        std::unique_lock<std::mutex> lock(launcher_mutex);
+        launcher_quit = true;
+    }
+    launcher_cv.notify_one();
+    if (launcher_thread.joinable()) {
+        launcher_thread.join();
+    }
+    if (launch_done) {
+        launch_done = false;
+        video_pid = launch_result.pid;
+        video_pidfd = launch_result.pidfd;
+    }
+    if (video_pid > 0) {
+        kill(video_pid, SIGKILL);
+        reapVideo(true);
         std::cout << "Streaming terminato." << std::endl;
     }
+    if (relay_thread.joinable()) {
+        relay_thread.join();
+    }
+    for (std::thread &relay : retired_relays) {
+        relay.join();
+    }
+    retired_relays.clear();
+    video_state = VIDEO_STOPPED;
 }
 
-void signalHandler(int signum) {
-    std::cout << "Interrupt signal (" << signum << ") received.\n";
-    stopVideoStream();  // Ferma lo streaming
-    exit(signum);
+VideoSupervisorStats videoSupervisorStats() {
+    VideoSupervisorStats stats = video_stats;
+    stats.pid = video_state == VIDEO_RUNNING ? video_pid : -1;
+    stats.uptime_ms = video_state == VIDEO_RUNNING ? (monotonicMicros() - video_started_us) / 1000 : 0;
+    const uint64_t now_us = monotonicMicros();
+    stats.backoff_ms = video_state == VIDEO_BACKOFF && video_restart_at_us > now_us ? (video_restart_at_us - now_us) / 1000 : 0;
+    return stats;
 }
@@ -1,23 +1,37 @@
 #include "../include/rrc_rasp.hpp"
+#include "../include/rrc_lease.hpp"
+#include "../include/rrc_reactor.hpp"
+#include "../include/rrc_esc.hpp"
+#include "../include/rrc_power.hpp"
+#ifdef RRC_SIMULATION
+# include "../include/rrc_simvehicle.hpp"
+#endif
 #include <cerrno>
 #include <cstdio>
 #include <algorithm>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/un.h>
+#include <cstring>
+#include <linux/errqueue.h>
+#include <sstream>
 
 // Funzione di mappatura di un valore da un intervallo all'altro
 int map(int x, int in_min, int in_max, int out_min, int out_max) {
     return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
 }
 
-constexpr int PWM_MIN_US = 1000;     // Retromarcia massima
-constexpr int PWM_MAX_US = 2000;     // Avanti massima
-constexpr int PWM_NEUTRAL_US = 1500; // Punto neutro centrale
-constexpr int PWM_DEAD_LOW = 1485;   // Dead zone
-constexpr int PWM_DEAD_HIGH = 1515;
+// Limiti PWM, dead zone e pin arrivano dalla configurazione (rrc_config.hpp)
+constexpr uint64_t VIDEO_IDLE_MS = 5000; // Senza lease per questo tempo il video si ferma
+constexpr uint64_t LEASE_TICK_US = 20000; // Controllo della scadenza del lease, un frame PWM
+constexpr int DATAGRAM_BURST = 32;        // Datagrammi letti per risveglio: il socket non affama timer e segnali
+constexpr uint64_t PWM_FRAME_US = 20000; // Un periodo PWM a 50 Hz: limite per mettere in folle all'arresto
 
 void setupGPIO() {
+    const RuntimeConfig &config = activeConfig();
     wiringPiSetup();
-    pinMode(SERVO_PIN, PWM_OUTPUT);
-    pinMode(MOTOR_PIN, PWM_OUTPUT);
+    pinMode(config.servo_pin, PWM_OUTPUT);
+    pinMode(config.motor_pin, PWM_OUTPUT);
     
     // Impostiamo il PWM a ~50Hz con risoluzione a microsecondi (range 0-20000).
     // 19.2MHz / (clock * range) = frequenza; clock=19, range=20000 -> ~50.5Hz.
@@ -28,104 +42,743 @@ void setupGPIO() {
 
 void initializeControlSystems() {
     // Inizializza il servo motore (sterzo) e il motore (acceleratore/freno) con i valori di base
+    const RuntimeConfig &config = activeConfig();
     std::cout << "Inizializzazione del sistema di controllo..." << std::endl;
 
     // Impostiamo il servo a una posizione neutra (1500µs) e il motore al neutro ESC
-    pwmWrite(SERVO_PIN, PWM_NEUTRAL_US);
+    pwmWrite(config.servo_pin, config.pwm_neutral_us);
     delay(500); // Attesa per stabilizzare il servo
 
-    pwmWrite(MOTOR_PIN, PWM_NEUTRAL_US); // ESC neutro
+    pwmWrite(config.motor_pin, config.pwm_neutral_us); // ESC neutro
     delay(500); // Attesa per stabilizzare il motore
 
     std::cout << "Sistema di controllo inizializzato." << std::endl;
 }
 
-void handleCommand(int server_fd) {
-    char buffer[1024];
-    struct sockaddr_in client_addr{};
-    socklen_t client_len = sizeof(client_addr);
-    struct sockaddr_in last_stream_addr{};
+// Risponde alla sincronizzazione dell'orologio con i tempi di ricezione e invio sul Pi
+static void replyTimeSync(int server_fd, const uint8_t *data, size_t len, struct sockaddr_in &client_addr,
+                          uint64_t recv_us) {
+    TimeSync sync;
+    if (!parseTimeSync(data, len, MSG_TIME_REQUEST, sync)) {
+        return;
+    }
+
+    uint8_t reply[TIME_SYNC_SIZE + AUTH_TRAILER_SIZE];
+    sync.server_recv_us = recv_us;
+    sync.server_send_us = monotonicMicros();
+    writeTimeSync(reply, MSG_TIME_REPLY, sync);
+    const size_t reply_len = control_auth.seal(reply, TIME_SYNC_SIZE);
+    sendto(server_fd, reply, reply_len, 0, reinterpret_cast<struct sockaddr *>(&client_addr), sizeof(client_addr));
+}
+
+// Avvia o ferma la registrazione a bordo e risponde con lo stato; la registrazione
+// non dipende dal client e prosegue anche se questo si disconnette o cambia
+static void handleRecordControl(int server_fd, const uint8_t *data, size_t len, struct sockaddr_in &client_addr) {
+    RecordAction action;
+    if (!parseRecordControl(data, len, action)) {
+        return;
+    }
+    if (action == RECORD_TOGGLE) {
+        setRecording(!isRecording());
+    } else if (action != RECORD_QUERY) {
+        setRecording(action == RECORD_START);
+    }
+
+    const RecorderStats stats = recorderStats();
+    RecordStatus status;
+    status.active = stats.active;
+    status.segments = static_cast<uint32_t>(stats.segments);
+    status.frames_written = static_cast<uint32_t>(stats.frames_written);
+    status.frames_dropped = static_cast<uint32_t>(stats.frames_dropped);
+
+    uint8_t reply[RECORD_STATUS_SIZE + AUTH_TRAILER_SIZE];
+    writeRecordStatus(reply, status);
+    const size_t reply_len = control_auth.seal(reply, RECORD_STATUS_SIZE);
+    sendto(server_fd, reply, reply_len, 0, reinterpret_cast<struct sockaddr *>(&client_addr), sizeof(client_addr));
+}
+
+// Sequenza avanti/freno/retromarcia dell'ESC e timer che ne chiude le fasi anche senza nuovi comandi
+static EscSequencer esc_sequencer;
+static Reactor *esc_reactor = nullptr;
+static int esc_timer_fd = -1;
+static int esc_steering_us = 0; // Ultimo sterzo scritto, ripubblicato con il motore
+
+// Ultima richiesta del pilota, riapplicata a ogni frame mentre il controllo di trazione la limita
+static TractionControl traction;
+static EscSequencer::Intent driver_intent = EscSequencer::WANT_NEUTRAL;
+static int driver_throttle_us = 0;
+static int driver_steering_us = 0;
+static PowerMonitor power_monitor;
+
+static void writeThrottle(int throttle_us) {
+    const RuntimeConfig &config = activeConfig();
+    pwmWrite(config.motor_pin, throttle_us);
+    publishActuators(esc_steering_us, throttle_us);
+    if (esc_reactor != nullptr && esc_timer_fd >= 0) {
+        esc_reactor->armTimer(esc_timer_fd, esc_sequencer.deadlineUs(config));
+    }
+}
+
+// Fine del freno minimo, del folle prima della retromarcia o della finestra di armamento dell'ESC
+static void onEscTimer(void *, int, uint32_t) {
+    writeThrottle(esc_sequencer.tick(monotonicMicros(), activeConfig()));
+}
+
+// Richiesta del pilota -> controllo di trazione (se attivo) -> servo e sequenza dell'ESC
+static void actuate(uint64_t now_us) {
+    const RuntimeConfig &config = activeConfig();
+    int steering = driver_steering_us;
+    int throttle = driver_throttle_us;
+    if (config.traction_control) {
+        const VehicleMotion &motion = vehicleMotion();
+        const bool driving = driver_intent == EscSequencer::WANT_FORWARD || driver_intent == EscSequencer::WANT_REVERSE;
+        steering = traction.shapeSteering(steering, now_us, motion, config);
+        throttle = traction.shapeThrottle(throttle, driving, now_us, motion, config);
+    }
+    if (power_monitor.lowPower() && driver_intent != EscSequencer::WANT_BRAKE) {
+        // Meno corrente dal motore, meno caduta di tensione sul BEC del Pi; il freno resta pieno
+        const int neutral = config.pwm_neutral_us;
+        const int cap = (std::max(config.pwm_max_us - neutral, neutral - config.pwm_min_us) *
+                         config.low_power_throttle_pct) / 100;
+        throttle = std::clamp(throttle, neutral - cap, neutral + cap);
+    }
+    pwmWrite(config.servo_pin, steering);
+    esc_steering_us = steering;
+    writeThrottle(esc_sequencer.request(driver_intent, throttle, now_us, config));
+}
+
+static ControlState last_control;  // Ultimo comando applicato, per lo status
+static uint64_t mode_changes = 0;
+
+// Il paddle è un fronte: una pressione breve va applicata anche se arriva solo nella storia
+static bool applyPaddle(int paddle) {
+    const Mode mode = paddle == 1 ? DRIVE : paddle == -1 ? REVERSE : currentMode;
+    if (mode == currentMode) {
+        return false;
+    }
+    currentMode = mode;
+    mode_changes++;
+    std::cout << "Modalità: " << (mode == DRIVE ? "DRIVE" : "REVERSE") << std::endl;
+    return true;
+}
+
+// Applica i comandi del volante ai PWM di servo e ESC
+static void applyControls(const ControlFrame &control) {
+    const RuntimeConfig &config = activeConfig();
+    const int pwm_min = config.pwm_min_us;
+    const int pwm_max = config.pwm_max_us;
+    const int neutral = config.pwm_neutral_us;
+    const int steering = control.steering;
+    const int accelerator = control.accelerator;
+    const int brake = control.brake;
+    const int paddle = control.paddle;
+
+    // Niente stampa per comando sul thread SCHED_FIFO: l'ultimo comando lo riporta lo status
+    last_control = ControlState{control.steering, control.accelerator, control.brake, control.paddle};
+    // Mappiamo i valori joystick (0-1999) nei microsecondi richiesti dall'ESC/servo.
+    int steeringPWM = std::clamp(map(steering, 0, 1999, pwm_min, pwm_max), pwm_min, pwm_max);
+    int forwardPWM = std::clamp(map(accelerator, 0, 1999, neutral, pwm_max), neutral, pwm_max);
+    int brakePWM = std::clamp(map(brake, 0, 1999, neutral, pwm_min), pwm_min, neutral);
+    int reversePWM = std::clamp(map(accelerator, 0, 1999, neutral, pwm_min), pwm_min, neutral);
+
+    applyPaddle(paddle);
+
+    // Logica ESC bidirezionale:
+    // - 1000µs: retromarcia massima
+    // - 1500µs: neutro (dead zone ~1485-1515)
+    // - 2000µs: avanti massima
+    // La retromarcia passa sempre da freno e folle con le durate minime di EscSequencer.
+    EscSequencer::Intent intent = EscSequencer::WANT_NEUTRAL;
+    int pulse = neutral;
+    if (brake > 15) { // Piccola soglia per evitare rumore sui pedali
+        intent = EscSequencer::WANT_BRAKE;
+        pulse = brakePWM;
+    } else if (accelerator > 15 && currentMode == DRIVE) {
+        intent = EscSequencer::WANT_FORWARD;
+        pulse = forwardPWM;
+    } else if (accelerator > 15 && currentMode == REVERSE) {
+        intent = EscSequencer::WANT_REVERSE;
+        pulse = reversePWM;
+    }
+
+    driver_intent = intent;
+    driver_throttle_us = pulse;
+    driver_steering_us = steeringPWM;
+    actuate(monotonicMicros());
+}
+
+// Sterzo dritto e motore in folle: lease scaduto o rilasciato
+static void neutralOutputs() {
+    const RuntimeConfig &config = activeConfig();
+    pwmWrite(config.servo_pin, config.pwm_neutral_us);
+    esc_steering_us = config.pwm_neutral_us;
+    driver_intent = EscSequencer::WANT_NEUTRAL;
+    driver_throttle_us = config.pwm_neutral_us;
+    driver_steering_us = config.pwm_neutral_us;
+    traction.reset(config.pwm_neutral_us);
+    writeThrottle(esc_sequencer.forceNeutral(monotonicMicros(), config));
+}
+
+// Ogni ACCEPT riporta il periodo dei comandi della configurazione in uso
+static void sendAccept(int server_fd, const struct sockaddr_in &client_addr, SessionAccept accept) {
+    uint8_t reply[ACCEPT_SIZE + AUTH_TRAILER_SIZE];
+    accept.period_ms = static_cast<uint16_t>(activeConfig().client_period_ms);
+    writeAccept(reply, accept);
+    const size_t reply_len = control_auth.seal(reply, ACCEPT_SIZE);
+    sendto(server_fd, reply, reply_len, 0, reinterpret_cast<const struct sockaddr *>(&client_addr), sizeof(client_addr));
+}
+
+// Stato del ciclo dei comandi, condiviso dagli handler del reactor
+struct CommandLoop {
+    int server_fd;
+    int signal_fd;
+    int admin_fd = -1;
+    Reactor reactor;
+    RateController rate;
+    DriverLease lease{SESSION_LEASE_MS};
+    ReplayWindow replay;
+    HelloChallenge challenges;
     bool stream_active = false;
+    bool video_restart_pending = false; // Porta o comando della telecamera cambiati senza titolare
+    uint32_t last_control_seq = 0;
+    uint64_t controls_applied = 0;
+    uint64_t controls_stale = 0;     // Duplicati o superati da un comando più recente
+    uint64_t controls_lost = 0;      // Numeri di sequenza mai visti
+    uint64_t controls_recovered = 0; // Persi ma arrivati nella storia del comando successivo
+    uint64_t paddle_recovered = 0;   // Cambi di modalità presi dalla storia
+    uint64_t ignored = 0;
+    uint64_t rejected = 0;
+    uint8_t data[1024];
 
-    initializeControlSystems();
+    // Percorso di un comando, in ns: coda del socket (dal timestamp del kernel al ritorno di recvmsg),
+    // verifica e parsing fino ai PWM, scrittura dei PWM
+    int64_t queue_ns = -1; // Del datagramma in corso, -1 senza timestamp del kernel
+    uint64_t recv_ns = 0;
+    LatencyHistogram kernel_queue_ns;
+    LatencyHistogram parse_ns;
+    LatencyHistogram apply_ns;
+};
 
-    while (true) {
-        client_len = sizeof(client_addr);
-        int valread = recvfrom(server_fd, buffer, sizeof(buffer) - 1, 0,
-                               reinterpret_cast<struct sockaddr *>(&client_addr), &client_len);
-        if (valread < 0) {
-            if (errno == EINTR) {
-                continue;
-            }
-            perror("recvfrom failed");
-            continue;
+// Arresto su SIGINT/SIGTERM: prima il motore in folle, poi video e registrazione.
+// Il signalfd è una sorgente urgente del reactor: il ritardo dal segnale al folle è al più
+// la durata dell'handler più lento (max_dispatch_us). Se il segnale è stato inviato con
+// sigqueue e il timestamp monotono in sival, il ritardo viene misurato dall'invio.
+static void onSignal(void *ctx, int, uint32_t) {
+    CommandLoop &loop = *static_cast<CommandLoop *>(ctx);
+    struct signalfd_siginfo info{};
+    if (read(loop.signal_fd, &info, sizeof(info)) != sizeof(info)) {
+        return;
+    }
+    neutralOutputs();
+    const uint64_t neutral_us = monotonicMicros();
+    const uint64_t slowest_us = loop.reactor.stats().max_dispatch_us;
+
+    std::cout << "Segnale " << info.ssi_signo << " ricevuto: auto in folle dopo " << neutral_us - loop.reactor.wokeUs()
+              << " µs dal risveglio";
+    if (info.ssi_code == SI_QUEUE && info.ssi_ptr != 0 && info.ssi_ptr <= neutral_us) {
+        std::cout << ", " << neutral_us - info.ssi_ptr << " µs dall'invio";
+    }
+    std::cout << " (handler più lento " << slowest_us << " µs)" << std::endl;
+    if (slowest_us > PWM_FRAME_US) {
+        std::cerr << "Attenzione: un handler del ciclo supera un frame PWM (" << PWM_FRAME_US << " µs)" << std::endl;
+    }
+
+    clearTelemetryClient();
+    shutdownVideoStream();
+    shutdownRecorder(); // Chiude il segmento in corso
+    stopSensors();
+    stopConfigWatcher();
+    loop.reactor.stop();
+    std::cout << "Arresto completato." << std::endl;
+}
+
+static void onLeaseTick(void *ctx, int, uint32_t) {
+    CommandLoop &loop = *static_cast<CommandLoop *>(ctx);
+    const uint64_t now_ms = monotonicMicros() / 1000;
+    if (loop.lease.expire(now_ms)) {
+        neutralOutputs();
+        std::cout << "Lease scaduto: auto in folle." << std::endl;
+    }
+    // Senza titolare per un po' il video si ferma; un breve buco di rete non lo riavvia
+    if (loop.stream_active && !loop.lease.active() && loop.lease.idleMs(now_ms) >= VIDEO_IDLE_MS) {
+        stopVideoStream();
+        clearTelemetryClient();
+        loop.stream_active = false;
+        loop.video_restart_pending = false; // Il prossimo avvio usa già la nuova configurazione
+    }
+}
+
+// Nuova configurazione pubblicata dal thread di ricarica: adottata tra un comando e l'altro
+static void onConfigChanged(void *ctx, int, uint32_t) {
+    CommandLoop &loop = *static_cast<CommandLoop *>(ctx);
+    const RuntimeConfig *previous = adoptPendingConfig();
+    if (!previous) {
+        return;
+    }
+    const RuntimeConfig &config = activeConfig();
+    std::cout << "Configurazione ricaricata: PWM " << config.pwm_min_us << "-" << config.pwm_neutral_us << "-"
+              << config.pwm_max_us << " µs, dead zone " << config.dead_zone_us << " µs, periodo client "
+              << config.client_period_ms << " ms" << std::endl;
+    if (!loop.lease.active()) {
+        neutralOutputs(); // Nuovo neutro subito; con il lease lo porta il prossimo comando
+    }
+    // Il titolare riceve il nuovo periodo senza attendere il prossimo hello
+    if (config.client_period_ms != previous->client_period_ms && loop.lease.active()) {
+        SessionAccept accept;
+        accept.status = SESSION_GRANTED;
+        accept.token = loop.lease.token();
+        sendAccept(loop.server_fd, loop.lease.holder(), accept);
+    }
+    // Porta e comando della telecamera valgono dal prossimo avvio dell'encoder. Con il lease scaduto
+    // il titolare potrebbe non tornare: il riavvio aspetta la prossima assegnazione.
+    if (config.video_port != previous->video_port || config.camera_command != previous->camera_command) {
+        if (loop.stream_active && loop.lease.active()) {
+            startVideoStream(loop.lease.holder());
+        } else {
+            loop.video_restart_pending = loop.stream_active;
         }
+    }
+}
 
-        buffer[valread] = '\0';
+// Entrata o uscita dal basso consumo: gas limitato subito, video al livello consentito
+static void onPowerModeChanged(CommandLoop &loop, uint64_t now_us) {
+    const RuntimeConfig &config = activeConfig();
+    const bool low_power = power_monitor.lowPower();
+    publishLowPower(low_power);
+    if (low_power) {
+        std::cerr << "Alimentazione: " << powerReasonName(power_monitor.reason()) << " (batteria "
+                  << power_monitor.batteryMv() << " mV, firmware 0x" << std::hex << power_monitor.powerFlags()
+                  << std::dec << "): basso consumo, gas al " << config.low_power_throttle_pct << "%, video ridotto"
+                  << std::endl;
+    } else {
+        std::cout << "Alimentazione tornata normale (batteria " << power_monitor.batteryMv() << " mV)" << std::endl;
+    }
+    if (loop.rate.setLowPower(low_power, now_us / 1000)) {
+        const VideoTier &tier = loop.rate.tier();
+        std::cout << "Qualità video: " << tier.width << "x" << tier.height << "@" << tier.framerate << " "
+                  << tier.bitrate / 1000 << " kbit/s (basso consumo)" << std::endl;
+        setVideoTier(tier);
+        if (loop.stream_active) {
+            startVideoStream(loop.lease.holder());
+        }
+    }
+    if (loop.lease.active()) {
+        actuate(now_us); // Senza pilota le uscite sono già in folle
+    }
+}
 
-        if (!stream_active || client_addr.sin_addr.s_addr != last_stream_addr.sin_addr.s_addr) {
-            if (stream_active) {
-                stopVideoStream();
-            }
-            startVideoStream(client_addr);
-            last_stream_addr = client_addr;
-            stream_active = true;
+// Ogni frame PWM: telemetria (e passo del modello in simulazione), alimentazione, poi le rampe
+// del controllo di trazione avanzano anche senza nuovi comandi
+static void onTelemetryTick(void *ctx, int, uint32_t) {
+    CommandLoop &loop = *static_cast<CommandLoop *>(ctx);
+    sendTelemetry(loop.server_fd);
+    const uint64_t now_us = monotonicMicros();
+    if (power_monitor.update(sensorSnapshot(), now_us, activeConfig())) {
+        onPowerModeChanged(loop, now_us);
+    } else if (activeConfig().traction_control && traction.pending()) {
+        actuate(now_us);
+    }
+}
+
+static void handleDatagram(CommandLoop &loop, size_t valread, struct sockaddr_in &client_addr, uint64_t recv_us) {
+    const uint8_t *data = loop.data;
+    const uint64_t now_ms = recv_us / 1000;
+    DriverLease &lease = loop.lease;
 
-            char client_ip[INET_ADDRSTRLEN];
-            inet_ntop(AF_INET, &(client_addr.sin_addr), client_ip, INET_ADDRSTRLEN);
-            std::cout << "Datagram dal client IP: " << client_ip << std::endl;
+    // Solo messaggi binari: un datagramma qualunque non muove più l'auto né il video
+    if (!isControlMessage(data, valread)) {
+        if (loop.ignored++ % 100 == 0) {
+            std::cerr << "Datagramma non riconosciuto da " << inet_ntoa(client_addr.sin_addr) << std::endl;
         }
+        return;
+    }
 
-        int steering = 0;
-        int accelerator = 0;
-        int brake = 0;
-        int paddle = 0;
-        if (sscanf(buffer, "%d %d %d %d", &steering, &accelerator, &brake, &paddle) != 4) {
-            std::cerr << "Formato dei dati non valido: " << buffer << std::endl;
+    // MAC prima di tutto: un messaggio falsificato non tocca lease, PWM né registrazione.
+    // Dal titolare conta anche la finestra anti-replay; per gli altri basta il token del lease,
+    // che un vecchio messaggio ripetuto non può avere giusto, e per l'hello la sfida del Pi.
+    size_t len;
+    uint32_t counter;
+    const bool holder = lease.isHolder(client_addr);
+    if (!control_auth.open(data, valread, len, counter) ||
+        (control_auth.enabled() && holder && !loop.replay.accept(counter))) {
+        if (loop.rejected++ % 100 == 0) {
+            std::cerr << "Messaggio non autenticato o ripetuto da " << inet_ntoa(client_addr.sin_addr) << std::endl;
+        }
+        return;
+    }
+
+    const uint8_t type = controlMessageType(data);
+    if (type == MSG_HELLO) {
+        SessionAccept accept;
+        uint32_t challenge;
+        if (!parseHello(data, len, accept.nonce, challenge)) {
+            return;
+        }
+        // Un nuovo lease solo con la sfida appena mandata a questo indirizzo: l'hello catturato
+        // da un'altra sessione, ripetuto anche da un altro host, riceve solo una nuova sfida
+        const uint32_t addr = ntohl(client_addr.sin_addr.s_addr);
+        const uint16_t port = ntohs(client_addr.sin_port);
+        if (control_auth.enabled() && !holder && !lease.active() &&
+            !loop.challenges.verify(challenge, addr, port, now_ms)) {
+            accept.status = SESSION_CHALLENGE;
+            accept.token = loop.challenges.issue(addr, port, now_ms);
+            sendAccept(loop.server_fd, client_addr, accept);
+            return;
+        }
+        const DriverLease::HelloResult result = lease.onHello(client_addr, now_ms);
+        if (!holder && result != DriverLease::HELLO_BUSY) {
+            loop.replay.reset(); // Nuovo lease: la finestra riparte dal contatore di questo hello
+            loop.replay.accept(counter);
+        }
+        accept.status = result == DriverLease::HELLO_BUSY ? SESSION_BUSY : SESSION_GRANTED;
+        accept.token = result == DriverLease::HELLO_BUSY ? 0 : lease.token();
+        sendAccept(loop.server_fd, client_addr, accept);
+
+        // Il video segue solo chi ottiene il lease
+        if (result == DriverLease::HELLO_NEW_HOLDER ||
+            (result == DriverLease::HELLO_RENEWED && (!loop.stream_active || loop.video_restart_pending))) {
+            startVideoStream(client_addr); // Se il video era già attivo il processo viene riavviato
+            loop.stream_active = true;
+            loop.video_restart_pending = false;
+            setTelemetryClient(client_addr);
+            loop.last_control_seq = 0;
+            std::cout << "Lease assegnato a " << inet_ntoa(client_addr.sin_addr) << ":" << ntohs(client_addr.sin_port)
+                      << std::endl;
+        }
+    } else if (type == MSG_CONTROL) {
+        ControlFrame control;
+        if (!parseControlFrame(data, len, control)) {
+            return;
+        }
+        if (!lease.renew(control.token, client_addr, now_ms)) {
+            SessionAccept accept;
+            accept.status = lease.active() && !lease.isHolder(client_addr) ? SESSION_BUSY : SESSION_INVALID;
+            sendAccept(loop.server_fd, client_addr, accept);
+            return;
+        }
+        // Comandi duplicati (ridondanza del client) o fuori ordine: conta solo il più recente
+        const int32_t gap = loop.last_control_seq != 0 ? static_cast<int32_t>(control.seq - loop.last_control_seq) : 1;
+        if (gap <= 0) {
+            loop.controls_stale++;
+            return;
+        }
+        if (gap > 1) {
+            // Stati saltati ma riportati nella storia, dal più vecchio: sterzo e pedali li supera il
+            // comando più recente, i fronti del paddle invece vanno applicati o la pressione è persa
+            const uint64_t missing = static_cast<uint64_t>(gap - 1);
+            const uint64_t recovered = std::min<uint64_t>(missing, control.history_count);
+            for (uint64_t i = recovered; i-- > 0;) {
+                loop.paddle_recovered += applyPaddle(control.history[i].paddle);
+            }
+            loop.controls_recovered += recovered;
+            loop.controls_lost += missing - recovered;
+        }
+        loop.last_control_seq = control.seq;
+        loop.controls_applied++;
+        const uint64_t parsed_ns = monotonicNanos();
+        applyControls(control);
+        loop.apply_ns.record(static_cast<int64_t>(monotonicNanos() - parsed_ns));
+        loop.parse_ns.record(static_cast<int64_t>(parsed_ns - loop.recv_ns));
+        if (loop.queue_ns >= 0) {
+            loop.kernel_queue_ns.record(loop.queue_ns);
+        }
+    } else if (type == MSG_BYE) {
+        uint32_t token;
+        if (parseBye(data, len, token) && lease.release(token, client_addr)) {
+            neutralOutputs();
+            std::cout << "Lease rilasciato dal client." << std::endl;
+        }
+    } else if (type == MSG_RECEIVER_REPORT) {
+        if (holder) {
+            ReceiverReport report;
+            if (parseReceiverReport(data, len, report) && loop.rate.onReport(report, now_ms)) {
+                // Nuovo livello dell'encoder: si riavvia solo il processo video
+                const VideoTier &tier = loop.rate.tier();
+                std::cout << "Qualità video: " << tier.width << "x" << tier.height << "@" << tier.framerate
+                          << " " << tier.bitrate / 1000 << " kbit/s (perdite " << report.loss_permille / 10.0
+                          << "%, coda " << report.queue_delay_us / 1000 << " ms)" << std::endl;
+                setVideoTier(tier);
+                startVideoStream(client_addr);
+            }
+        }
+    } else if (type == MSG_RECORD_CONTROL) {
+        if (holder) {
+            handleRecordControl(loop.server_fd, data, len, client_addr);
+        }
+    } else if (type == MSG_TIME_REQUEST) {
+        replyTimeSync(loop.server_fd, data, len, client_addr, recv_us); // Nessun effetto sull'auto: libero
+    }
+}
+
+// Istante di arrivo nel kernel (CLOCK_REALTIME) dai messaggi di controllo di recvmsg, 0 se assente
+static uint64_t kernelReceiveNs(struct msghdr &msg) {
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET) {
             continue;
         }
+        struct timespec ts{};
+        if (cmsg->cmsg_type == SCM_TIMESTAMPING) {
+            struct scm_timestamping stamps;
+            std::memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+            ts = stamps.ts[0]; // Timestamp software
+        } else if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            std::memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+        } else {
+            continue;
+        }
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+    }
+    return 0;
+}
 
-        std::cout << "Sterzo: " << steering << ", Acceleratore: " << accelerator
-                  << ", Freno: " << brake << ", Paddle: " << paddle << std::endl;
-    // Mappiamo i valori joystick (0-1999) nei microsecondi richiesti dall'ESC/servo.
-    int steeringPWM = std::clamp(map(steering, 0, 1999, 1000, 2000), PWM_MIN_US, PWM_MAX_US);
-    int forwardPWM = std::clamp(map(accelerator, 0, 1999, PWM_NEUTRAL_US, PWM_MAX_US), PWM_NEUTRAL_US, PWM_MAX_US);
-    int brakePWM = std::clamp(map(brake, 0, 1999, PWM_NEUTRAL_US, PWM_MIN_US), PWM_MIN_US, PWM_NEUTRAL_US);
-    int reversePWM = std::clamp(map(accelerator, 0, 1999, PWM_NEUTRAL_US, PWM_MIN_US), PWM_MIN_US, PWM_NEUTRAL_US);
-
-        if (paddle == 1) {
-            currentMode = DRIVE;
-            std::cout << "Modalità: DRIVE" << std::endl;
-        } else if (paddle == -1) {
-            currentMode = REVERSE;
-            std::cout << "Modalità: REVERSE" << std::endl;
-        }
-
-        pwmWrite(SERVO_PIN, steeringPWM);
-
-        int throttlePWM = PWM_NEUTRAL_US;
-
-        // Logica ESC bidirezionale: 
-        // - 1000µs: retromarcia massima
-        // - 1500µs: neutro (dead zone ~1485-1515)
-        // - 2000µs: avanti massima
-        // Nota: passando da avanti a indietro l'ESC richiede due comandi sotto 1500µs (freno poi reverse).
-
-        if (brake > 15) { // Piccola soglia per evitare rumore sui pedali
-            throttlePWM = brakePWM; // freno / richiesta reverse (1° comando frena, 2° reverse)
-        } else if (currentMode == DRIVE) {
-            throttlePWM = forwardPWM;
-        } else if (currentMode == REVERSE) {
-            throttlePWM = reversePWM;
+static void onControlReadable(void *ctx, int, uint32_t) {
+    CommandLoop &loop = *static_cast<CommandLoop *>(ctx);
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(struct scm_timestamping))];
+    for (int i = 0; i < DATAGRAM_BURST; ++i) {
+        struct sockaddr_in client_addr{};
+        struct iovec iov = {loop.data, sizeof(loop.data)};
+        struct msghdr msg{};
+        msg.msg_name = &client_addr;
+        msg.msg_namelen = sizeof(client_addr);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        const ssize_t valread = recvmsg(loop.server_fd, &msg, MSG_DONTWAIT);
+        if (valread < 0) {
+            if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("recvmsg failed");
+            }
+            return;
+        }
+        // Il timestamp del kernel è in CLOCK_REALTIME: la coda si misura sullo stesso orologio
+        struct timespec now{};
+        clock_gettime(CLOCK_REALTIME, &now);
+        loop.recv_ns = monotonicNanos();
+        const uint64_t kernel_ns = kernelReceiveNs(msg);
+        const uint64_t now_ns = static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + now.tv_nsec;
+        loop.queue_ns = kernel_ns != 0 ? static_cast<int64_t>(now_ns - kernel_ns) : -1;
+        handleDatagram(loop, valread, client_addr, loop.recv_ns / 1000);
+    }
+}
+
+// Comandi testuali sul socket di amministrazione, una riga per connessione:
+// status, latency reset, record on, record off, shutdown
+static std::string runAdminCommand(CommandLoop &loop, const std::string &command) {
+    std::ostringstream out;
+    if (command == "status") {
+        const struct sockaddr_in &holder = loop.lease.holder();
+        out << "lease: ";
+        if (loop.lease.active()) {
+            out << inet_ntoa(holder.sin_addr) << ":" << ntohs(holder.sin_port) << "\n";
+        } else {
+            out << "libero\n";
+        }
+        const VideoSupervisorStats video = videoSupervisorStats();
+        out << "video: ";
+        if (video.pid > 0) {
+            out << "attivo, pid " << video.pid << ", da " << video.uptime_ms / 1000 << " s";
+        } else if (video.backoff_ms > 0) {
+            out << "riavvio tra " << video.backoff_ms << " ms";
         } else {
-            throttlePWM = PWM_NEUTRAL_US;
+            out << "fermo";
         }
+        out << " (avvii " << video.starts << ", riavvii " << video.restarts << ", crash " << video.crashes
+            << ", stalli " << video.stalls << ", blocco massimo del ciclo " << video.max_control_stall_us << " us)\n";
+        out << "CPU: ciclo dei comandi " << cpuAffinityList(0) << ", processo video "
+            << (video.pid > 0 ? cpuAffinityList(video.pid) : "-") << "\n";
+        const RecorderStats recorder = recorderStats();
+        out << "registrazione: " << (recorder.active ? "attiva" : "ferma") << ", file " << recorder.segments
+            << ", frame scritti " << recorder.frames_written << ", persi " << recorder.frames_dropped << "\n";
+        out << "autenticazione: " << (control_auth.enabled() ? "attiva" : "disattivata") << "\n";
+        const ReactorStats &stats = loop.reactor.stats();
+        out << "reactor: risvegli " << stats.wakeups << ", dispatch " << stats.dispatches << ", handler più lento "
+            << stats.max_dispatch_us << " us, scadenze perse " << stats.timer_overruns << ", attesa attiva "
+            << stats.spin_hits << " risvegli / " << stats.spin_sleeps << " a vuoto\n";
+        out << "ESC: " << escStateName(esc_sequencer.state()) << ", retromarce innestate "
+            << esc_sequencer.reverseEngagements() << "\n";
+        out << "controllo di trazione: " << (activeConfig().traction_control ? "attivo" : "spento")
+            << ", partenze " << traction.launches() << ", tagli " << traction.cuts() << ", velocità "
+            << (vehicleMotion().speed_estimated ? "stimata " : "misurata ") << vehicleMotion().speed_m_s << " m/s\n";
+        out << "alimentazione: " << (power_monitor.lowPower() ? "basso consumo, " : "")
+            << powerReasonName(power_monitor.reason()) << ", batteria ";
+        if (power_monitor.batteryMv() > 0) {
+            out << power_monitor.batteryMv() << " mV (minima " << power_monitor.minBatteryMv() << ")";
+        } else {
+            out << "non misurata";
+        }
+        out << ", firmware 0x" << std::hex << power_monitor.powerFlags() << std::dec;
+        if (power_monitor.powerFlags() & POWER_UNDERVOLTAGE_SINCE_BOOT) {
+            out << " (sottotensione dall'avvio)";
+        }
+        out << ", ingressi in basso consumo " << power_monitor.entries() << "\n";
+        const SensorStats sensors = sensorStats();
+        out << "sensori: " << sensorSourceName(sensors.source);
+        if (sensors.source != SENSORS_OFF) {
+            out << " a " << sensors.rate_hz << " Hz, campioni " << sensors.samples << ", scartati " << sensors.dropped
+                << ", errori " << sensors.read_errors << ", in ritardo " << sensors.overruns << ", lettura più lenta "
+                << sensors.max_read_us << " us";
+        }
+        out << "\n";
+        out << "datagrammi: ignorati " << loop.ignored << ", rifiutati " << loop.rejected << "\n";
+        out << "comandi: applicati " << loop.controls_applied << ", duplicati o superati " << loop.controls_stale
+            << ", persi " << loop.controls_lost << ", ricostruiti dalla storia " << loop.controls_recovered << " (cambi di modalità "
+            << loop.paddle_recovered << ")\n";
+        out << "ultimo comando: sterzo " << last_control.steering << ", acceleratore " << last_control.accelerator
+            << ", freno " << last_control.brake << ", paddle " << static_cast<int>(last_control.paddle) << ", modalità "
+            << (currentMode == DRIVE ? "DRIVE" : "REVERSE") << " (cambi " << mode_changes << ")\n";
+#ifdef RRC_SIMULATION
+        const SimVehicleState &vehicle = simVehicleState();
+        out << "veicolo simulato: x " << vehicle.x_m << " m, y " << vehicle.y_m << " m, rotta "
+            << vehicle.heading_rad * 180.0 / M_PI << "°, velocità " << vehicle.speed_m_s << " m/s, sterzo "
+            << vehicle.steer_rad * 180.0 / M_PI << "°, ESC " << simEscStateName(vehicle.esc) << "\n";
+#endif
+        out << "comandi, coda del kernel: " << loop.kernel_queue_ns.summary("ns") << "\n";
+        out << "comandi, verifica e parsing: " << loop.parse_ns.summary("ns") << "\n";
+        out << "comandi, scrittura PWM: " << loop.apply_ns.summary("ns") << "\n";
+        const ConfigStats config = configStats();
+        out << "configurazione: ricariche " << config.reloads << ", scartate " << config.errors << ", adottate "
+            << config.applied << ", periodo client " << activeConfig().client_period_ms << " ms\n";
+    } else if (command == "latency reset") {
+        loop.kernel_queue_ns.reset();
+        loop.parse_ns.reset();
+        loop.apply_ns.reset();
+        out << "ok\n";
+    } else if (command == "record on" || command == "record off") {
+        setRecording(command == "record on");
+        out << "ok\n";
+    } else if (command == "shutdown") {
+        kill(getpid(), SIGTERM); // Stesso percorso di Ctrl+C, servito dal signalfd
+        out << "ok\n";
+    } else {
+        out << "comandi: status, latency reset, record on, record off, shutdown\n";
+    }
+    return out.str();
+}
+
+static void onAdminClient(void *ctx, int client_fd, uint32_t) {
+    CommandLoop &loop = *static_cast<CommandLoop *>(ctx);
+    char line[128];
+    const ssize_t n = read(client_fd, line, sizeof(line) - 1);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+        return;
+    }
+    if (n > 0) {
+        std::string command(line, n);
+        command.erase(command.find_last_not_of(" \r\n") + 1);
+        const std::string reply = runAdminCommand(loop, command);
+        if (write(client_fd, reply.data(), reply.size()) < 0) {
+            perror("Risposta admin non inviata");
+        }
+    }
+    loop.reactor.remove(client_fd);
+    close(client_fd);
+}
+
+static void onAdminAccept(void *ctx, int, uint32_t) {
+    CommandLoop &loop = *static_cast<CommandLoop *>(ctx);
+    int client_fd = accept4(loop.admin_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (client_fd >= 0 && !loop.reactor.add(client_fd, EPOLLIN | EPOLLRDHUP, onAdminClient, &loop)) {
+        close(client_fd);
+    }
+}
+
+// Socket unix di amministrazione; un file rimasto da un'esecuzione precedente viene sostituito
+static int openAdminSocket(const std::string &path) {
+    struct sockaddr_un addr{};
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("Admin socket creation failed");
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0 || listen(fd, 4) < 0) {
+        perror("Admin socket bind failed");
+        close(fd);
+        return -1;
+    }
+    std::cout << "Amministrazione su " << path << " (status, latency reset, record on|off, shutdown)" << std::endl;
+    return fd;
+}
+
+// Tutto il lavoro del server gira qui, su un solo thread: comandi, scadenza del lease, telemetria,
+// segnali, processo video e amministrazione. Il thread video e quello della registrazione restano
+// fuori, sulle altre CPU. Ritorna dopo SIGINT/SIGTERM con l'auto in folle.
+void handleCommand(int server_fd, int signal_fd, const ServerOptions &options) {
+    CommandLoop loop;
+    loop.server_fd = server_fd;
+    loop.signal_fd = signal_fd;
+
+    initializeControlSystems();
+    traction.reset(activeConfig().pwm_neutral_us); // Il servo parte centrato
 
-        // Evita di uscire dalla deadzone se il comando è già neutro
-        if (throttlePWM > PWM_DEAD_LOW && throttlePWM < PWM_DEAD_HIGH && brake <= 15 && accelerator <= 15) {
-            throttlePWM = PWM_NEUTRAL_US;
+    const bool realtime = enterRealtime(options.rt_cpu, options.rt_priority);
+    if (realtime) {
+        std::cout << "Ciclo dei comandi in SCHED_FIFO " << options.rt_priority << " sulla CPU " << options.rt_cpu << std::endl;
+    } else if (options.rt_priority > 0) {
+        std::cerr << "Ciclo dei comandi senza priorità tempo reale" << std::endl;
+    }
+    // Dopo enterRealtime: il thread di avvio trova già la maschera delle altre CPU e la passa
+    // a encoder e relay
+    initVideoSupervisor(loop.reactor);
+    if (options.spin_us > 0) {
+        // Ha senso solo sulla CPU riservata: altrove l'attesa attiva ruba tempo a video e registrazione
+        std::cout << "Attesa attiva di " << options.spin_us << " µs prima di dormire" << std::endl;
+        if (!realtime || sysconf(_SC_NPROCESSORS_ONLN) < 2) {
+            std::cerr << "Attenzione: attesa attiva senza una CPU dedicata al ciclo dei comandi" << std::endl;
         }
+    }
+
+    // --record solo ora: il thread di scrittura nasce con la CPU riservata già nota e la lascia
+    if (options.record) {
+        setRecording(true);
+    }
+
+    // Dopo enterRealtime, che calcola le altre CPU. SCHED_RESET_ON_FORK fa nascere il thread dei
+    // sensori in SCHED_OTHER: la priorità, un gradino sotto il ciclo dei comandi, la prende da sé
+    if (options.sensors != SENSORS_OFF) {
+        const int sensor_priority = realtime && options.rt_priority > 1 ? options.rt_priority - 1 : 0;
+        if (startSensors(options.sensors, sensor_priority)) {
+            std::cout << "Sensori " << sensorSourceName(options.sensors) << " a " << sensorStats().rate_hz << " Hz";
+            if (sensor_priority > 0) {
+                std::cout << " in SCHED_FIFO " << sensor_priority;
+            }
+            std::cout << std::endl;
+        } else {
+            std::cerr << "Sensori non disponibili, si prosegue senza IMU né batteria" << std::endl;
+        }
+    }
+
+    loop.reactor.setSpin(options.spin_us);
+    loop.admin_fd = openAdminSocket(options.admin_path);
+    const int config_fd = startConfigWatcher();
+    esc_reactor = &loop.reactor;
+    esc_timer_fd = loop.reactor.addTimer(0, onEscTimer, nullptr);
+    if (esc_timer_fd < 0 ||
+        !loop.reactor.add(signal_fd, EPOLLIN, onSignal, &loop, true) ||
+        !loop.reactor.add(server_fd, EPOLLIN, onControlReadable, &loop) ||
+        loop.reactor.addTimer(LEASE_TICK_US, onLeaseTick, &loop) < 0 ||
+        loop.reactor.addTimer(TELEMETRY_PERIOD_US, onTelemetryTick, &loop) < 0 ||
+        (loop.admin_fd >= 0 && !loop.reactor.add(loop.admin_fd, EPOLLIN, onAdminAccept, &loop)) ||
+        (config_fd >= 0 && !loop.reactor.add(config_fd, EPOLLIN, onConfigChanged, &loop))) {
+        std::cerr << "Impossibile avviare il ciclo dei comandi" << std::endl;
+        esc_reactor = nullptr;
+        neutralOutputs();
+        stopSensors();
+        stopConfigWatcher();
+        return;
+    }
+
+    loop.reactor.run();
+    esc_reactor = nullptr; // Il timer dell'ESC si chiude con il reactor
 
-        pwmWrite(MOTOR_PIN, throttlePWM);
+    if (loop.admin_fd >= 0) {
+        close(loop.admin_fd);
+        unlink(options.admin_path.c_str());
     }
 }
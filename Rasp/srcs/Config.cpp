@@ -0,0 +1,335 @@
+#include "../include/rrc_config.hpp"
+#include "../include/rrc_reactor.hpp"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <poll.h>
+#include <sstream>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <thread>
+#include <unistd.h>
+
+constexpr int RELOAD_SETTLE_MS = 50; // Gli editor salvano con più scritture o con rename: si attende che finiscano
+
+// La configurazione passa dal thread di ricarica al ciclo dei comandi tramite due caselle atomiche:
+// config_pending porta la nuova, config_retired riporta indietro quella sostituita, che viene
+// liberata dal thread di ricarica. Il ciclo dei comandi non attende e non alloca mai.
+static RuntimeConfig *config_active = nullptr;   // Solo thread dei comandi
+static RuntimeConfig *config_previous = nullptr; // Solo thread dei comandi: ancora leggibile dal chiamante
+static std::atomic<RuntimeConfig *> config_pending{nullptr};
+static std::atomic<RuntimeConfig *> config_retired{nullptr};
+
+static std::string config_path;
+static std::vector<std::string> config_overrides;
+static RuntimeConfig config_startup; // Valori letti solo all'avvio
+static std::thread config_thread;
+static int config_event_fd = -1;     // Verso il reactor: nuova configurazione pubblicata
+static int config_stop_fd = -1;      // Verso il thread di ricarica: arresto
+static std::atomic<uint64_t> config_reloads{0};
+static std::atomic<uint64_t> config_errors{0};
+static std::atomic<uint64_t> config_applied{0};
+
+static std::string trim(const std::string &text) {
+    const size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    return text.substr(begin, text.find_last_not_of(" \t\r") - begin + 1);
+}
+
+static bool parseInt(const std::string &text, int min, int max, int &out) {
+    char *end = nullptr;
+    errno = 0;
+    const long value = std::strtol(text.c_str(), &end, 10);
+    if (text.empty() || *end != '\0' || errno != 0 || value < min || value > max) {
+        return false;
+    }
+    out = static_cast<int>(value);
+    return true;
+}
+
+static bool setValue(RuntimeConfig &config, const std::string &key, const std::string &value, std::string &error) {
+    bool ok = true;
+    if (key == "control_port") {
+        ok = parseInt(value, 1, 65535, config.control_port);
+    } else if (key == "video_port") {
+        ok = parseInt(value, 1, 65535, config.video_port);
+    } else if (key == "servo_pin") {
+        ok = parseInt(value, 0, 63, config.servo_pin);
+    } else if (key == "motor_pin") {
+        ok = parseInt(value, 0, 63, config.motor_pin);
+    } else if (key == "sensor_rate_hz") {
+        ok = parseInt(value, 10, 1000, config.sensor_rate_hz);
+    } else if (key == "i2c_bus") {
+        ok = !value.empty();
+        config.i2c_bus = value;
+    } else if (key == "imu_i2c_address") {
+        ok = parseInt(value, 3, 119, config.imu_i2c_address);
+    } else if (key == "adc_i2c_address") {
+        ok = parseInt(value, 3, 119, config.adc_i2c_address);
+    } else if (key == "battery_scale_x1000") {
+        ok = parseInt(value, 1000, 100000, config.battery_scale_x1000);
+    } else if (key == "sim_battery_mv") {
+        ok = parseInt(value, 1000, 60000, config.sim_battery_mv);
+    } else if (key == "pwm_min_us") {
+        ok = parseInt(value, 500, 2500, config.pwm_min_us);
+    } else if (key == "pwm_max_us") {
+        ok = parseInt(value, 500, 2500, config.pwm_max_us);
+    } else if (key == "pwm_neutral_us") {
+        ok = parseInt(value, 500, 2500, config.pwm_neutral_us);
+    } else if (key == "dead_zone_us") {
+        ok = parseInt(value, 0, 200, config.dead_zone_us);
+    } else if (key == "esc_brake_ms") {
+        ok = parseInt(value, 20, 1000, config.esc_brake_ms);
+    } else if (key == "esc_gap_ms") {
+        ok = parseInt(value, 20, 1000, config.esc_gap_ms);
+    } else if (key == "esc_arm_window_ms") {
+        ok = parseInt(value, 0, 10000, config.esc_arm_window_ms);
+    } else if (key == "traction_control") {
+        ok = parseInt(value, 0, 1, config.traction_control);
+    } else if (key == "launch_ramp_ms") {
+        ok = parseInt(value, 0, 5000, config.launch_ramp_ms);
+    } else if (key == "launch_speed_cm_s") {
+        ok = parseInt(value, 0, 1000, config.launch_speed_cm_s);
+    } else if (key == "accel_limit_cm_s2") {
+        ok = parseInt(value, 0, 5000, config.accel_limit_cm_s2);
+    } else if (key == "slip_limit_pct") {
+        ok = parseInt(value, 0, 100, config.slip_limit_pct);
+    } else if (key == "steer_rate_us_s") {
+        ok = parseInt(value, 0, 100000, config.steer_rate_us_s);
+    } else if (key == "steer_rate_speed_cm_s") {
+        ok = parseInt(value, 1, 5000, config.steer_rate_speed_cm_s);
+    } else if (key == "battery_low_mv") {
+        ok = parseInt(value, 0, 60000, config.battery_low_mv);
+    } else if (key == "battery_hysteresis_mv") {
+        ok = parseInt(value, 0, 5000, config.battery_hysteresis_mv);
+    } else if (key == "low_power_throttle_pct") {
+        ok = parseInt(value, 0, 100, config.low_power_throttle_pct);
+    } else if (key == "client_period_ms") {
+        ok = parseInt(value, 5, 1000, config.client_period_ms);
+    } else if (key == "camera_command") {
+        ok = !value.empty();
+        config.camera_command = value;
+    } else {
+        error = "chiave sconosciuta '" + key + "'";
+        return false;
+    }
+    if (!ok) {
+        error = "valore non valido per " + key + ": '" + value + "'";
+    }
+    return ok;
+}
+
+static bool applyLine(RuntimeConfig &config, const std::string &line, std::string &error) {
+    const std::string text = trim(line.substr(0, line.find('#')));
+    if (text.empty()) {
+        return true;
+    }
+    const size_t equal = text.find('=');
+    if (equal == std::string::npos) {
+        error = "manca '=' in '" + text + "'";
+        return false;
+    }
+    return setValue(config, trim(text.substr(0, equal)), trim(text.substr(equal + 1)), error);
+}
+
+bool loadConfig(const std::string &path, const std::vector<std::string> &overrides, RuntimeConfig &out,
+                std::string &error) {
+    RuntimeConfig config;
+    if (!path.empty()) {
+        std::ifstream file(path);
+        if (!file) {
+            error = path + ": " + strerror(errno);
+            return false;
+        }
+        std::string line;
+        for (int number = 1; std::getline(file, line); ++number) {
+            if (!applyLine(config, line, error)) {
+                error = path + ":" + std::to_string(number) + ": " + error;
+                return false;
+            }
+        }
+    }
+    for (const std::string &line : overrides) {
+        if (!applyLine(config, line, error)) {
+            error = "--set=" + line + ": " + error;
+            return false;
+        }
+    }
+    if (config.pwm_min_us >= config.pwm_neutral_us || config.pwm_neutral_us >= config.pwm_max_us) {
+        error = "serve pwm_min_us < pwm_neutral_us < pwm_max_us";
+        return false;
+    }
+    if (config.pwm_neutral_us - config.dead_zone_us <= config.pwm_min_us ||
+        config.pwm_neutral_us + config.dead_zone_us >= config.pwm_max_us) {
+        error = "dead_zone_us esce dall'intervallo del PWM";
+        return false;
+    }
+    if (config.esc_arm_window_ms != 0 && config.esc_arm_window_ms <= config.esc_gap_ms) {
+        error = "esc_arm_window_ms deve superare esc_gap_ms, o la retromarcia non si innesta mai";
+        return false;
+    }
+    out = config;
+    return true;
+}
+
+bool initConfig(const std::string &path, const std::vector<std::string> &overrides) {
+    RuntimeConfig config;
+    std::string error;
+    if (!loadConfig(path, overrides, config, error)) {
+        std::cerr << "Configurazione non valida: " << error << std::endl;
+        return false;
+    }
+    config_path = path;
+    config_overrides = overrides;
+    config_startup = config;
+    delete config_active;
+    config_active = new RuntimeConfig(config);
+    if (!path.empty()) {
+        std::cout << "Configurazione letta da " << path << std::endl;
+    }
+    return true;
+}
+
+const RuntimeConfig &activeConfig() {
+    if (!config_active) {
+        config_active = new RuntimeConfig(); // Nessuna initConfig: solo i default
+    }
+    return *config_active;
+}
+
+// Rilegge il file; se è valido lo pubblica e sveglia il ciclo dei comandi
+static void reloadConfig() {
+    config_reloads++;
+    RuntimeConfig config;
+    std::string error;
+    if (!loadConfig(config_path, config_overrides, config, error)) {
+        config_errors++;
+        std::cerr << "Configurazione non ricaricata: " << error << std::endl;
+        return;
+    }
+    if (config.control_port != config_startup.control_port || config.servo_pin != config_startup.servo_pin ||
+        config.motor_pin != config_startup.motor_pin) {
+        std::cerr << "Porta dei comandi e pin cambiano solo al riavvio del server" << std::endl;
+        config.control_port = config_startup.control_port;
+        config.servo_pin = config_startup.servo_pin;
+        config.motor_pin = config_startup.motor_pin;
+    }
+
+    delete config_retired.exchange(nullptr);
+    delete config_pending.exchange(new RuntimeConfig(config)); // Non ancora adottata: sostituita
+    const uint64_t one = 1;
+    if (write(config_event_fd, &one, sizeof(one)) < 0) {
+        perror("eventfd write failed");
+    }
+}
+
+// Osserva la cartella e non il file: gli editor e i deploy sostituiscono il file con un rename
+static void configWatcherLoop(int inotify_fd, std::string name) {
+    leaveRealtimeCpu();
+    char buffer[4096] __attribute__((aligned(alignof(struct inotify_event))));
+    bool changed = false;
+    while (true) {
+        struct pollfd fds[2] = {{config_stop_fd, POLLIN, 0}, {inotify_fd, POLLIN, 0}};
+        const int ready = poll(fds, 2, changed ? RELOAD_SETTLE_MS : -1);
+        if (ready < 0 && errno != EINTR) {
+            perror("poll failed");
+            break;
+        }
+        if (fds[0].revents & POLLIN) {
+            break;
+        }
+        if (ready == 0 && changed) {
+            changed = false;
+            reloadConfig();
+            continue;
+        }
+        if (fds[1].revents & POLLIN) {
+            const ssize_t len = read(inotify_fd, buffer, sizeof(buffer));
+            for (ssize_t offset = 0; offset < len;) {
+                const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(buffer + offset);
+                if (event->len > 0 && name == event->name) {
+                    changed = true;
+                }
+                offset += sizeof(struct inotify_event) + event->len;
+            }
+        }
+    }
+    close(inotify_fd);
+}
+
+int startConfigWatcher() {
+    if (config_path.empty()) {
+        return -1;
+    }
+    const size_t slash = config_path.rfind('/');
+    const std::string dir = slash == std::string::npos ? "." : config_path.substr(0, slash + 1);
+    const std::string name = slash == std::string::npos ? config_path : config_path.substr(slash + 1);
+
+    int inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0 || inotify_add_watch(inotify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+        perror("inotify failed");
+        if (inotify_fd >= 0) {
+            close(inotify_fd);
+        }
+        return -1;
+    }
+    config_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    config_stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (config_event_fd < 0 || config_stop_fd < 0) {
+        perror("eventfd failed");
+        close(inotify_fd);
+        return -1;
+    }
+    config_thread = std::thread(configWatcherLoop, inotify_fd, name);
+    std::cout << "Ricarica automatica di " << config_path << " attiva" << std::endl;
+    return config_event_fd;
+}
+
+const RuntimeConfig *adoptPendingConfig() {
+    uint64_t count;
+    if (config_event_fd >= 0 && read(config_event_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        perror("eventfd read failed");
+    }
+    RuntimeConfig *next = config_pending.exchange(nullptr);
+    if (!next) {
+        return nullptr;
+    }
+    // La penultima non è più raggiungibile da nessuno: torna al thread di ricarica
+    delete config_retired.exchange(config_previous); // Di norma vuota: già raccolta a ogni ricarica
+    config_previous = config_active;
+    config_active = next;
+    config_applied++;
+    return config_previous;
+}
+
+void stopConfigWatcher() {
+    if (config_thread.joinable()) {
+        const uint64_t one = 1;
+        if (write(config_stop_fd, &one, sizeof(one)) < 0) {
+            perror("eventfd write failed");
+        }
+        config_thread.join();
+    }
+    for (int *fd : {&config_event_fd, &config_stop_fd}) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+    delete config_pending.exchange(nullptr);
+    delete config_retired.exchange(nullptr);
+    delete config_previous;
+    config_previous = nullptr;
+}
+
+ConfigStats configStats() {
+    ConfigStats stats;
+    stats.reloads = config_reloads.load();
+    stats.errors = config_errors.load();
+    stats.applied = config_applied.load();
+    return stats;
+}
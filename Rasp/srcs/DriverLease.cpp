@@ -0,0 +1,53 @@
+#include "../include/rrc_lease.hpp"
+
+bool DriverLease::sameEndpoint(const struct sockaddr_in &a, const struct sockaddr_in &b) {
+    return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+}
+
+bool DriverLease::isHolder(const struct sockaddr_in &from) const {
+    return active_ && sameEndpoint(from, holder_);
+}
+
+DriverLease::HelloResult DriverLease::onHello(const struct sockaddr_in &from, uint64_t now_ms) {
+    if (active_ && sameEndpoint(from, holder_)) {
+        last_renew_ms_ = now_ms;
+        return HELLO_RENEWED;
+    }
+    if (active_) {
+        return HELLO_BUSY;
+    }
+
+    const bool same_host = has_holder_ && sameEndpoint(from, holder_);
+    do {
+        token_ = rng_();
+    } while (token_ == 0);
+    holder_ = from;
+    has_holder_ = true;
+    active_ = true;
+    last_renew_ms_ = now_ms;
+    return same_host ? HELLO_RENEWED : HELLO_NEW_HOLDER;
+}
+
+bool DriverLease::renew(uint32_t token, const struct sockaddr_in &from, uint64_t now_ms) {
+    if (!active_ || token != token_ || !sameEndpoint(from, holder_)) {
+        return false;
+    }
+    last_renew_ms_ = now_ms;
+    return true;
+}
+
+bool DriverLease::release(uint32_t token, const struct sockaddr_in &from) {
+    if (!active_ || token != token_ || !sameEndpoint(from, holder_)) {
+        return false;
+    }
+    active_ = false;
+    return true;
+}
+
+bool DriverLease::expire(uint64_t now_ms) {
+    if (!active_ || now_ms - last_renew_ms_ < lease_ms_) {
+        return false;
+    }
+    active_ = false;
+    return true;
+}
@@ -0,0 +1,151 @@
+#include "../include/rrc_esc.hpp"
+#include <algorithm>
+
+constexpr uint64_t US_PER_MS = 1000;
+
+static bool neutralState(EscSequencer::State state) {
+    return state == EscSequencer::NEUTRAL || state == EscSequencer::NEUTRAL_GAP;
+}
+
+void EscSequencer::enter(State state, uint64_t now_us) {
+    if (state == state_) {
+        return;
+    }
+    if (neutralState(state)) {
+        // Il folle conta per l'armamento solo dal primo impulso in folle dopo freno o retromarcia
+        if (!neutralState(state_)) {
+            after_backward_ = state_ == BRAKING || state_ == REVERSE;
+            after_reverse_ = state_ == REVERSE;
+            neutral_since_us_ = now_us;
+        }
+    } else {
+        after_backward_ = false;
+        after_reverse_ = false;
+    }
+    if (state == REVERSE) {
+        reverse_engagements_++;
+    }
+    state_ = state;
+    since_us_ = now_us;
+}
+
+// L'ESC ha visto di sicuro un impulso in folle dopo il freno: il prossimo sotto il neutro va indietro
+bool EscSequencer::armed(uint64_t now_us, const RuntimeConfig &config) const {
+    return neutralState(state_) && after_backward_ &&
+           now_us - neutral_since_us_ >= static_cast<uint64_t>(config.esc_gap_ms) * US_PER_MS;
+}
+
+// Folle più lungo della finestra dell'ESC: la retromarcia non è più armata, il freno torna freno
+void EscSequencer::expireArming(uint64_t now_us, const RuntimeConfig &config) {
+    if (config.esc_arm_window_ms > 0 && neutralState(state_) && after_backward_ &&
+        now_us - neutral_since_us_ >= static_cast<uint64_t>(config.esc_arm_window_ms) * US_PER_MS) {
+        after_backward_ = false;
+        after_reverse_ = false;
+    }
+}
+
+int EscSequencer::advance(uint64_t now_us, const RuntimeConfig &config) {
+    const uint64_t brake_us = static_cast<uint64_t>(config.esc_brake_ms) * US_PER_MS;
+    expireArming(now_us, config);
+    // Al più freno -> folle -> retromarcia nello stesso istante se le scadenze sono già passate
+    for (int step = 0; step < 3; ++step) {
+        const State before = state_;
+        const bool braked_enough = state_ == BRAKING && now_us - since_us_ >= brake_us;
+        switch (intent_) {
+        case WANT_FORWARD:
+            enter(FORWARD, now_us); // Avanti è sempre sicuro e disarma la retromarcia dell'ESC
+            break;
+        case WANT_BRAKE:
+            // In retromarcia, o con l'ESC forse armato, un impulso sotto il neutro porterebbe l'auto
+            // indietro: il freno diventa folle finché l'acceleratore non riporta l'ESC in avanti
+            if (state_ == REVERSE || (neutralState(state_) && after_backward_)) {
+                enter(NEUTRAL, now_us);
+            } else {
+                enter(BRAKING, now_us);
+            }
+            break;
+        case WANT_NEUTRAL:
+            if (state_ != BRAKING || braked_enough) {
+                enter(NEUTRAL, now_us); // Un freno appena iniziato dura comunque almeno esc_brake_ms
+            }
+            break;
+        case WANT_REVERSE:
+            if (armed(now_us, config) || (neutralState(state_) && after_reverse_)) {
+                enter(REVERSE, now_us);
+            } else if (neutralState(state_) && after_backward_) {
+                enter(NEUTRAL_GAP, now_us);
+            } else if (braked_enough) {
+                enter(NEUTRAL_GAP, now_us);
+            } else if (state_ == FORWARD || state_ == NEUTRAL) {
+                enter(BRAKING, now_us);
+            }
+            break;
+        }
+        if (state_ == before) {
+            break;
+        }
+    }
+    return output(config);
+}
+
+int EscSequencer::output(const RuntimeConfig &config) const {
+    const int neutral = config.pwm_neutral_us;
+    switch (state_) {
+    case FORWARD:
+    case REVERSE:
+        return pulse_us_;
+    case BRAKING:
+        // Il freno dell'innesto deve uscire dalla dead zone, o l'ESC vedrebbe solo folle
+        return std::min(backward_pulse_us_, neutral - config.dead_zone_us);
+    default:
+        return neutral;
+    }
+}
+
+int EscSequencer::request(Intent intent, int pulse_us, uint64_t now_us, const RuntimeConfig &config) {
+    intent_ = intent;
+    pulse_us_ = pulse_us;
+    if (intent == WANT_BRAKE || intent == WANT_REVERSE) {
+        backward_pulse_us_ = pulse_us;
+    }
+    return advance(now_us, config);
+}
+
+int EscSequencer::tick(uint64_t now_us, const RuntimeConfig &config) {
+    return advance(now_us, config);
+}
+
+int EscSequencer::forceNeutral(uint64_t now_us, const RuntimeConfig &config) {
+    intent_ = WANT_NEUTRAL;
+    enter(NEUTRAL, now_us);
+    return output(config);
+}
+
+uint64_t EscSequencer::deadlineUs(const RuntimeConfig &config) const {
+    if (state_ == BRAKING && intent_ != WANT_BRAKE) {
+        return since_us_ + static_cast<uint64_t>(config.esc_brake_ms) * US_PER_MS;
+    }
+    if (state_ == NEUTRAL_GAP) {
+        return neutral_since_us_ + static_cast<uint64_t>(config.esc_gap_ms) * US_PER_MS;
+    }
+    // Freno tenuto in folle per sicurezza: riparte appena l'ESC disarma
+    if (state_ == NEUTRAL && intent_ == WANT_BRAKE && after_backward_ && config.esc_arm_window_ms > 0) {
+        return neutral_since_us_ + static_cast<uint64_t>(config.esc_arm_window_ms) * US_PER_MS;
+    }
+    return 0;
+}
+
+const char *escStateName(EscSequencer::State state) {
+    switch (state) {
+    case EscSequencer::FORWARD:
+        return "avanti";
+    case EscSequencer::BRAKING:
+        return "freno";
+    case EscSequencer::NEUTRAL_GAP:
+        return "folle prima della retromarcia";
+    case EscSequencer::REVERSE:
+        return "retromarcia";
+    default:
+        return "folle";
+    }
+}
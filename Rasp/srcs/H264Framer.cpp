@@ -0,0 +1,71 @@
+#include "../include/rrc_h264.hpp"
+
+// Oltre questa dimensione senza slice il flusso non è H.264 valido: si scarta
+constexpr size_t MAX_PENDING_BYTES = 4 * 1024 * 1024;
+
+enum NalType : uint8_t {
+    NAL_SLICE = 1,
+    NAL_IDR = 5,
+    NAL_SEI = 6,
+    NAL_SPS = 7,
+    NAL_PPS = 8,
+    NAL_AUD = 9,
+};
+
+void H264Framer::feed(const uint8_t *data, size_t len) {
+    buffer_.insert(buffer_.end(), data, data + len);
+
+    // Servono lo start code (3 byte), l'header NAL e il primo byte della slice
+    while (scan_ + 5 <= buffer_.size()) {
+        const uint8_t *p = buffer_.data() + scan_;
+        if (p[0] != 0 || p[1] != 0 || p[2] != 1) {
+            scan_++;
+            continue;
+        }
+
+        const uint8_t type = p[3] & 0x1f;
+        const bool is_slice = type == NAL_SLICE || type == NAL_IDR;
+        const bool first_slice = is_slice && (p[4] & 0x80); // first_mb_in_slice == 0
+        const bool starts_unit = first_slice || type == NAL_AUD || type == NAL_SEI ||
+                                 type == NAL_SPS || type == NAL_PPS;
+
+        if (starts_unit && unit_has_slice_) {
+            // Lo zero iniziale di uno start code a 4 byte appartiene al nuovo frame
+            closeUnit(scan_ > unit_start_ && buffer_[scan_ - 1] == 0 ? scan_ - 1 : scan_);
+        }
+        unit_has_slice_ = unit_has_slice_ || is_slice;
+        unit_keyframe_ = unit_keyframe_ || type == NAL_IDR || type == NAL_SPS;
+        scan_ += 3;
+    }
+
+    if (ready_.empty() && buffer_.size() - unit_start_ > MAX_PENDING_BYTES) {
+        buffer_.clear();
+        scan_ = unit_start_ = 0;
+        unit_has_slice_ = unit_keyframe_ = false;
+    }
+}
+
+void H264Framer::flush() {
+    if (unit_has_slice_) {
+        closeUnit(buffer_.size());
+        scan_ = buffer_.size();
+    }
+}
+
+H264AccessUnit H264Framer::ready(size_t i) const {
+    return {buffer_.data() + ready_[i].start, ready_[i].size, ready_[i].keyframe};
+}
+
+void H264Framer::consume() {
+    ready_.clear();
+    buffer_.erase(buffer_.begin(), buffer_.begin() + unit_start_);
+    scan_ -= unit_start_;
+    unit_start_ = 0;
+}
+
+void H264Framer::closeUnit(size_t end) {
+    ready_.push_back({unit_start_, end - unit_start_, unit_keyframe_});
+    unit_start_ = end;
+    unit_has_slice_ = false;
+    unit_keyframe_ = false;
+}
@@ -1,11 +1,28 @@
 #include "../include/rrc_rasp.hpp"
+#include "../include/rrc_reactor.hpp"
+#ifdef RRC_SIMULATION
+# include "../include/rrc_simvehicle.hpp"
+#endif
+#include <algorithm>
+#include <linux/net_tstamp.h>
+#include <sys/signalfd.h>
+
+constexpr int LOW_LATENCY_BUSY_POLL_US = 50;
+constexpr int LOW_LATENCY_RCVBUF = 8192; // Una decina di comandi: oltre, un comando vecchio vale meno di niente
+
+// Sorgenti accettate da parseVideoSource e parseSensorSource, per il messaggio d'uso
+#ifdef RRC_SIMULATION
+static const char *const USAGE_VIDEO_SOURCES = "camera|testsrc|synthetic|simview";
+static const char *const USAGE_SENSOR_SOURCES = "off|firmware|i2c|sim";
+#else
+static const char *const USAGE_VIDEO_SOURCES = "camera|testsrc|synthetic";
+static const char *const USAGE_SENSOR_SOURCES = "off|firmware|i2c";
+#endif
 
 // Definizione delle variabili globali
 Mode currentMode = DRIVE;
-pid_t stream_pid = -1;
 std::mutex stream_mutex;
-std::atomic<bool> stop_streaming(false);
-FILE* stream_proc = nullptr;  // Pointer per popen()
+ControlAuth control_auth;
 
 void setupSocket(int &server_fd, struct sockaddr_in &address) {
     if ((server_fd = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
@@ -15,29 +32,154 @@ void setupSocket(int &server_fd, struct sockaddr_in &address) {
 
     address.sin_family = AF_INET;
     address.sin_addr.s_addr = INADDR_ANY;
-    address.sin_port = htons(PORT);
+    address.sin_port = htons(activeConfig().control_port);
 
     if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
         perror("Bind failed");
         close(server_fd);
         exit(EXIT_FAILURE);
     }
-    std::cout << "Server ready on UDP port " << PORT << std::endl;
+    std::cout << "Server ready on UDP port " << activeConfig().control_port << std::endl;
+
+    // Istante di arrivo di ogni datagramma, preso dal kernel: separa l'attesa nella coda del
+    // socket dal tempo speso nel ciclo dei comandi. SO_TIMESTAMPNS se SO_TIMESTAMPING manca.
+    const int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    const int on = 1;
+    if (setsockopt(server_fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0) {
+        std::cout << "Timestamp di ricezione: SO_TIMESTAMPING" << std::endl;
+    } else if (setsockopt(server_fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) == 0) {
+        std::cout << "Timestamp di ricezione: SO_TIMESTAMPNS" << std::endl;
+    } else {
+        perror("Timestamp di ricezione non disponibili");
+    }
 }
 
-void startServer() {
+// SIGINT e SIGTERM restano bloccati in tutti i thread e arrivano al ciclo dei comandi tramite
+// signalfd: nessun codice gira in contesto di segnale. Va chiamata prima di creare qualunque thread,
+// che eredita la maschera.
+static int setupSignals() {
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    if (pthread_sigmask(SIG_BLOCK, &mask, nullptr) != 0) {
+        perror("pthread_sigmask failed");
+        exit(EXIT_FAILURE);
+    }
+    int signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd < 0) {
+        perror("signalfd failed");
+        exit(EXIT_FAILURE);
+    }
+    return signal_fd;
+}
+
+void startServer(int signal_fd, const ServerOptions &options) {
     int server_fd;
     struct sockaddr_in address;
 
     setupSocket(server_fd, address);  // Impostazione del socket
+    if (options.low_latency) {
+        const bool tuned = tuneLowLatencySocket(server_fd, LOW_LATENCY_BUSY_POLL_US, LOW_LATENCY_RCVBUF);
+        std::cout << "Socket dei comandi a bassa latenza" << (tuned ? "" : " (opzioni parziali)") << std::endl;
+    }
+    if (control_auth.loadFromEnv()) {
+        std::cout << "Canale di controllo autenticato (SipHash-2-4, RRC_PSK)" << std::endl;
+    } else {
+        std::cerr << "Attenzione: RRC_PSK non impostata, comandi accettati senza autenticazione" << std::endl;
+    }
     setupGPIO();  // Impostazione dei pin GPIO
-    handleCommand(server_fd);
+    handleCommand(server_fd, signal_fd, options);  // Ritorna solo dopo un segnale di arresto
     close(server_fd);
 }
 
-int main() {
-    signal(SIGINT, signalHandler);  // Gestisce l'interruzione del programma (CTRL+C)
-    
-    startServer();  // Avvia il server
+// Opzioni:
+//   --fec=off|L|LxD                        parità XOR su gruppi di L pacchetti, D righe per la parità di colonna
+//   --video-source=camera|testsrc|synthetic sorgente del flusso H.264
+//                 |simview                 (solo make sim) l'auto simulata vista dall'alto
+//   --record                               registra il video su SD fin dall'avvio
+//   --record-dir=PATH                      cartella delle registrazioni (default recordings)
+//   --record-segment=S                     durata di ogni file in secondi (default 300)
+//   --admin-socket=PATH|off                socket unix di amministrazione (default /tmp/rrc_admin.sock)
+//   --rt-cpu=N|off                         CPU riservata al ciclo dei comandi (default 3)
+//   --rt-priority=P                        priorità SCHED_FIFO del ciclo, 0 per disattivarla (default 50)
+//   --low-latency                          busy poll, buffer piccolo e DSCP EF sul socket dei comandi
+//   --spin-us=N                            attesa attiva del ciclo dei comandi prima di dormire (default 0)
+//   --sensors=off|firmware|i2c|sim         IMU e batteria: nessuno, solo flag di alimentazione (default), bus I2C,
+//                                          veicolo simulato (solo make sim, default lì)
+//   --config=PATH                          file di configurazione, ricaricato quando cambia
+//   --set=CHIAVE=VALORE                    sostituisce una voce del file (ripetibile)
+static bool parseArguments(int argc, char **argv, ServerOptions &options) {
+    std::string record_dir = "recordings";
+    int record_segment_s = 300;
+    std::string config_file;
+    std::vector<std::string> config_overrides;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        FecParams fec;
+        VideoSource source;
+        SensorSource sensors;
+        if (arg.rfind("--fec=", 0) == 0 && parseFecParams(arg.substr(6), fec)) {
+            setVideoFec(fec);
+        } else if (arg.rfind("--video-source=", 0) == 0 && parseVideoSource(arg.substr(15), source)) {
+            setVideoSource(source);
+        } else if (arg == "--record") {
+            options.record = true;
+        } else if (arg.rfind("--record-dir=", 0) == 0 && arg.size() > 13) {
+            record_dir = arg.substr(13);
+        } else if (arg.rfind("--record-segment=", 0) == 0 && std::atoi(arg.c_str() + 17) > 0) {
+            record_segment_s = std::atoi(arg.c_str() + 17);
+        } else if (arg.rfind("--admin-socket=", 0) == 0) {
+            options.admin_path = arg.substr(15) == "off" ? "" : arg.substr(15);
+        } else if (arg.rfind("--rt-cpu=", 0) == 0) {
+            options.rt_cpu = arg.substr(9) == "off" ? -1 : std::atoi(arg.c_str() + 9);
+        } else if (arg.rfind("--rt-priority=", 0) == 0) {
+            options.rt_priority = std::clamp(std::atoi(arg.c_str() + 14), 0, 99);
+        } else if (arg == "--low-latency") {
+            options.low_latency = true;
+        } else if (arg.rfind("--spin-us=", 0) == 0) {
+            options.spin_us = std::clamp(std::atoi(arg.c_str() + 10), 0, 1000000);
+        } else if (arg.rfind("--sensors=", 0) == 0 && parseSensorSource(arg.substr(10), sensors)) {
+            options.sensors = sensors;
+        } else if (arg.rfind("--config=", 0) == 0 && arg.size() > 9) {
+            config_file = arg.substr(9);
+        } else if (arg.rfind("--set=", 0) == 0 && arg.find('=', 6) != std::string::npos) {
+            config_overrides.push_back(arg.substr(6));
+        } else {
+            std::cerr << "Opzione non valida: " << arg << std::endl;
+            std::cerr << "Uso: " << argv[0] << " [--fec=off|L|LxD] [--video-source=" << USAGE_VIDEO_SOURCES << "]"
+                      << " [--record] [--record-dir=PATH] [--record-segment=S] [--admin-socket=PATH|off]"
+                      << " [--rt-cpu=N|off] [--rt-priority=P] [--low-latency] [--spin-us=N]"
+                      << " [--sensors=" << USAGE_SENSOR_SOURCES << "] [--config=PATH] [--set=CHIAVE=VALORE]" << std::endl;
+            return false;
+        }
+    }
+    if (!initConfig(config_file, config_overrides)) {
+        return false;
+    }
+
+    setRecordOptions(record_dir, record_segment_s);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    // Modalità interna: il relay avvia questo stesso eseguibile come sorgente video sintetica
+    if (argc == 4 && std::string(argv[1]) == "--synthetic-video") {
+        return runSyntheticVideo(std::atoi(argv[2]), std::atoi(argv[3]));
+    }
+#ifdef RRC_SIMULATION
+    if (argc == 6 && std::string(argv[1]) == "--sim-view") {
+        return runSimView(std::atoi(argv[2]), std::atoi(argv[3]), std::atoi(argv[4]), std::atoi(argv[5]));
+    }
+#endif
+    const int signal_fd = setupSignals(); // Prima di ogni thread, che eredita la maschera dei segnali
+    ServerOptions options;
+    if (!parseArguments(argc, argv, options)) {
+        return EXIT_FAILURE;
+    }
+
+    startServer(signal_fd, options);  // Avvia il server
+    close(signal_fd);
     return 0;
 }
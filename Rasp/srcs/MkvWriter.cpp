@@ -0,0 +1,218 @@
+#include "../include/rrc_record.hpp"
+
+// Elementi Matroska/EBML usati
+constexpr uint32_t EBML_HEADER = 0x1A45DFA3;
+constexpr uint32_t EBML_VERSION = 0x4286;
+constexpr uint32_t EBML_READ_VERSION = 0x42F7;
+constexpr uint32_t EBML_MAX_ID_LENGTH = 0x42F2;
+constexpr uint32_t EBML_MAX_SIZE_LENGTH = 0x42F3;
+constexpr uint32_t EBML_DOC_TYPE = 0x4282;
+constexpr uint32_t EBML_DOC_TYPE_VERSION = 0x4287;
+constexpr uint32_t EBML_DOC_TYPE_READ_VERSION = 0x4285;
+constexpr uint32_t MKV_SEGMENT = 0x18538067;
+constexpr uint32_t MKV_INFO = 0x1549A966;
+constexpr uint32_t MKV_TIMECODE_SCALE = 0x2AD7B1;
+constexpr uint32_t MKV_MUXING_APP = 0x4D80;
+constexpr uint32_t MKV_WRITING_APP = 0x5741;
+constexpr uint32_t MKV_TRACKS = 0x1654AE6B;
+constexpr uint32_t MKV_TRACK_ENTRY = 0xAE;
+constexpr uint32_t MKV_TRACK_NUMBER = 0xD7;
+constexpr uint32_t MKV_TRACK_UID = 0x73C5;
+constexpr uint32_t MKV_TRACK_TYPE = 0x83;
+constexpr uint32_t MKV_FLAG_LACING = 0x9C;
+constexpr uint32_t MKV_CODEC_ID = 0x86;
+constexpr uint32_t MKV_CODEC_PRIVATE = 0x63A2;
+constexpr uint32_t MKV_VIDEO = 0xE0;
+constexpr uint32_t MKV_PIXEL_WIDTH = 0xB0;
+constexpr uint32_t MKV_PIXEL_HEIGHT = 0xBA;
+constexpr uint32_t MKV_CLUSTER = 0x1F43B675;
+constexpr uint32_t MKV_TIMECODE = 0xE7;
+constexpr uint32_t MKV_SIMPLE_BLOCK = 0xA3;
+
+constexpr uint8_t NAL_SPS = 7;
+constexpr uint8_t NAL_PPS = 8;
+constexpr uint8_t NAL_AUD = 9;
+
+static void putId(std::vector<uint8_t> &out, uint32_t id) {
+    int bytes = id > 0xFFFFFF ? 4 : id > 0xFFFF ? 3 : id > 0xFF ? 2 : 1;
+    while (bytes-- > 0) {
+        out.push_back(static_cast<uint8_t>(id >> (bytes * 8)));
+    }
+}
+
+static void putSize(std::vector<uint8_t> &out, uint64_t size) {
+    int bytes = 1;
+    while (bytes < 8 && size >= (1ULL << (7 * bytes)) - 1) {
+        bytes++;
+    }
+    const uint64_t coded = size | (1ULL << (7 * bytes));
+    for (int i = bytes - 1; i >= 0; --i) {
+        out.push_back(static_cast<uint8_t>(coded >> (i * 8)));
+    }
+}
+
+// Dimensione ignota: l'elemento termina dove inizia il successivo dello stesso livello
+static void putUnknownSize(std::vector<uint8_t> &out) {
+    const uint8_t unknown[8] = {0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    out.insert(out.end(), unknown, unknown + sizeof(unknown));
+}
+
+static void putUint(std::vector<uint8_t> &out, uint32_t id, uint64_t value) {
+    int bytes = 1;
+    while (bytes < 8 && (value >> (bytes * 8)) != 0) {
+        bytes++;
+    }
+    putId(out, id);
+    putSize(out, bytes);
+    for (int i = bytes - 1; i >= 0; --i) {
+        out.push_back(static_cast<uint8_t>(value >> (i * 8)));
+    }
+}
+
+static void putBinary(std::vector<uint8_t> &out, uint32_t id, const uint8_t *data, size_t len) {
+    putId(out, id);
+    putSize(out, len);
+    out.insert(out.end(), data, data + len);
+}
+
+static void putString(std::vector<uint8_t> &out, uint32_t id, const std::string &text) {
+    putBinary(out, id, reinterpret_cast<const uint8_t *>(text.data()), text.size());
+}
+
+static void putMaster(std::vector<uint8_t> &out, uint32_t id, const std::vector<uint8_t> &children) {
+    putBinary(out, id, children.data(), children.size());
+}
+
+// Chiama visit(nal, len) per ogni NAL del flusso Annex-B, senza start code
+template <typename Visitor>
+static void forEachNal(const uint8_t *data, size_t len, Visitor visit) {
+    size_t i = 0;
+    size_t start = SIZE_MAX;
+    while (i + 3 <= len) {
+        if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+            if (start != SIZE_MAX) {
+                size_t end = i;
+                while (end > start && data[end - 1] == 0) {
+                    end--;
+                }
+                visit(data + start, end - start);
+            }
+            i += 3;
+            start = i;
+        } else {
+            i++;
+        }
+    }
+    if (start != SIZE_MAX && start < len) {
+        visit(data + start, len - start);
+    }
+}
+
+bool MkvWriter::extractParameterSets(const uint8_t *frame, size_t len, std::vector<uint8_t> &sps,
+                                     std::vector<uint8_t> &pps) {
+    sps.clear();
+    pps.clear();
+    forEachNal(frame, len, [&](const uint8_t *nal, size_t size) {
+        const uint8_t type = nal[0] & 0x1f;
+        if (type == NAL_SPS && sps.empty()) {
+            sps.assign(nal, nal + size);
+        } else if (type == NAL_PPS && pps.empty()) {
+            pps.assign(nal, nal + size);
+        }
+    });
+    return sps.size() >= 4 && !pps.empty();
+}
+
+bool MkvWriter::begin(const uint8_t *keyframe, size_t len, uint16_t width, uint16_t height,
+                      std::vector<uint8_t> &out) {
+    if (!extractParameterSets(keyframe, len, sps_, pps_)) {
+        return false;
+    }
+    have_start_ = false;
+    cluster_open_ = false;
+
+    std::vector<uint8_t> ebml;
+    putUint(ebml, EBML_VERSION, 1);
+    putUint(ebml, EBML_READ_VERSION, 1);
+    putUint(ebml, EBML_MAX_ID_LENGTH, 4);
+    putUint(ebml, EBML_MAX_SIZE_LENGTH, 8);
+    putString(ebml, EBML_DOC_TYPE, "matroska");
+    putUint(ebml, EBML_DOC_TYPE_VERSION, 4);
+    putUint(ebml, EBML_DOC_TYPE_READ_VERSION, 2);
+    putMaster(out, EBML_HEADER, ebml);
+
+    putId(out, MKV_SEGMENT);
+    putUnknownSize(out);
+
+    std::vector<uint8_t> info;
+    putUint(info, MKV_TIMECODE_SCALE, 1000000); // Timecode in millisecondi
+    putString(info, MKV_MUXING_APP, "RemoteRc");
+    putString(info, MKV_WRITING_APP, "RemoteRc");
+    putMaster(out, MKV_INFO, info);
+
+    // AVCDecoderConfigurationRecord con un SPS e un PPS, lunghezze dei NAL su 4 byte
+    std::vector<uint8_t> avcc = {1, sps_[1], sps_[2], sps_[3], 0xFF, 0xE1};
+    avcc.push_back(static_cast<uint8_t>(sps_.size() >> 8));
+    avcc.push_back(static_cast<uint8_t>(sps_.size()));
+    avcc.insert(avcc.end(), sps_.begin(), sps_.end());
+    avcc.push_back(1);
+    avcc.push_back(static_cast<uint8_t>(pps_.size() >> 8));
+    avcc.push_back(static_cast<uint8_t>(pps_.size()));
+    avcc.insert(avcc.end(), pps_.begin(), pps_.end());
+
+    std::vector<uint8_t> video;
+    putUint(video, MKV_PIXEL_WIDTH, width);
+    putUint(video, MKV_PIXEL_HEIGHT, height);
+
+    std::vector<uint8_t> track;
+    putUint(track, MKV_TRACK_NUMBER, 1);
+    putUint(track, MKV_TRACK_UID, 1);
+    putUint(track, MKV_TRACK_TYPE, 1); // Video
+    putUint(track, MKV_FLAG_LACING, 0);
+    putString(track, MKV_CODEC_ID, "V_MPEG4/ISO/AVC");
+    putBinary(track, MKV_CODEC_PRIVATE, avcc.data(), avcc.size());
+    putMaster(track, MKV_VIDEO, video);
+
+    std::vector<uint8_t> tracks;
+    putMaster(tracks, MKV_TRACK_ENTRY, track);
+    putMaster(out, MKV_TRACKS, tracks);
+    return true;
+}
+
+void MkvWriter::addFrame(const uint8_t *frame, size_t len, bool keyframe, uint64_t capture_us,
+                         std::vector<uint8_t> &out) {
+    if (!have_start_) {
+        have_start_ = true;
+        start_us_ = capture_us;
+    }
+    const uint64_t time_ms = capture_us > start_us_ ? (capture_us - start_us_) / 1000 : 0;
+
+    // Un cluster per keyframe: i lettori possono saltare a ogni inizio di cluster
+    if (!cluster_open_ || keyframe || time_ms - cluster_ms_ >= MAX_CLUSTER_MS) {
+        putId(out, MKV_CLUSTER);
+        putUnknownSize(out);
+        putUint(out, MKV_TIMECODE, time_ms);
+        cluster_open_ = true;
+        cluster_ms_ = time_ms;
+    }
+
+    // Traccia 1, timecode relativo al cluster, flag keyframe
+    const uint16_t relative = static_cast<uint16_t>(time_ms - cluster_ms_);
+    block_.assign({0x81, static_cast<uint8_t>(relative >> 8), static_cast<uint8_t>(relative),
+                   static_cast<uint8_t>(keyframe ? 0x80 : 0x00)});
+
+    // SPS/PPS sono già nel CodecPrivate, l'AUD non serve al contenitore
+    forEachNal(frame, len, [&](const uint8_t *nal, size_t size) {
+        const uint8_t type = nal[0] & 0x1f;
+        if (type == NAL_SPS || type == NAL_PPS || type == NAL_AUD) {
+            return;
+        }
+        block_.push_back(static_cast<uint8_t>(size >> 24));
+        block_.push_back(static_cast<uint8_t>(size >> 16));
+        block_.push_back(static_cast<uint8_t>(size >> 8));
+        block_.push_back(static_cast<uint8_t>(size));
+        block_.insert(block_.end(), nal, nal + size);
+    });
+
+    putBinary(out, MKV_SIMPLE_BLOCK, block_.data(), block_.size());
+}
@@ -0,0 +1,58 @@
+#include "../include/rrc_power.hpp"
+#include <algorithm>
+
+constexpr uint64_t BATTERY_MAX_AGE_US = 2000000; // La batteria arriva ogni 10 campioni dei sensori
+constexpr uint64_t FLAGS_MAX_AGE_US = 3000000;   // I flag del firmware a 1 Hz
+constexpr uint64_t LOW_CONFIRM_US = 500000;      // Più lunga delle cadute di tensione in accelerazione
+constexpr uint64_t RECOVER_CONFIRM_US = 10000000;
+
+bool PowerMonitor::update(const SensorSnapshot &sensors, uint64_t now_us, const RuntimeConfig &config) {
+    const bool has_battery = sensorFresh(sensors.battery_stamp_us, now_us, BATTERY_MAX_AGE_US);
+    const bool has_flags = sensorFresh(sensors.power_stamp_us, now_us, FLAGS_MAX_AGE_US);
+    battery_mv_ = has_battery ? sensors.battery_mv : 0;
+    power_flags_ = has_flags ? sensors.power_flags : 0;
+    if (has_battery) {
+        min_battery_mv_ = min_battery_mv_ == 0 ? battery_mv_ : std::min(min_battery_mv_, battery_mv_);
+    }
+
+    const bool undervoltage = (power_flags_ & POWER_UNDERVOLTAGE_NOW) != 0;
+    const bool battery_low = has_battery && config.battery_low_mv > 0 && battery_mv_ < config.battery_low_mv;
+    const bool battery_good = !has_battery || config.battery_low_mv == 0 ||
+                              battery_mv_ >= config.battery_low_mv + config.battery_hysteresis_mv;
+
+    if (!low_power_) {
+        // La sottotensione del Pi è già un calo in corso: si entra subito
+        low_since_us_ = battery_low ? (low_since_us_ != 0 ? low_since_us_ : now_us) : 0;
+        if (undervoltage || (low_since_us_ != 0 && now_us - low_since_us_ >= LOW_CONFIRM_US)) {
+            low_power_ = true;
+            reason_ = undervoltage ? UNDERVOLTAGE : BATTERY_LOW;
+            good_since_us_ = 0;
+            entries_++;
+            return true;
+        }
+        return false;
+    }
+
+    good_since_us_ = !undervoltage && battery_good ? (good_since_us_ != 0 ? good_since_us_ : now_us) : 0;
+    if (undervoltage) {
+        reason_ = UNDERVOLTAGE;
+    }
+    if (good_since_us_ != 0 && now_us - good_since_us_ >= RECOVER_CONFIRM_US) {
+        low_power_ = false;
+        reason_ = NONE;
+        low_since_us_ = 0;
+        return true;
+    }
+    return false;
+}
+
+const char *powerReasonName(PowerMonitor::Reason reason) {
+    switch (reason) {
+    case PowerMonitor::BATTERY_LOW:
+        return "batteria scarica";
+    case PowerMonitor::UNDERVOLTAGE:
+        return "sottotensione del Pi";
+    default:
+        return "normale";
+    }
+}
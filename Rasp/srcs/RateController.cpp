@@ -0,0 +1,81 @@
+#include "../include/rrc_rate.hpp"
+#include <algorithm>
+
+// Dal più alto al più basso; il primo è quello di partenza
+static const VideoTier VIDEO_TIERS[] = {
+    {4000000, 1280, 720, 30},
+    {2500000, 1280, 720, 30},
+    {1500000, 960, 540, 30},
+    {1000000, 854, 480, 25},
+    {600000, 640, 360, 20},
+    {300000, 480, 270, 15},
+};
+constexpr size_t TIER_COUNT = sizeof(VIDEO_TIERS) / sizeof(VIDEO_TIERS[0]);
+constexpr size_t LOW_POWER_TIER = TIER_COUNT - 2; // 640x360@20
+
+constexpr double LOSS_DECREASE = 0.10;      // Sopra il 10% di perdite si riduce
+constexpr double LOSS_INCREASE = 0.02;      // Sotto il 2% si può salire
+constexpr uint32_t QUEUE_OVERUSE_US = 60000; // Coda oltre 60 ms: collegamento saturo
+constexpr uint32_t QUEUE_CLEAR_US = 15000;
+constexpr double INCREASE_PER_SECOND = 0.08;
+constexpr uint64_t DOWNGRADE_HOLD_MS = 2000;
+constexpr uint64_t UPGRADE_HOLD_MS = 10000;
+
+RateController::RateController()
+    : target_bps_(VIDEO_TIERS[0].bitrate), tier_index_(0) {}
+
+const VideoTier &RateController::tier() const {
+    return VIDEO_TIERS[tier_index_];
+}
+
+size_t RateController::tierFor(double bitrate) const {
+    for (size_t i = 0; i < TIER_COUNT; ++i) {
+        if (VIDEO_TIERS[i].bitrate <= bitrate) {
+            return i;
+        }
+    }
+    return TIER_COUNT - 1;
+}
+
+bool RateController::onReport(const ReceiverReport &report, uint64_t now_ms) {
+    const double loss = report.loss_permille / 1000.0;
+    const double seconds = report.interval_ms / 1000.0;
+    const double received_bps = report.receive_kbps * 1000.0;
+    const bool overuse = report.queue_delay_us > QUEUE_OVERUSE_US;
+
+    if (loss > LOSS_DECREASE || overuse) {
+        double reduced = target_bps_ * (1.0 - 0.5 * loss);
+        if (overuse && received_bps > 0) {
+            // Quello che arriva davvero è la capacità attuale: ci si mette sotto per svuotare la coda
+            reduced = std::min(reduced, 0.85 * received_bps);
+        }
+        target_bps_ = reduced;
+    } else if (loss < LOSS_INCREASE && report.queue_delay_us < QUEUE_CLEAR_US && report.frames_dropped == 0) {
+        target_bps_ *= 1.0 + INCREASE_PER_SECOND * seconds;
+    }
+    target_bps_ = std::clamp(target_bps_, static_cast<double>(VIDEO_TIERS[TIER_COUNT - 1].bitrate),
+                             static_cast<double>(VIDEO_TIERS[best_tier_].bitrate));
+
+    const size_t wanted = tierFor(target_bps_);
+    const uint64_t since_change = now_ms - last_change_ms_;
+    if (wanted > tier_index_ && since_change >= DOWNGRADE_HOLD_MS) {
+        tier_index_ = wanted;
+    } else if (wanted < tier_index_ && since_change >= UPGRADE_HOLD_MS) {
+        tier_index_--; // In salita un gradino alla volta
+    } else {
+        return false;
+    }
+    last_change_ms_ = now_ms;
+    return true;
+}
+
+bool RateController::setLowPower(bool low_power, uint64_t now_ms) {
+    best_tier_ = low_power ? LOW_POWER_TIER : 0;
+    if (tier_index_ >= best_tier_) {
+        return false; // In uscita si risale con i report, un gradino alla volta
+    }
+    tier_index_ = best_tier_;
+    target_bps_ = std::min(target_bps_, static_cast<double>(VIDEO_TIERS[best_tier_].bitrate));
+    last_change_ms_ = now_ms;
+    return true;
+}
@@ -0,0 +1,259 @@
+#include "../include/rrc_reactor.hpp"
+#include "../include/rrc_rasp.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <netinet/ip.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/timerfd.h>
+
+Reactor::Reactor() : epoll_fd_(epoll_create1(EPOLL_CLOEXEC)) {
+    if (epoll_fd_ < 0) {
+        perror("epoll_create1 failed");
+    }
+}
+
+Reactor::~Reactor() {
+    for (Source &source : sources_) {
+        if (source.timer) {
+            close(source.fd);
+        }
+    }
+    if (epoll_fd_ >= 0) {
+        close(epoll_fd_);
+    }
+}
+
+bool Reactor::add(int fd, uint32_t events, Handler handler, void *ctx, bool urgent) {
+    for (size_t i = 0; i < MAX_SOURCES; ++i) {
+        if (sources_[i].fd >= 0) {
+            continue;
+        }
+        struct epoll_event event{};
+        event.events = events;
+        event.data.u32 = static_cast<uint32_t>(i); // L'evento porta l'indice: nessuna ricerca al dispatch
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+            perror("epoll_ctl failed");
+            return false;
+        }
+        sources_[i].fd = fd;
+        sources_[i].handler = handler;
+        sources_[i].ctx = ctx;
+        sources_[i].urgent = urgent;
+        sources_[i].timer = false;
+        return true;
+    }
+    std::cerr << "Reactor: troppe sorgenti (" << MAX_SOURCES << ")" << std::endl;
+    return false;
+}
+
+int Reactor::addTimer(uint64_t period_us, Handler handler, void *ctx) {
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) {
+        perror("timerfd_create failed");
+        return -1;
+    }
+    struct itimerspec spec{};
+    spec.it_interval.tv_sec = static_cast<time_t>(period_us / 1000000);
+    spec.it_interval.tv_nsec = static_cast<long>(period_us % 1000000) * 1000;
+    spec.it_value = spec.it_interval;
+    if (timerfd_settime(fd, 0, &spec, nullptr) < 0 || !add(fd, EPOLLIN, handler, ctx)) {
+        close(fd);
+        return -1;
+    }
+    for (Source &source : sources_) {
+        if (source.fd == fd) {
+            source.timer = true;
+        }
+    }
+    return fd;
+}
+
+bool Reactor::armTimer(int fd, uint64_t deadline_us) {
+    // monotonicMicros usa steady_clock, cioè CLOCK_MONOTONIC come il timerfd
+    struct itimerspec spec{};
+    spec.it_value.tv_sec = static_cast<time_t>(deadline_us / 1000000);
+    spec.it_value.tv_nsec = static_cast<long>(deadline_us % 1000000) * 1000;
+    return timerfd_settime(fd, deadline_us != 0 ? TFD_TIMER_ABSTIME : 0, &spec, nullptr) == 0;
+}
+
+void Reactor::remove(int fd) {
+    for (Source &source : sources_) {
+        if (source.fd != fd) {
+            continue;
+        }
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        if (source.timer) {
+            close(fd);
+        }
+        source = Source();
+    }
+}
+
+void Reactor::dispatch(Source &source, uint32_t events) {
+    if (source.fd < 0) {
+        return; // Rimossa da un handler precedente nello stesso risveglio
+    }
+    if (source.timer) {
+        uint64_t expirations = 0;
+        if (read(source.fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+            return;
+        }
+        if (expirations > 1) {
+            stats_.timer_overruns += expirations - 1;
+        }
+    }
+
+    const uint64_t start = monotonicMicros();
+    source.handler(source.ctx, source.fd, events);
+    stats_.dispatches++;
+    stats_.max_dispatch_us = std::max(stats_.max_dispatch_us, monotonicMicros() - start);
+}
+
+void Reactor::run() {
+    struct epoll_event events[MAX_EVENTS];
+    running_ = true;
+
+    while (running_) {
+        int ready = 0;
+        if (spin_us_ > 0) {
+            const uint64_t until_us = monotonicMicros() + spin_us_;
+            do {
+                ready = epoll_wait(epoll_fd_, events, MAX_EVENTS, 0);
+            } while (ready == 0 && monotonicMicros() < until_us);
+            if (ready > 0) {
+                stats_.spin_hits++;
+            } else {
+                stats_.spin_sleeps++;
+            }
+        }
+        if (ready == 0) {
+            ready = epoll_wait(epoll_fd_, events, MAX_EVENTS, -1);
+        }
+        if (ready < 0) {
+            if (errno != EINTR) {
+                perror("epoll_wait failed");
+                return;
+            }
+            continue;
+        }
+        woke_us_ = monotonicMicros();
+        stats_.wakeups++;
+
+        for (int pass = 0; pass < 2 && running_; ++pass) {
+            for (int i = 0; i < ready && running_; ++i) {
+                Source &source = sources_[events[i].data.u32];
+                if (source.urgent == (pass == 0)) {
+                    dispatch(source, events[i].events);
+                }
+            }
+        }
+    }
+}
+
+static cpu_set_t other_cpus; // Calcolato una volta: leaveRealtimeCpu non deve allocare né leggere /sys
+static bool realtime_pinned = false;
+
+bool enterRealtime(int cpu, int priority) {
+    const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (priority <= 0 || cpu < 0 || cpu >= cpus) {
+        return false;
+    }
+
+    CPU_ZERO(&other_cpus);
+    for (long i = 0; i < cpus; ++i) {
+        if (i != cpu) {
+            CPU_SET(i, &other_cpus);
+        }
+    }
+
+    cpu_set_t mine;
+    CPU_ZERO(&mine);
+    CPU_SET(cpu, &mine);
+    if (sched_setaffinity(0, sizeof(mine), &mine) < 0) {
+        perror("sched_setaffinity failed");
+        return false;
+    }
+    realtime_pinned = CPU_COUNT(&other_cpus) > 0;
+
+    // Le pagine già mappate restano in RAM: niente page fault sul percorso dei comandi
+    if (mlockall(MCL_CURRENT) < 0) {
+        perror("mlockall failed");
+    }
+
+    struct sched_param param{};
+    param.sched_priority = priority;
+    if (sched_setscheduler(0, SCHED_FIFO | SCHED_RESET_ON_FORK, &param) < 0) {
+        perror("sched_setscheduler failed (serve CAP_SYS_NICE)");
+        return false;
+    }
+    return true;
+}
+
+void leaveRealtimeCpu() {
+    if (realtime_pinned) {
+        sched_setaffinity(0, sizeof(other_cpus), &other_cpus);
+    }
+}
+
+bool enterHelperRealtime(int priority) {
+    leaveRealtimeCpu();
+    if (priority <= 0) {
+        return false;
+    }
+    struct sched_param param{};
+    param.sched_priority = priority;
+    if (sched_setscheduler(0, SCHED_FIFO | SCHED_RESET_ON_FORK, &param) < 0) {
+        perror("sched_setscheduler failed (serve CAP_SYS_NICE)");
+        return false;
+    }
+    return true;
+}
+
+std::string cpuAffinityList(pid_t id) {
+    cpu_set_t set;
+    if (sched_getaffinity(id, sizeof(set), &set) < 0) {
+        return "?";
+    }
+    // Intervalli contigui compressi come in /proc/self/status (Cpus_allowed_list)
+    std::string list;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &set)) {
+            continue;
+        }
+        int last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &set)) {
+            last++;
+        }
+        list += (list.empty() ? "" : ",") + std::to_string(cpu) + (last > cpu ? "-" + std::to_string(last) : "");
+        cpu = last;
+    }
+    return list;
+}
+
+bool tuneLowLatencySocket(int fd, int busy_poll_us, int rcvbuf_bytes) {
+    bool ok = true;
+    // Il busy poll serve solo con un driver che lo supporta; valori sopra net.core.busy_read richiedono CAP_NET_ADMIN
+    if (busy_poll_us > 0 && setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_us, sizeof(busy_poll_us)) < 0) {
+        perror("SO_BUSY_POLL non disponibile");
+        ok = false;
+    }
+    // Il kernel raddoppia il valore per l'overhead; il minimo effettivo è di qualche KB
+    if (rcvbuf_bytes > 0 && setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf_bytes, sizeof(rcvbuf_bytes)) < 0) {
+        perror("SO_RCVBUF failed");
+        ok = false;
+    }
+    const int priority = 6; // TC_PRIO_INTERACTIVE: la coda più alta senza CAP_NET_ADMIN
+    if (setsockopt(fd, SOL_SOCKET, SO_PRIORITY, &priority, sizeof(priority)) < 0) {
+        perror("SO_PRIORITY failed");
+        ok = false;
+    }
+    const int tos = IPTOS_DSCP_EF;
+    if (setsockopt(fd, IPPROTO_IP, IP_TOS, &tos, sizeof(tos)) < 0) {
+        perror("IP_TOS failed");
+        ok = false;
+    }
+    return ok;
+}
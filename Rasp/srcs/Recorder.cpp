@@ -0,0 +1,243 @@
+#include "../include/rrc_rasp.hpp"
+#include "../include/rrc_reactor.hpp"
+#include "../include/rrc_record.hpp"
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+constexpr size_t RECORD_QUEUE_BYTES = 8 * 1024 * 1024; // ~16 s a 4 Mbit/s prima di scartare frame
+constexpr size_t RECORD_BATCH_BYTES = 256 * 1024;      // Scritture grandi: meno syscall e meno usura della SD
+constexpr auto RECORD_BATCH_INTERVAL = std::chrono::milliseconds(500);
+
+struct QueuedFrame {
+    std::vector<uint8_t> data;
+    bool keyframe;
+    uint64_t capture_us;
+    uint16_t width;
+    uint16_t height;
+};
+
+// Il relay accoda i frame senza mai attendere la SD; un thread dedicato li scrive a blocchi
+static std::mutex record_mutex;
+static std::condition_variable record_cv;
+static std::deque<QueuedFrame> record_queue;
+static std::vector<std::vector<uint8_t>> record_pool; // Buffer riutilizzati tra relay e writer
+static size_t record_queued_bytes = 0;
+static bool record_waiting_keyframe = true;
+static bool record_active = false;
+static bool record_shutdown = false;
+static std::thread record_thread;
+static RecorderStats record_stats;
+static std::string record_dir = "recordings";
+static int record_segment_s = 300;
+
+void setRecordOptions(const std::string &dir, int segment_s) {
+    std::lock_guard<std::mutex> lock(record_mutex);
+    record_dir = dir;
+    record_segment_s = segment_s;
+}
+
+// Apre un nuovo segmento con data e ora nel nome
+static int openSegment(const std::string &dir, uint64_t index) {
+    mkdir(dir.c_str(), 0755);
+    char stamp[32];
+    const time_t now = time(nullptr);
+    struct tm local;
+    localtime_r(&now, &local);
+    strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", &local);
+
+    const std::string path = dir + "/rrc_" + stamp + "_" + std::to_string(index) + ".mkv";
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "Impossibile creare " << path << ": " << strerror(errno) << std::endl;
+    } else {
+        std::cout << "Registrazione su " << path << std::endl;
+    }
+    return fd;
+}
+
+static void closeSegment(int &fd) {
+    if (fd >= 0) {
+        fdatasync(fd);
+        close(fd);
+        fd = -1;
+    }
+}
+
+static bool writeAll(int fd, const std::vector<uint8_t> &data) {
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = write(fd, data.data() + done, data.size() - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            perror("Scrittura della registrazione fallita");
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+static void recorderLoop() {
+    leaveRealtimeCpu(); // Le attese della SD non toccano la CPU del ciclo dei comandi
+    MkvWriter writer;
+    std::deque<QueuedFrame> batch;
+    std::vector<uint8_t> out;
+    std::vector<uint8_t> sps;
+    std::vector<uint8_t> pps;
+    int fd = -1;
+    uint64_t segment_start_us = 0;
+    uint16_t segment_width = 0;
+    uint16_t segment_height = 0;
+
+    while (true) {
+        std::string dir;
+        int segment_s;
+        bool active;
+        {
+            std::unique_lock<std::mutex> lock(record_mutex);
+            record_cv.wait_for(lock, RECORD_BATCH_INTERVAL, [] {
+                return record_shutdown || record_queued_bytes >= RECORD_BATCH_BYTES;
+            });
+            batch.swap(record_queue);
+            record_queued_bytes = 0;
+            dir = record_dir;
+            segment_s = record_segment_s;
+            active = record_active;
+            if (batch.empty() && record_shutdown) {
+                break;
+            }
+        }
+
+        out.clear();
+        uint64_t written = 0;
+        for (QueuedFrame &frame : batch) {
+            if (frame.keyframe) {
+                // Nuovo file allo scadere del segmento o se cambia la risoluzione dell'encoder
+                MkvWriter::extractParameterSets(frame.data.data(), frame.data.size(), sps, pps);
+                const bool expired = frame.capture_us - segment_start_us >= static_cast<uint64_t>(segment_s) * 1000000;
+                const bool changed = sps != writer.sps() || frame.width != segment_width || frame.height != segment_height;
+                if (fd < 0 || expired || changed) {
+                    if (fd >= 0 && !out.empty()) {
+                        writeAll(fd, out);
+                    }
+                    out.clear();
+                    closeSegment(fd);
+                    if (writer.begin(frame.data.data(), frame.data.size(), frame.width, frame.height, out)) {
+                        fd = openSegment(dir, record_stats.segments);
+                        segment_start_us = frame.capture_us;
+                        segment_width = frame.width;
+                        segment_height = frame.height;
+                        std::lock_guard<std::mutex> lock(record_mutex);
+                        record_stats.segments++;
+                    }
+                }
+            }
+            if (fd >= 0) {
+                writer.addFrame(frame.data.data(), frame.data.size(), frame.keyframe, frame.capture_us, out);
+                written++;
+            }
+        }
+
+        if (fd >= 0 && !out.empty()) {
+            const uint64_t start = monotonicMicros();
+            if (!writeAll(fd, out)) {
+                closeSegment(fd); // SD piena o rimossa: si riprova con un nuovo file al prossimo keyframe
+            }
+            const uint64_t elapsed = monotonicMicros() - start;
+            std::lock_guard<std::mutex> lock(record_mutex);
+            record_stats.bytes_written += out.size();
+            record_stats.max_write_us = std::max(record_stats.max_write_us, elapsed);
+        }
+
+        std::lock_guard<std::mutex> lock(record_mutex);
+        record_stats.frames_written += written;
+        for (QueuedFrame &frame : batch) {
+            record_pool.push_back(std::move(frame.data));
+        }
+        batch.clear();
+        if (!active && record_queue.empty()) {
+            closeSegment(fd);
+        }
+    }
+    closeSegment(fd);
+}
+
+void setRecording(bool enabled) {
+    std::lock_guard<std::mutex> lock(record_mutex);
+    if (enabled == record_active) {
+        return;
+    }
+    record_active = enabled;
+    record_stats.active = enabled;
+    record_waiting_keyframe = true;
+    if (enabled && !record_thread.joinable()) {
+        record_thread = std::thread(recorderLoop);
+    }
+    record_cv.notify_one();
+    std::cout << (enabled ? "Registrazione avviata" : "Registrazione fermata") << std::endl;
+}
+
+bool isRecording() {
+    std::lock_guard<std::mutex> lock(record_mutex);
+    return record_active;
+}
+
+RecorderStats recorderStats() {
+    std::lock_guard<std::mutex> lock(record_mutex);
+    return record_stats;
+}
+
+// Chiamata dal relay per ogni frame: copia e accoda, non attende mai la scrittura.
+// Se la coda è piena il frame viene perso e si riprende dal prossimo keyframe.
+void recordVideoFrame(const uint8_t *data, size_t len, bool keyframe, uint64_t capture_us,
+                      uint16_t width, uint16_t height) {
+    std::lock_guard<std::mutex> lock(record_mutex);
+    if (!record_active) {
+        return;
+    }
+    if (record_waiting_keyframe && !keyframe) {
+        return;
+    }
+    if (record_queued_bytes + len > RECORD_QUEUE_BYTES) {
+        record_stats.frames_dropped++;
+        record_waiting_keyframe = true;
+        return;
+    }
+    record_waiting_keyframe = false;
+
+    QueuedFrame frame;
+    if (!record_pool.empty()) {
+        frame.data = std::move(record_pool.back());
+        record_pool.pop_back();
+    }
+    frame.data.assign(data, data + len);
+    frame.keyframe = keyframe;
+    frame.capture_us = capture_us;
+    frame.width = width;
+    frame.height = height;
+    record_queue.push_back(std::move(frame));
+    record_queued_bytes += len;
+    if (record_queued_bytes >= RECORD_BATCH_BYTES) {
+        record_cv.notify_one();
+    }
+}
+
+// Scrive quanto è in coda e chiude il file; chiamata all'uscita del programma
+void shutdownRecorder() {
+    {
+        std::lock_guard<std::mutex> lock(record_mutex);
+        record_active = false;
+        record_shutdown = true;
+    }
+    record_cv.notify_one();
+    if (record_thread.joinable()) {
+        record_thread.join();
+    }
+}
@@ -0,0 +1,390 @@
+#include "../include/rrc_sensors.hpp"
+#include "../include/rrc_rasp.hpp"
+#include "../include/rrc_reactor.hpp"
+#include "../include/rrc_spsc.hpp"
+#ifdef RRC_SIMULATION
+# include "../include/rrc_simvehicle.hpp"
+#endif
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <random>
+#include <sys/ioctl.h>
+
+constexpr double G_M_S2 = 9.81;
+constexpr int BATTERY_DIVIDER = 10;         // La batteria cambia lentamente: una lettura ogni 10 campioni
+static const char *const THROTTLED_SYSFS = "/sys/devices/platform/soc/soc:firmware/get_throttled";
+static const char *const VCIO_DEVICE = "/dev/vcio";
+constexpr unsigned long VCIO_IOCTL_MBOX_PROPERTY = _IOWR(100, 0, char *); // Come vcmailbox
+constexpr uint32_t MAILBOX_TAG_GET_THROTTLED = 0x00030046;
+constexpr uint32_t MAILBOX_RESPONSE_OK = 0x80000000;
+
+// MPU-6050, montato con X in avanti, Y a sinistra, Z in alto
+constexpr uint8_t MPU_PWR_MGMT_1 = 0x6B;
+constexpr uint8_t MPU_CONFIG = 0x1A;        // Filtro passa basso interno
+constexpr uint8_t MPU_GYRO_CONFIG = 0x1B;
+constexpr uint8_t MPU_ACCEL_CONFIG = 0x1C;
+constexpr uint8_t MPU_ACCEL_XOUT_H = 0x3B;  // 14 byte: accelerazioni, temperatura, giroscopi
+constexpr double MPU_ACCEL_LSB_G = 8192.0;  // Fondo scala ±4 g
+constexpr double MPU_GYRO_LSB_DEG_S = 65.5; // Fondo scala ±500 °/s
+
+// ADS1115: AIN0 rispetto a massa, ±4.096 V, conversione continua a 128 campioni/s
+constexpr uint8_t ADS_CONVERSION = 0x00;
+constexpr uint8_t ADS_CONFIG = 0x01;
+constexpr uint16_t ADS_CONFIG_AIN0_CONTINUOUS = 0x4283;
+constexpr double ADS_LSB_MV = 0.125;
+
+// Batteria simulata: scarica lenta più caduta sotto carico, come una LiPo 2S
+constexpr double SIM_DRAIN_MV_PER_S = 0.5;
+constexpr double SIM_SAG_MV_PER_M_S2 = 60.0;
+constexpr double SIM_IMU_NOISE_M_S2 = 0.05;
+constexpr int SIM_BROWNOUT_MV = 6000;       // Sotto, il BEC non tiene più i 5 V del Pi
+
+static SpscRing<SensorSample, 256> sensor_ring;
+static std::thread sensor_thread;
+static std::atomic<bool> sensors_running{false};
+static SensorSnapshot sensor_snapshot; // Solo thread dei comandi
+
+static std::atomic<int> stats_source{SENSORS_OFF};
+static std::atomic<int> stats_rate_hz{0};
+static std::atomic<uint64_t> stats_samples{0};
+static std::atomic<uint64_t> stats_dropped{0};
+static std::atomic<uint64_t> stats_read_errors{0};
+static std::atomic<uint64_t> stats_overruns{0};
+static std::atomic<uint64_t> stats_max_read_us{0};
+
+// Parametri copiati all'avvio: il thread dei sensori non legge la configurazione attiva
+struct SensorParams {
+    SensorSource source;
+    int rate_hz;
+    int i2c_fd;
+    int imu_address;
+    int adc_address;
+    int battery_scale_x1000;
+    int sim_battery_mv;
+    int rt_priority;
+};
+
+bool parseSensorSource(const std::string &name, SensorSource &source) {
+    if (name == "off") {
+        source = SENSORS_OFF;
+    } else if (name == "firmware") {
+        source = SENSORS_FIRMWARE;
+    } else if (name == "i2c") {
+        source = SENSORS_I2C;
+#ifdef RRC_SIMULATION
+    } else if (name == "sim") {
+        source = SENSORS_SIM;
+#endif
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char *sensorSourceName(SensorSource source) {
+    switch (source) {
+    case SENSORS_FIRMWARE:
+        return "firmware";
+    case SENSORS_I2C:
+        return "i2c";
+    case SENSORS_SIM:
+        return "sim";
+    default:
+        return "off";
+    }
+}
+
+static bool i2cWrite(int fd, int address, uint8_t reg, const uint8_t *data, size_t len) {
+    uint8_t buffer[8];
+    if (len + 1 > sizeof(buffer)) {
+        return false;
+    }
+    buffer[0] = reg;
+    memcpy(buffer + 1, data, len);
+    struct i2c_msg message = {static_cast<uint16_t>(address), 0, static_cast<uint16_t>(len + 1), buffer};
+    struct i2c_rdwr_ioctl_data transfer = {&message, 1};
+    return ioctl(fd, I2C_RDWR, &transfer) == 1;
+}
+
+// Scrittura del registro e lettura in una sola transazione (start ripetuto)
+static bool i2cRead(int fd, int address, uint8_t reg, uint8_t *data, size_t len) {
+    struct i2c_msg messages[2] = {
+        {static_cast<uint16_t>(address), 0, 1, &reg},
+        {static_cast<uint16_t>(address), I2C_M_RD, static_cast<uint16_t>(len), data},
+    };
+    struct i2c_rdwr_ioctl_data transfer = {messages, 2};
+    return ioctl(fd, I2C_RDWR, &transfer) == 2;
+}
+
+static int16_t bigEndian16(const uint8_t *data) {
+    return static_cast<int16_t>((data[0] << 8) | data[1]);
+}
+
+static bool setupI2cDevices(const SensorParams &params) {
+    const uint8_t wake = 0x00;
+    const uint8_t lowpass = 0x03; // ~44 Hz: toglie le vibrazioni del motore, non gli urti
+    const uint8_t gyro_500 = 0x08;
+    const uint8_t accel_4g = 0x08;
+    const uint8_t ads_config[2] = {ADS_CONFIG_AIN0_CONTINUOUS >> 8, ADS_CONFIG_AIN0_CONTINUOUS & 0xFF};
+    bool ok = i2cWrite(params.i2c_fd, params.imu_address, MPU_PWR_MGMT_1, &wake, 1) &&
+              i2cWrite(params.i2c_fd, params.imu_address, MPU_CONFIG, &lowpass, 1) &&
+              i2cWrite(params.i2c_fd, params.imu_address, MPU_GYRO_CONFIG, &gyro_500, 1) &&
+              i2cWrite(params.i2c_fd, params.imu_address, MPU_ACCEL_CONFIG, &accel_4g, 1);
+    if (!ok) {
+        perror("IMU I2C non risponde");
+        return false;
+    }
+    if (!i2cWrite(params.i2c_fd, params.adc_address, ADS_CONFIG, ads_config, 2)) {
+        perror("ADC della batteria non risponde, solo IMU");
+    }
+    return true;
+}
+
+// Richiesta di proprietà alla mailbox del firmware: dimensione, codice, tag, dimensione del
+// valore, lunghezza della richiesta, valore, tag di fine
+static bool mailboxThrottled(uint32_t &flags) {
+    const int fd = open(VCIO_DEVICE, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    uint32_t message[7] = {sizeof(message), 0, MAILBOX_TAG_GET_THROTTLED, 4, 4, 0, 0};
+    const bool ok = ioctl(fd, VCIO_IOCTL_MBOX_PROPERTY, message) == 0 && message[1] == MAILBOX_RESPONSE_OK;
+    close(fd);
+    if (ok) {
+        flags = message[5];
+    }
+    return ok;
+}
+
+// Il file di sysfs dei kernel recenti costa una lettura; altrimenti la stessa proprietà chiesta
+// alla mailbox con una ioctl. Niente vcgencmd: un fork del server bloccato in RAM e con più thread
+// ogni secondo costerebbe più della lettura stessa.
+static bool readThrottled(uint32_t &flags) {
+    unsigned value = 0;
+    if (FILE *file = fopen(THROTTLED_SYSFS, "re")) {
+        const bool ok = fscanf(file, "%x", &value) == 1;
+        fclose(file);
+        flags = value;
+        return ok;
+    }
+    return mailboxThrottled(flags);
+}
+
+static void readFirmware(SensorSample &sample) {
+    if (readThrottled(sample.power_flags)) {
+        sample.flags |= SENSOR_POWER;
+    } else {
+        stats_read_errors++;
+    }
+}
+
+static void readI2c(const SensorParams &params, bool battery, SensorSample &sample) {
+    uint8_t raw[14];
+    if (i2cRead(params.i2c_fd, params.imu_address, MPU_ACCEL_XOUT_H, raw, sizeof(raw))) {
+        sample.flags |= SENSOR_IMU;
+        sample.accel_long_m_s2 = static_cast<float>(bigEndian16(raw) / MPU_ACCEL_LSB_G * G_M_S2);
+        sample.accel_lat_m_s2 = static_cast<float>(-bigEndian16(raw + 2) / MPU_ACCEL_LSB_G * G_M_S2);
+        sample.yaw_rate_rad_s = static_cast<float>(-bigEndian16(raw + 12) / MPU_GYRO_LSB_DEG_S * M_PI / 180.0);
+    } else {
+        stats_read_errors++;
+    }
+    uint8_t conversion[2];
+    if (battery) {
+        if (i2cRead(params.i2c_fd, params.adc_address, ADS_CONVERSION, conversion, sizeof(conversion))) {
+            const double adc_mv = std::max<int>(bigEndian16(conversion), 0) * ADS_LSB_MV;
+            sample.flags |= SENSOR_BATTERY;
+            sample.battery_mv = static_cast<uint16_t>(std::min(adc_mv * params.battery_scale_x1000 / 1000.0, 65535.0));
+        } else {
+            stats_read_errors++;
+        }
+    }
+}
+
+#ifdef RRC_SIMULATION
+// IMU con un po' di rumore, sensore delle ruote e batteria che cala sotto carico
+static void readSim(const SensorParams &params, bool battery, uint64_t start_us, std::mt19937 &rng,
+                    SensorSample &sample) {
+    SimVehicleState state;
+    if (!readSimVehicle(state)) {
+        return; // Il modello non ha ancora fatto un passo
+    }
+    std::normal_distribution<double> noise(0.0, SIM_IMU_NOISE_M_S2);
+    sample.flags |= SENSOR_IMU | SENSOR_WHEEL;
+    sample.accel_long_m_s2 = static_cast<float>(state.accel_long_m_s2 + noise(rng));
+    sample.accel_lat_m_s2 = static_cast<float>(state.accel_lat_m_s2 + noise(rng));
+    sample.yaw_rate_rad_s = std::fabs(state.speed_m_s) > 0.05 ? static_cast<float>(state.accel_lat_m_s2 / state.speed_m_s) : 0.0f;
+    sample.wheel_speed_m_s = static_cast<float>(state.wheel_speed_m_s);
+    if (battery) {
+        const double elapsed_s = (sample.stamp_us - start_us) / 1e6;
+        const double sag_mv = std::max(state.accel_long_m_s2, 0.0) * SIM_SAG_MV_PER_M_S2;
+        sample.flags |= SENSOR_BATTERY | SENSOR_POWER;
+        sample.battery_mv = static_cast<uint16_t>(std::max(params.sim_battery_mv - elapsed_s * SIM_DRAIN_MV_PER_S - sag_mv, 0.0));
+        static uint32_t since_boot = 0;
+        const uint32_t now = sample.battery_mv < SIM_BROWNOUT_MV ? POWER_UNDERVOLTAGE_NOW : 0;
+        since_boot |= now << 16;
+        sample.power_flags = now | since_boot;
+    }
+}
+#endif
+
+static void addMicros(struct timespec &time, uint64_t micros) {
+    time.tv_nsec += static_cast<long>(micros % 1000000) * 1000;
+    time.tv_sec += static_cast<time_t>(micros / 1000000) + time.tv_nsec / 1000000000;
+    time.tv_nsec %= 1000000000;
+}
+
+// Scadenze assolute: la cadenza non deriva con la durata delle letture. Se una lettura supera
+// il periodo si salta al prossimo istante libero invece di recuperare a raffica.
+static void sensorLoop(SensorParams params) {
+    // Le attese sul bus I2C non toccano la CPU del ciclo dei comandi; sotto la sua priorità la
+    // cadenza resta regolare anche con il video che carica le altre CPU
+    enterHelperRealtime(params.rt_priority);
+    const uint64_t period_us = 1000000 / static_cast<uint64_t>(params.rate_hz);
+#ifdef RRC_SIMULATION
+    const uint64_t start_us = monotonicMicros();
+    std::mt19937 rng(1);
+#endif
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (uint64_t count = 0; sensors_running.load(std::memory_order_relaxed); ++count) {
+        SensorSample sample;
+        sample.stamp_us = monotonicMicros();
+        const bool battery = count % BATTERY_DIVIDER == 0;
+        const bool power = count % static_cast<uint64_t>(params.rate_hz) == 0; // 1 Hz
+        if (params.source == SENSORS_I2C) {
+            readI2c(params, battery, sample);
+        }
+        if ((params.source == SENSORS_I2C || params.source == SENSORS_FIRMWARE) && power) {
+            readFirmware(sample);
+        }
+#ifdef RRC_SIMULATION
+        else if (params.source == SENSORS_SIM) {
+            readSim(params, battery, start_us, rng, sample);
+        }
+#endif
+        const uint64_t read_us = monotonicMicros() - sample.stamp_us;
+        if (read_us > stats_max_read_us.load(std::memory_order_relaxed)) {
+            stats_max_read_us.store(read_us, std::memory_order_relaxed);
+        }
+        if (sample.flags != 0) {
+            stats_samples++;
+            if (!sensor_ring.push(sample)) {
+                stats_dropped++;
+            }
+        }
+
+        addMicros(next, period_us);
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > next.tv_sec || (now.tv_sec == next.tv_sec && now.tv_nsec >= next.tv_nsec)) {
+            stats_overruns++;
+            next = now;
+            continue;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr) == EINTR) {
+        }
+    }
+    if (params.i2c_fd >= 0) {
+        close(params.i2c_fd);
+    }
+}
+
+bool startSensors(SensorSource source, int rt_priority) {
+    stats_source.store(source);
+    if (source == SENSORS_OFF || sensors_running.load()) {
+        return source == SENSORS_OFF;
+    }
+    const RuntimeConfig &config = activeConfig();
+    SensorParams params{source, config.sensor_rate_hz, -1, config.imu_i2c_address, config.adc_i2c_address,
+                        config.battery_scale_x1000, config.sim_battery_mv, rt_priority};
+    uint32_t flags = 0;
+    if (source == SENSORS_FIRMWARE) {
+        params.rate_hz = 1; // Niente da campionare più spesso
+        if (!readThrottled(flags)) {
+            std::cerr << "Flag di alimentazione del firmware non disponibili (get_throttled)" << std::endl;
+            stats_source.store(SENSORS_OFF);
+            return false;
+        }
+    }
+    if (source == SENSORS_I2C) {
+        params.i2c_fd = open(config.i2c_bus.c_str(), O_RDWR | O_CLOEXEC);
+        if (params.i2c_fd < 0) {
+            perror(("Bus I2C " + config.i2c_bus + " non disponibile").c_str());
+            stats_source.store(SENSORS_OFF);
+            return false;
+        }
+        if (!setupI2cDevices(params)) {
+            close(params.i2c_fd);
+            stats_source.store(SENSORS_OFF);
+            return false;
+        }
+    }
+    stats_rate_hz.store(params.rate_hz);
+    sensors_running.store(true);
+    sensor_thread = std::thread(sensorLoop, params);
+    return true;
+}
+
+void stopSensors() {
+    if (!sensors_running.exchange(false)) {
+        return;
+    }
+    if (sensor_thread.joinable()) {
+        sensor_thread.join();
+    }
+}
+
+const SensorSnapshot &pollSensors() {
+    sensor_snapshot.peak_accel_m_s2 = 0.0;
+    SensorSample sample;
+    while (sensor_ring.pop(sample)) {
+        if (sample.flags & SENSOR_IMU) {
+            sensor_snapshot.imu_stamp_us = sample.stamp_us;
+            sensor_snapshot.accel_long_m_s2 = sample.accel_long_m_s2;
+            sensor_snapshot.accel_lat_m_s2 = sample.accel_lat_m_s2;
+            sensor_snapshot.yaw_rate_rad_s = sample.yaw_rate_rad_s;
+            sensor_snapshot.peak_accel_m_s2 = std::max<double>(sensor_snapshot.peak_accel_m_s2,
+                                                               std::hypot(sample.accel_long_m_s2, sample.accel_lat_m_s2));
+        }
+        if (sample.flags & SENSOR_WHEEL) {
+            sensor_snapshot.wheel_stamp_us = sample.stamp_us;
+            sensor_snapshot.wheel_speed_m_s = sample.wheel_speed_m_s;
+        }
+        if (sample.flags & SENSOR_BATTERY) {
+            sensor_snapshot.battery_stamp_us = sample.stamp_us;
+            sensor_snapshot.battery_mv = sample.battery_mv;
+        }
+        if (sample.flags & SENSOR_POWER) {
+            sensor_snapshot.power_stamp_us = sample.stamp_us;
+            sensor_snapshot.power_flags = sample.power_flags;
+        }
+    }
+    return sensor_snapshot;
+}
+
+const SensorSnapshot &sensorSnapshot() {
+    return sensor_snapshot;
+}
+
+bool sensorFresh(uint64_t stamp_us, uint64_t now_us, uint64_t max_age_us) {
+    return stamp_us != 0 && now_us - stamp_us <= max_age_us;
+}
+
+SensorStats sensorStats() {
+    SensorStats stats;
+    stats.source = static_cast<SensorSource>(stats_source.load());
+    stats.rate_hz = stats_rate_hz.load();
+    stats.samples = stats_samples.load();
+    stats.dropped = stats_dropped.load();
+    stats.read_errors = stats_read_errors.load();
+    stats.overruns = stats_overruns.load();
+    stats.max_read_us = stats_max_read_us.load();
+    return stats;
+}
@@ -0,0 +1,38 @@
+#include "../include/rrc_simgpio.hpp"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+constexpr int SIM_PIN_COUNT = 64;
+
+static std::atomic<int> pwm_values[SIM_PIN_COUNT];
+
+static bool validPin(int pin) {
+    return pin >= 0 && pin < SIM_PIN_COUNT;
+}
+
+int wiringPiSetup() {
+    return 0;
+}
+
+void pinMode(int, int) {}
+
+void pwmSetMode(int) {}
+
+void pwmSetRange(unsigned int) {}
+
+void pwmSetClock(int) {}
+
+void pwmWrite(int pin, int value) {
+    if (validPin(pin)) {
+        pwm_values[pin].store(value, std::memory_order_relaxed);
+    }
+}
+
+void delay(unsigned int ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+int simPwmRead(int pin) {
+    return validPin(pin) ? pwm_values[pin].load(std::memory_order_relaxed) : 0;
+}
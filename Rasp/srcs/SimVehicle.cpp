@@ -0,0 +1,111 @@
+#include "../include/rrc_simvehicle.hpp"
+#include <algorithm>
+#include <cmath>
+
+constexpr double STOP_SPEED_M_S = 0.02; // Sotto questa velocità in folle l'auto è ferma
+
+static bool inZone(int pulse_us, int neutral_us, int dead_zone_us, int sign) {
+    return sign > 0 ? pulse_us >= neutral_us + dead_zone_us : pulse_us <= neutral_us - dead_zone_us;
+}
+
+SimEsc::State SimEsc::onPulse(int pulse_us, const RuntimeConfig &config, double frame_s) {
+    const bool forward = inZone(pulse_us, config.pwm_neutral_us, config.dead_zone_us, 1);
+    const bool backward = inZone(pulse_us, config.pwm_neutral_us, config.dead_zone_us, -1);
+    if (forward) {
+        state_ = FORWARD;
+    } else if (backward) {
+        // Dal folle dopo la marcia avanti, o dalla marcia avanti, si frena; si va indietro solo se armato
+        if (state_ == FORWARD || state_ == NEUTRAL) {
+            state_ = BRAKE;
+        } else if (state_ == REVERSE_ARMED) {
+            state_ = REVERSE;
+        }
+    } else if (state_ == BRAKE || state_ == REVERSE) {
+        state_ = REVERSE_ARMED; // Un impulso in folle dopo il freno arma la retromarcia
+        armed_s_ = frame_s;
+    } else if (state_ == REVERSE_ARMED) {
+        armed_s_ += frame_s;
+        if (config.esc_arm_window_ms > 0 && armed_s_ * 1000.0 >= config.esc_arm_window_ms) {
+            state_ = NEUTRAL;
+        }
+    } else if (state_ == FORWARD) {
+        state_ = NEUTRAL;
+    }
+    return state_;
+}
+
+const char *simEscStateName(SimEsc::State state) {
+    switch (state) {
+    case SimEsc::FORWARD:
+        return "avanti";
+    case SimEsc::BRAKE:
+        return "freno";
+    case SimEsc::REVERSE_ARMED:
+        return "retromarcia armata";
+    case SimEsc::REVERSE:
+        return "retromarcia";
+    default:
+        return "folle";
+    }
+}
+
+void VehicleModel::reset() {
+    esc_.reset();
+    state_ = SimVehicleState();
+}
+
+void VehicleModel::step(int steering_us, int throttle_us, const RuntimeConfig &config, double dt_s) {
+    const double neutral = config.pwm_neutral_us;
+    const double forward_span = std::max(config.pwm_max_us - config.pwm_neutral_us, 1);
+    const double backward_span = std::max(config.pwm_neutral_us - config.pwm_min_us, 1);
+
+    // Servo: insegue l'angolo comandato alla sua velocità massima
+    const double steer_target = std::clamp(steering_us - neutral, -backward_span, forward_span) /
+                                (steering_us >= neutral ? forward_span : backward_span) * MAX_STEER_RAD;
+    const double steer_step = SERVO_RATE_RAD_S * dt_s;
+    state_.steer_rad += std::clamp(steer_target - state_.steer_rad, -steer_step, steer_step);
+
+    // ESC: un impulso per frame. Il motore muove le ruote, le gomme trasmettono all'auto al più
+    // MAX_TRACTION_M_S2; il resto diventa pattinamento che si riassorbe in SLIP_TAU_S
+    const SimEsc::State esc = esc_.onPulse(throttle_us, config, dt_s);
+    const double speed = state_.speed_m_s;
+    double next = speed;
+    if (esc == SimEsc::FORWARD || esc == SimEsc::REVERSE) {
+        const double fraction = esc == SimEsc::FORWARD ? std::min((throttle_us - neutral) / forward_span, 1.0)
+                                                       : -std::min((neutral - throttle_us) / backward_span, 1.0) * REVERSE_SCALE;
+        const double target = fraction * MAX_SPEED_M_S;
+        double wheel = state_.wheel_speed_m_s;
+        // Il motore spinge verso la velocità comandata; se si va più veloci si rallenta rotolando
+        const bool driving = esc == SimEsc::FORWARD ? target > wheel : target < wheel;
+        wheel += (target - wheel) * std::min(dt_s / (driving ? ACCEL_TAU_S : COAST_TAU_S), 1.0);
+        const double grip = MAX_TRACTION_M_S2 * dt_s;
+        next = speed + std::clamp(wheel - speed, -grip, grip);
+        state_.wheel_speed_m_s = wheel - (wheel - next) * std::min(dt_s / SLIP_TAU_S, 1.0);
+    } else if (esc == SimEsc::BRAKE) {
+        const double depth = std::min((neutral - throttle_us) / backward_span, 1.0);
+        const double decel = depth * MAX_BRAKE_M_S2 * dt_s;
+        next = speed > 0.0 ? std::max(speed - decel, 0.0) : std::min(speed + decel, 0.0);
+        state_.wheel_speed_m_s = next;
+    } else {
+        next -= speed * std::min(dt_s / COAST_TAU_S, 1.0);
+        if (std::fabs(next) < STOP_SPEED_M_S) {
+            next = 0.0;
+        }
+        state_.wheel_speed_m_s = next;
+    }
+
+    // Cinematica a bicicletta riferita all'asse posteriore; velocità media del passo
+    const double mean_speed = 0.5 * (speed + next);
+    double yaw_rate = mean_speed / WHEELBASE_M * std::tan(state_.steer_rad);
+    // Oltre l'aderenza delle gomme l'auto sottosterza: la curva si allarga invece di stringersi
+    if (std::fabs(mean_speed * yaw_rate) > MAX_LATERAL_M_S2) {
+        yaw_rate = std::copysign(MAX_LATERAL_M_S2 / std::fabs(mean_speed), yaw_rate);
+    }
+    state_.heading_rad = std::remainder(state_.heading_rad + yaw_rate * dt_s, 2.0 * M_PI);
+    state_.x_m += mean_speed * std::sin(state_.heading_rad) * dt_s;
+    state_.y_m += mean_speed * std::cos(state_.heading_rad) * dt_s;
+    state_.accel_long_m_s2 = dt_s > 0.0 ? (next - speed) / dt_s : 0.0;
+    state_.accel_lat_m_s2 = mean_speed * yaw_rate;
+    state_.speed_m_s = next;
+    state_.esc = esc;
+}
@@ -0,0 +1,217 @@
+#include "../include/rrc_rasp.hpp"
+#include "../include/rrc_simvehicle.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <vector>
+
+constexpr double CAR_REAR_M = 0.07;  // Sagoma disegnata: sbalzo dietro l'asse posteriore
+constexpr double CAR_FRONT_M = 0.33; // e davanti, oltre l'asse anteriore
+static const char *const POSE_SHM_NAME = "/rrc_sim_vehicle";
+
+// Posa condivisa con il processo della vista dall'alto; seqlock: numero dispari durante la scrittura
+struct SharedPose {
+    std::atomic<uint32_t> seq;
+    std::atomic<double> x_m;
+    std::atomic<double> y_m;
+    std::atomic<double> heading_rad;
+    std::atomic<double> speed_m_s;
+    std::atomic<double> steer_rad;
+    std::atomic<double> accel_long_m_s2; // Per l'IMU simulato dei sensori
+    std::atomic<double> accel_lat_m_s2;
+    std::atomic<double> wheel_speed_m_s;
+};
+
+static SharedPose *mapSharedPose(bool create) {
+    const int fd = shm_open(POSE_SHM_NAME, create ? O_RDWR | O_CREAT : O_RDONLY, 0600);
+    if (fd < 0) {
+        return nullptr;
+    }
+    if (create && ftruncate(fd, sizeof(SharedPose)) < 0) {
+        close(fd);
+        return nullptr;
+    }
+    void *memory = mmap(nullptr, sizeof(SharedPose), create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    return memory == MAP_FAILED ? nullptr : static_cast<SharedPose *>(memory);
+}
+
+static VehicleModel sim_vehicle;  // Solo il thread dei comandi
+static SharedPose *published_pose = nullptr;
+
+const SimVehicleState &stepSimVehicle(double dt_s) {
+    const RuntimeConfig &config = activeConfig(); // Thread dei comandi del server, mai la vista (--sim-view)
+    sim_vehicle.step(simPwmRead(config.servo_pin), simPwmRead(config.motor_pin), config, dt_s);
+    const SimVehicleState &state = sim_vehicle.state();
+
+    static bool shm_failed = false;
+    if (!published_pose && !shm_failed) {
+        published_pose = mapSharedPose(true);
+        shm_failed = published_pose == nullptr;
+        if (shm_failed) {
+            perror("Posa del veicolo simulato non condivisa (shm_open)");
+        }
+    }
+    if (published_pose) {
+        const uint32_t seq = published_pose->seq.load(std::memory_order_relaxed);
+        published_pose->seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        published_pose->x_m.store(state.x_m, std::memory_order_relaxed);
+        published_pose->y_m.store(state.y_m, std::memory_order_relaxed);
+        published_pose->heading_rad.store(state.heading_rad, std::memory_order_relaxed);
+        published_pose->speed_m_s.store(state.speed_m_s, std::memory_order_relaxed);
+        published_pose->steer_rad.store(state.steer_rad, std::memory_order_relaxed);
+        published_pose->accel_long_m_s2.store(state.accel_long_m_s2, std::memory_order_relaxed);
+        published_pose->accel_lat_m_s2.store(state.accel_lat_m_s2, std::memory_order_relaxed);
+        published_pose->wheel_speed_m_s.store(state.wheel_speed_m_s, std::memory_order_relaxed);
+        published_pose->seq.store(seq + 2, std::memory_order_release);
+    }
+    return state;
+}
+
+const SimVehicleState &simVehicleState() {
+    return sim_vehicle.state();
+}
+
+static SimVehicleState readSharedPose(const SharedPose *pose) {
+    SimVehicleState state;
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        const uint32_t before = pose->seq.load(std::memory_order_acquire);
+        state.x_m = pose->x_m.load(std::memory_order_relaxed);
+        state.y_m = pose->y_m.load(std::memory_order_relaxed);
+        state.heading_rad = pose->heading_rad.load(std::memory_order_relaxed);
+        state.speed_m_s = pose->speed_m_s.load(std::memory_order_relaxed);
+        state.steer_rad = pose->steer_rad.load(std::memory_order_relaxed);
+        state.accel_long_m_s2 = pose->accel_long_m_s2.load(std::memory_order_relaxed);
+        state.accel_lat_m_s2 = pose->accel_lat_m_s2.load(std::memory_order_relaxed);
+        state.wheel_speed_m_s = pose->wheel_speed_m_s.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((before & 1) == 0 && pose->seq.load(std::memory_order_relaxed) == before) {
+            break;
+        }
+    }
+    return state;
+}
+
+bool readSimVehicle(SimVehicleState &state) {
+    static const SharedPose *pose = nullptr; // Solo il thread dei sensori
+    if (!pose) {
+        pose = mapSharedPose(false); // Compare al primo passo del modello
+    }
+    if (!pose) {
+        return false;
+    }
+    state = readSharedPose(pose);
+    return true;
+}
+
+// Vista inseguitore dall'alto: l'auto resta ferma in basso al centro con il muso in su e il
+// terreno (griglia di 1 m, riquadri di 5 m) le scorre sotto. Barre di sterzo e velocità in basso.
+static void renderTopDown(const SimVehicleState &state, int width, int height, std::vector<uint8_t> &image) {
+    const double pixels_per_m = height / 8.0;
+    const double car_u = width / 2.0;
+    const double car_v = height * 0.65;
+    const double sin_h = std::sin(state.heading_rad);
+    const double cos_h = std::cos(state.heading_rad);
+    for (int v = 0; v < height; ++v) {
+        const double forward = (car_v - v) / pixels_per_m;
+        for (int u = 0; u < width; ++u) {
+            const double right = (u - car_u) / pixels_per_m;
+            uint8_t shade;
+            if (std::fabs(right) < 0.1 && forward > -CAR_REAR_M && forward < CAR_FRONT_M) {
+                shade = forward > VehicleModel::WHEELBASE_M ? 240 : 20; // Muso chiaro, carrozzeria scura
+            } else {
+                const double east = state.x_m + right * cos_h + forward * sin_h;
+                const double north = state.y_m - right * sin_h + forward * cos_h;
+                const bool line = east - std::floor(east) < 0.03 || north - std::floor(north) < 0.03;
+                const bool tile = (static_cast<long>(std::floor(east / 5.0)) + static_cast<long>(std::floor(north / 5.0))) & 1;
+                shade = line ? 200 : (tile ? 96 : 120);
+            }
+            image[static_cast<size_t>(v) * width + u] = shade;
+        }
+    }
+
+    // Sterzo: tacca sulla barra in basso; velocità: barra orizzontale sopra, metà larghezza = fondo scala
+    const int bar = std::max(height / 60, 2);
+    const int notch = static_cast<int>(car_u + state.steer_rad / VehicleModel::MAX_STEER_RAD * (width / 2.0 - bar));
+    const int speed_px = static_cast<int>(std::fabs(state.speed_m_s) / VehicleModel::MAX_SPEED_M_S * (width / 2.0));
+    for (int v = height - 3 * bar; v < height; ++v) {
+        for (int u = 0; u < width; ++u) {
+            const bool steer_row = v >= height - bar;
+            const bool lit = steer_row ? std::abs(u - notch) < bar : (v < height - 2 * bar && u < speed_px);
+            image[static_cast<size_t>(v) * width + u] = lit ? 255 : 0;
+        }
+    }
+}
+
+int runSimView(int width, int height, int framerate, int bitrate) {
+    if (width <= 0 || height <= 0 || framerate <= 0 || bitrate <= 0) {
+        std::cerr << "Parametri della vista simulata non validi" << std::endl;
+        return EXIT_FAILURE;
+    }
+    const SharedPose *pose = mapSharedPose(false);
+    if (!pose) {
+        perror("Posa del veicolo simulato non disponibile");
+        return EXIT_FAILURE;
+    }
+
+    // ffmpeg codifica le immagini grezze e scrive l'H.264 sul nostro stdout, cioè al relay.
+    // Muore con questo processo: il supervisore del video conosce solo il nostro PID.
+    int frames[2];
+    if (pipe(frames) < 0) {
+        perror("pipe");
+        return EXIT_FAILURE;
+    }
+    const pid_t encoder = fork();
+    if (encoder == 0) {
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        dup2(frames[0], STDIN_FILENO);
+        close(frames[0]);
+        close(frames[1]);
+        const std::string size = std::to_string(width) + "x" + std::to_string(height);
+        const std::string fps = std::to_string(framerate);
+        const std::string rate = std::to_string(bitrate);
+        execlp("ffmpeg", "ffmpeg", "-loglevel", "quiet", "-f", "rawvideo", "-pix_fmt", "gray", "-s", size.c_str(),
+               "-r", fps.c_str(), "-i", "pipe:0", "-c:v", "libx264", "-preset", "ultrafast", "-tune", "zerolatency",
+               "-g", fps.c_str(), "-b:v", rate.c_str(), "-f", "h264", "-", (char *)NULL);
+        _exit(EXIT_FAILURE);
+    }
+    close(frames[0]);
+    if (encoder < 0) {
+        perror("fork");
+        return EXIT_FAILURE;
+    }
+
+    std::vector<uint8_t> image(static_cast<size_t>(width) * height);
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    const long period_ns = 1000000000L / framerate;
+    while (true) {
+        renderTopDown(readSharedPose(pose), width, height, image);
+        const uint8_t *data = image.data();
+        size_t left = image.size();
+        while (left > 0) {
+            const ssize_t n = write(frames[1], data, left);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return EXIT_SUCCESS; // ffmpeg è uscito o il relay ha chiuso la pipe
+            }
+            data += n;
+            left -= n;
+        }
+
+        next.tv_nsec += period_ns;
+        if (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr) == EINTR) {
+        }
+    }
+}
@@ -0,0 +1,88 @@
+#include "../include/rrc_rasp.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
+#include <vector>
+
+// Intestazioni Annex-B con la stessa struttura dei frame di rpicam-vid
+static const uint8_t SYNTH_SPS[] = {0, 0, 0, 1, 0x67, 0x42, 0xc0, 0x1f, 0x8c, 0x8d, 0x40};
+static const uint8_t SYNTH_PPS[] = {0, 0, 0, 1, 0x68, 0xce, 0x3c, 0x80};
+static const uint8_t SYNTH_IDR[] = {0, 0, 0, 1, 0x65, 0x88};
+static const uint8_t SYNTH_SLICE[] = {0, 0, 0, 1, 0x41, 0x9a};
+
+static bool writeAll(const uint8_t *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(STDOUT_FILENO, data, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+// Sorgente video sintetica per i test senza telecamera: scrive su stdout un keyframe al secondo
+// e slice P in mezzo, al bitrate e framerate richiesti. Il payload non contiene byte nulli (niente
+// start code spuri) e non è decodificabile: serve a misurare trasporto, FEC e buffer.
+int runSyntheticVideo(int bitrate, int framerate) {
+    if (bitrate <= 0 || framerate <= 0) {
+        std::cerr << "Parametri del video sintetico non validi" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const size_t average = static_cast<size_t>(bitrate) / 8 / framerate;
+    const size_t key_size = average * 4;
+    const size_t slice_size = framerate > 1 ? (average * framerate - key_size) / (framerate - 1) : average;
+    std::vector<uint8_t> frame(key_size * 2 + 64);
+    uint32_t noise = 0x12345678;
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    const long period_ns = 1000000000L / framerate;
+
+    for (uint64_t index = 0;; ++index) {
+        const bool keyframe = index % framerate == 0;
+        size_t len = 0;
+        auto append = [&](const uint8_t *bytes, size_t size) {
+            std::copy(bytes, bytes + size, frame.begin() + len);
+            len += size;
+        };
+
+        if (keyframe) {
+            append(SYNTH_SPS, sizeof(SYNTH_SPS));
+            append(SYNTH_PPS, sizeof(SYNTH_PPS));
+            append(SYNTH_IDR, sizeof(SYNTH_IDR));
+        } else {
+            append(SYNTH_SLICE, sizeof(SYNTH_SLICE));
+        }
+
+        // Dimensione variabile del ±20% come un encoder reale su una scena in movimento
+        noise ^= noise << 13;
+        noise ^= noise >> 17;
+        noise ^= noise << 5;
+        const size_t base = keyframe ? key_size : slice_size;
+        const size_t payload = std::max<size_t>(base * (80 + noise % 41) / 100, 16);
+        for (size_t i = 0; i < payload && len < frame.size(); ++i) {
+            noise ^= noise << 13;
+            noise ^= noise >> 17;
+            noise ^= noise << 5;
+            frame[len++] = static_cast<uint8_t>(noise) | 0x01;
+        }
+
+        if (!writeAll(frame.data(), len)) {
+            return EXIT_SUCCESS; // Il relay ha chiuso la pipe
+        }
+
+        next.tv_nsec += period_ns;
+        if (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr) == EINTR) {
+        }
+    }
+}
@@ -0,0 +1,138 @@
+#include "../include/rrc_rasp.hpp"
+#include <algorithm>
+#include <cmath>
+#ifdef RRC_SIMULATION
+# include "../include/rrc_simvehicle.hpp"
+#endif
+
+constexpr double MAX_SPEED_CM_S = 1000.0;   // Velocità a fondo scala stimata (~36 km/h)
+constexpr double ACCEL_TAU_S = 0.6;         // Costante di tempo in accelerazione
+constexpr double BRAKE_TAU_S = 0.25;        // In frenata la velocità cala più in fretta
+constexpr double REVERSE_SCALE = 0.4;       // L'ESC limita la retromarcia
+constexpr double MG_PER_M_S2 = 1000.0 / 9.81;
+constexpr uint64_t SENSOR_MAX_AGE_US = 100000; // Campioni più vecchi: sensore fermo o staccato
+
+// Ultimi impulsi scritti sui PWM, letti a ogni invio di telemetria
+static std::atomic<int> applied_steering_us{1500};
+static std::atomic<int> applied_throttle_us{1500};
+
+// Ultimo stato di moto, per il controllo di trazione sullo stesso thread
+static VehicleMotion vehicle_motion;
+static bool telemetry_low_power = false; // Solo thread dei comandi
+
+static std::mutex telemetry_mutex;
+static struct sockaddr_in telemetry_addr{};
+static bool telemetry_has_client = false;
+
+void publishActuators(int steering_us, int throttle_us) {
+    applied_steering_us.store(steering_us, std::memory_order_relaxed);
+    applied_throttle_us.store(throttle_us, std::memory_order_relaxed);
+}
+
+void publishLowPower(bool low_power) {
+    telemetry_low_power = low_power;
+}
+
+const VehicleMotion &vehicleMotion() {
+    return vehicle_motion;
+}
+
+void setTelemetryClient(const struct sockaddr_in &client_addr) {
+    std::lock_guard<std::mutex> lock(telemetry_mutex);
+    telemetry_addr = client_addr;
+    telemetry_has_client = true;
+}
+
+void clearTelemetryClient() {
+    std::lock_guard<std::mutex> lock(telemetry_mutex);
+    telemetry_has_client = false;
+}
+
+#ifndef RRC_SIMULATION
+// Senza sensori la velocità viene stimata dal comando motore con un modello del primo ordine:
+// basta al force feedback per far crescere il centraggio con la velocità. Neutro, dead zone e
+// corse vengono dalla configurazione in uso, come per l'ESC vero.
+static double estimateSpeed(double speed, int throttle_us, const RuntimeConfig &config, double dt) {
+    double target = 0.0;
+    double tau = ACCEL_TAU_S;
+    const int offset_us = throttle_us - config.pwm_neutral_us;
+    if (offset_us > config.dead_zone_us) {
+        target = static_cast<double>(offset_us) / (config.pwm_max_us - config.pwm_neutral_us) * MAX_SPEED_CM_S;
+        if (speed < 0) {
+            tau = BRAKE_TAU_S;
+        }
+    } else if (offset_us < -config.dead_zone_us) {
+        if (speed > 1.0) {
+            tau = BRAKE_TAU_S; // Primo impulso sotto il neutro: l'ESC frena
+        } else {
+            target = static_cast<double>(offset_us) / (config.pwm_neutral_us - config.pwm_min_us) * MAX_SPEED_CM_S *
+                     REVERSE_SCALE;
+        }
+    }
+    return speed + (target - speed) * std::min(dt / tau, 1.0);
+}
+#endif
+
+static int16_t toMilliG(double accel_m_s2) {
+    return static_cast<int16_t>(std::clamp(std::lround(accel_m_s2 * MG_PER_M_S2), -32767L, 32767L));
+}
+
+// Chiamata dal timer del ciclo dei comandi ogni TELEMETRY_PERIOD_US: svuota l'anello dei sensori,
+// aggiorna la velocità e lo stato di moto anche senza client e, se c'è, gli invia lo stato dell'auto.
+// Accelerazioni e urti arrivano dall'IMU (vero o simulato), la velocità delle ruote dal sensore
+// del veicolo simulato. Nella build di simulazione il periodo è anche il frame PWM del modello
+// del veicolo, che sostituisce la stima della velocità.
+void sendTelemetry(int server_fd) {
+    static Telemetry telemetry;
+    static double speed = 0.0;
+    static double peak_m_s2 = 0.0; // Picco dall'ultimo invio, come impact_mg
+    const double dt = TELEMETRY_PERIOD_US / 1e6;
+
+    const int throttle = applied_throttle_us.load(std::memory_order_relaxed);
+#ifdef RRC_SIMULATION
+    speed = stepSimVehicle(dt).speed_m_s * 100.0;
+    vehicle_motion.speed_estimated = false;
+#else
+    speed = estimateSpeed(speed, throttle, activeConfig(), dt);
+#endif
+    const uint64_t now_us = monotonicMicros();
+    const SensorSnapshot &sensors = pollSensors();
+    const bool imu = sensorFresh(sensors.imu_stamp_us, now_us, SENSOR_MAX_AGE_US);
+    peak_m_s2 = std::max(peak_m_s2, sensors.peak_accel_m_s2);
+    vehicle_motion.stamp_us = now_us;
+    vehicle_motion.speed_m_s = speed / 100.0;
+    vehicle_motion.has_accel = imu;
+    vehicle_motion.accel_long_m_s2 = sensors.accel_long_m_s2;
+    vehicle_motion.has_wheel_speed = sensorFresh(sensors.wheel_stamp_us, now_us, SENSOR_MAX_AGE_US);
+    vehicle_motion.wheel_speed_m_s = sensors.wheel_speed_m_s;
+
+    struct sockaddr_in dest;
+    {
+        std::lock_guard<std::mutex> lock(telemetry_mutex);
+        if (!telemetry_has_client) {
+            return;
+        }
+        dest = telemetry_addr;
+    }
+
+    telemetry.seq++;
+    telemetry.steering_us = static_cast<uint16_t>(applied_steering_us.load(std::memory_order_relaxed));
+    telemetry.throttle_us = static_cast<uint16_t>(throttle);
+    telemetry.speed_cm_s = static_cast<int16_t>(std::lround(speed));
+    telemetry.flags = currentMode == REVERSE ? TELEMETRY_FLAG_REVERSE : 0;
+    if (telemetry_low_power) {
+        telemetry.flags |= TELEMETRY_FLAG_LOW_POWER;
+    }
+    if (imu) {
+        telemetry.accel_x_mg = toMilliG(sensors.accel_long_m_s2);
+        telemetry.accel_y_mg = toMilliG(sensors.accel_lat_m_s2);
+        telemetry.impact_mg = static_cast<uint16_t>(std::min(peak_m_s2 * MG_PER_M_S2, 65535.0));
+        telemetry.flags |= TELEMETRY_FLAG_IMU;
+    }
+    peak_m_s2 = 0.0;
+
+    uint8_t message[TELEMETRY_SIZE + AUTH_TRAILER_SIZE];
+    writeTelemetry(message, telemetry);
+    const size_t len = control_auth.seal(message, TELEMETRY_SIZE);
+    sendto(server_fd, message, len, MSG_DONTWAIT, reinterpret_cast<struct sockaddr *>(&dest), sizeof(dest));
+}
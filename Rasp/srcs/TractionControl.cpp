@@ -0,0 +1,113 @@
+#include "../include/rrc_traction.hpp"
+#include <algorithm>
+#include <cmath>
+
+constexpr double MAX_STEP_S = 0.1;          // Oltre, il comando precedente è troppo vecchio per la rampa
+constexpr double RECOVER_RAMP_S = 0.2;      // Risalita dopo un taglio se la rampa di partenza è spenta
+constexpr double CUT_FLOOR = 0.5;           // Un taglio toglie al più metà del gas per campione
+constexpr double SLIP_FLOOR_M_S = 0.3;      // Pattinamento minimo riconosciuto, anche da fermo
+
+static double elapsedS(uint64_t now_us, uint64_t before_us) {
+    if (before_us == 0 || now_us <= before_us) {
+        return 0.0;
+    }
+    return std::min((now_us - before_us) / 1e6, MAX_STEP_S);
+}
+
+void TractionControl::reset(int steering_us) {
+    throttle_us_ = 0.0;
+    throttle_at_us_ = 0;
+    throttle_limited_ = false;
+    recovering_ = false;
+    launching_ = false;
+    steering_us_ = steering_us;
+    steering_at_us_ = 0;
+    steering_limited_ = false;
+}
+
+int TractionControl::shapeThrottle(int pulse_us, bool driving, uint64_t now_us, const VehicleMotion &motion,
+                                   const RuntimeConfig &config) {
+    const int neutral = config.pwm_neutral_us;
+    if (!driving) {
+        throttle_us_ = 0.0;
+        throttle_at_us_ = now_us;
+        throttle_limited_ = false;
+        recovering_ = false;
+        launching_ = false;
+        return pulse_us;
+    }
+
+    const bool forward = pulse_us >= neutral;
+    if (forward != forward_) {
+        throttle_us_ = 0.0; // Cambio di verso: la nuova marcia riparte da zero
+        forward_ = forward;
+    }
+    const double span = std::max(forward ? config.pwm_max_us - neutral : neutral - config.pwm_min_us, 1);
+    const double requested = std::abs(pulse_us - neutral);
+    const double dt = elapsedS(now_us, throttle_at_us_);
+    throttle_at_us_ = now_us;
+
+    // Da fermo il gas sale con la rampa di partenza
+    const bool stopped = std::fabs(motion.speed_m_s) * 100.0 < config.launch_speed_cm_s;
+    if (stopped && throttle_us_ <= config.dead_zone_us && config.launch_ramp_ms > 0 && !launching_) {
+        launching_ = true;
+        launches_++;
+    } else if (!stopped) {
+        launching_ = false;
+    }
+
+    double next = requested;
+    if (requested > throttle_us_ && (launching_ || recovering_)) {
+        const double ramp_s = config.launch_ramp_ms > 0 ? config.launch_ramp_ms / 1000.0 : RECOVER_RAMP_S;
+        next = std::min(requested, throttle_us_ + span / ramp_s * dt);
+    }
+
+    // Tagli in anello chiuso, una volta per campione: accelerazione oltre il limite o ruote che pattinano
+    if (motion.stamp_us != 0 && motion.stamp_us != motion_seen_us_) {
+        motion_seen_us_ = motion.stamp_us;
+        double keep = 1.0;
+        const double limit_m_s2 = config.accel_limit_cm_s2 / 100.0;
+        const double accel = std::fabs(motion.accel_long_m_s2);
+        if (motion.has_accel && limit_m_s2 > 0.0 && accel > limit_m_s2) {
+            keep = std::min(keep, limit_m_s2 / accel);
+        }
+        if (motion.has_wheel_speed && config.slip_limit_pct > 0) {
+            const double slip = std::fabs(motion.wheel_speed_m_s) - std::fabs(motion.speed_m_s);
+            const double allowed = std::max(std::fabs(motion.speed_m_s) * config.slip_limit_pct / 100.0, SLIP_FLOOR_M_S);
+            if (slip > allowed) {
+                keep = std::min(keep, allowed / slip);
+            }
+        }
+        if (keep < 1.0) {
+            next = std::min(next, throttle_us_ * std::max(keep, CUT_FLOOR));
+            recovering_ = true;
+            cuts_++;
+        }
+    }
+
+    throttle_us_ = next;
+    throttle_limited_ = next < requested;
+    if (!throttle_limited_) {
+        recovering_ = false;
+    }
+    const int offset = static_cast<int>(std::lround(next));
+    return forward ? neutral + offset : neutral - offset;
+}
+
+int TractionControl::shapeSteering(int pulse_us, uint64_t now_us, const VehicleMotion &motion,
+                                   const RuntimeConfig &config) {
+    const double dt = elapsedS(now_us, steering_at_us_);
+    steering_at_us_ = now_us;
+    if (config.steer_rate_us_s <= 0 || steering_us_ < 0.0) { // Spento, o posizione del servo ignota
+        steering_us_ = pulse_us;
+        steering_limited_ = false;
+        return pulse_us;
+    }
+    // Da fermo la velocità piena, a steer_rate_speed_cm_s la metà, poi sempre meno
+    const double speed_cm_s = std::fabs(motion.speed_m_s) * 100.0;
+    const double rate = config.steer_rate_us_s / (1.0 + speed_cm_s / config.steer_rate_speed_cm_s);
+    const double step = rate * dt;
+    steering_us_ += std::clamp(pulse_us - steering_us_, -step, step);
+    steering_limited_ = std::fabs(pulse_us - steering_us_) >= 0.5;
+    return static_cast<int>(std::lround(steering_us_));
+}
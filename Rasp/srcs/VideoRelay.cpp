@@ -0,0 +1,123 @@
+#include "../include/rrc_rasp.hpp"
+#include "../include/rrc_h264.hpp"
+#include "../include/rrc_reactor.hpp"
+#include "rrc_stream.hpp"
+#include <cerrno>
+#include <sys/ioctl.h>
+#include <vector>
+
+// Persistente tra un avvio e l'altro di rpicam-vid: frame_id e seq proseguono e il client
+// vede un flusso continuo anche quando cambia il livello dell'encoder
+static VideoPacketizer packetizer;
+
+// Parametri FEC correnti (cols << 8 | rows), modificabili mentre lo streaming è attivo
+static std::atomic<uint16_t> fec_setting{0};
+
+void setVideoFec(const FecParams &params) {
+    fec_setting.store(static_cast<uint16_t>((params.cols << 8) | params.rows));
+}
+
+FecParams videoFec() {
+    const uint16_t packed = fec_setting.load();
+    FecParams params;
+    params.cols = static_cast<uint8_t>(packed >> 8);
+    params.rows = static_cast<uint8_t>(packed & 0xff);
+    return params;
+}
+
+// Invia tutti i datagrammi del frame con una sola syscall
+static void sendDatagrams(int sock, const VideoPacketizer &packetizer, struct sockaddr_in &dest,
+                          std::vector<struct mmsghdr> &msgs, std::vector<struct iovec> &iovs) {
+    const size_t count = packetizer.count();
+    msgs.resize(count);
+    iovs.resize(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        iovs[i].iov_base = const_cast<uint8_t *>(packetizer.datagram(i));
+        iovs[i].iov_len = packetizer.datagramSize(i);
+        msgs[i] = {};
+        msgs[i].msg_hdr.msg_name = &dest;
+        msgs[i].msg_hdr.msg_namelen = sizeof(dest);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    size_t sent = 0;
+    while (sent < count) {
+        int n = sendmmsg(sock, msgs.data() + sent, count - sent, 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("sendmmsg video");
+            return;
+        }
+        sent += n;
+    }
+}
+
+// Legge l'H.264 di rpicam-vid dalla pipe, lo divide in frame e lo invia al client con FEC.
+// Se la registrazione è attiva, gli stessi frame vengono accodati per la scrittura su SD.
+// Termina quando la pipe viene chiusa (processo di streaming terminato).
+void videoRelayLoop(int pipe_fd, struct sockaddr_in client_addr, VideoTier tier) {
+    leaveRealtimeCpu();
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        perror("Video socket creation failed");
+        close(pipe_fd);
+        return;
+    }
+
+    struct sockaddr_in dest = client_addr; // Porta video già impostata dal supervisore
+
+    H264Framer framer;
+    std::vector<uint8_t> chunk(64 * 1024); // Capacità di default di una pipe Linux
+    std::vector<struct mmsghdr> msgs;
+    std::vector<struct iovec> iovs;
+    uint64_t frames = 0;
+
+    uint64_t unit_start_us = 0; // Lettura in cui sono arrivati i primi byte del frame in attesa
+
+    while (true) {
+        ssize_t n = read(pipe_fd, chunk.data(), chunk.size());
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        noteVideoOutput(); // Il supervisore vede che l'encoder è vivo
+
+        // Il frame esce dall'encoder quando i suoi primi byte arrivano sulla pipe
+        const uint64_t read_us = monotonicMicros();
+        if (framer.pendingBytes() == 0) {
+            unit_start_us = read_us;
+        }
+        framer.feed(chunk.data(), n);
+
+        // Pipe svuotata con una lettura parziale: il frame in coda è completo
+        int pending = 0;
+        if (static_cast<size_t>(n) < chunk.size() && ioctl(pipe_fd, FIONREAD, &pending) == 0 && pending == 0) {
+            framer.flush();
+        }
+
+        const FecParams fec = videoFec();
+        for (size_t i = 0; i < framer.readyCount(); ++i) {
+            const H264AccessUnit unit = framer.ready(i);
+            const uint64_t capture_us = i == 0 ? unit_start_us : read_us;
+            packetizer.packetize(unit.data, unit.size, unit.keyframe, fec,
+                                 static_cast<uint32_t>(monotonicMicros()), capture_us);
+            sendDatagrams(sock, packetizer, dest, msgs, iovs);
+            recordVideoFrame(unit.data, unit.size, unit.keyframe, capture_us, tier.width, tier.height);
+            frames++;
+        }
+        framer.consume();
+        if (framer.pendingBytes() > 0) {
+            unit_start_us = read_us;
+        }
+    }
+
+    std::cout << "Relay video terminato dopo " << frames << " frame." << std::endl;
+    close(pipe_fd);
+    close(sock);
+}
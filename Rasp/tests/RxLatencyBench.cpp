@@ -0,0 +1,142 @@
+#include "../include/rrc_rasp.hpp"
+#include "../include/rrc_reactor.hpp"
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <time.h>
+
+// Latenza di ricezione dei comandi su loopback contro CPU consumata, per le modalità del socket
+// dei comandi: reactor normale, socket a bassa latenza e attesa attiva di varia durata.
+// La latenza va dall'invio al momento in cui l'handler del reactor ha in mano il datagramma.
+// Uso: rx_bench [--rt-cpu=N] [--packets=N] [--period-us=N]
+namespace {
+struct RxMode {
+    const char *name;
+    bool low_latency;
+    uint64_t spin_us;
+};
+
+const RxMode RX_MODES[] = {
+    {"epoll bloccante", false, 0},
+    {"socket a bassa latenza", true, 0},
+    {"bassa latenza + spin 50 us", true, 50},
+    {"bassa latenza + spin 200 us", true, 200},
+    {"bassa latenza + spin 1000 us", true, 1000},
+};
+
+struct Receiver {
+    Reactor reactor;
+    int fd = -1;
+    LatencyHistogram latency_ns;
+};
+
+void onDatagram(void *ctx, int fd, uint32_t) {
+    Receiver &receiver = *static_cast<Receiver *>(ctx);
+    uint64_t sent_ns;
+    while (recv(fd, &sent_ns, sizeof(sent_ns), MSG_DONTWAIT) == sizeof(sent_ns)) {
+        if (sent_ns == 0) {
+            receiver.reactor.stop(); // Fine della prova
+            return;
+        }
+        receiver.latency_ns.record(static_cast<int64_t>(monotonicNanos() - sent_ns));
+    }
+}
+
+double threadCpuSeconds() {
+    struct rusage usage{};
+    getrusage(RUSAGE_THREAD, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+void sleepUntil(uint64_t deadline_ns) {
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(deadline_ns / 1000000000ULL);
+    ts.tv_nsec = static_cast<long>(deadline_ns % 1000000000ULL);
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr);
+}
+
+// steady_clock e CLOCK_MONOTONIC coincidono su Linux: le scadenze usano lo stesso orologio dei timestamp
+void runMode(const RxMode &mode, int rt_cpu, int packets, uint64_t period_us) {
+    Receiver receiver;
+    receiver.fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if (receiver.fd < 0 || bind(receiver.fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0 ||
+        getsockname(receiver.fd, reinterpret_cast<struct sockaddr *>(&addr), &addr_len) < 0) {
+        perror("Socket di prova non disponibile");
+        exit(EXIT_FAILURE);
+    }
+    if (mode.low_latency) {
+        tuneLowLatencySocket(receiver.fd, 50, 8192);
+    }
+    receiver.reactor.setSpin(mode.spin_us);
+    receiver.reactor.add(receiver.fd, EPOLLIN, onDatagram, &receiver);
+
+    double cpu_s = 0.0;
+    double wall_s = 0.0;
+    std::thread thread([&] {
+        enterRealtime(rt_cpu, 50);
+        const uint64_t start_ns = monotonicNanos();
+        const double start_cpu = threadCpuSeconds();
+        receiver.reactor.run();
+        cpu_s = threadCpuSeconds() - start_cpu;
+        wall_s = (monotonicNanos() - start_ns) / 1e9;
+    });
+
+    int sender = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    connect(sender, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
+    leaveRealtimeCpu();
+    usleep(100000); // Il ricevitore è in attesa prima del primo invio
+    uint64_t deadline_ns = monotonicNanos();
+    for (int i = 0; i < packets; ++i) {
+        deadline_ns += period_us * 1000;
+        sleepUntil(deadline_ns);
+        const uint64_t now_ns = monotonicNanos();
+        send(sender, &now_ns, sizeof(now_ns), 0);
+    }
+    const uint64_t stop = 0;
+    send(sender, &stop, sizeof(stop), 0);
+    thread.join();
+    close(sender);
+    close(receiver.fd);
+
+    const LatencyHistogram &latency = receiver.latency_ns;
+    const ReactorStats &stats = receiver.reactor.stats();
+    printf("%-30s %8lld %8lld %8lld %8lld %7.1f%% %8llu\n", mode.name,
+           static_cast<long long>(latency.percentile(50)), static_cast<long long>(latency.percentile(99)),
+           static_cast<long long>(latency.percentile(99.9)), static_cast<long long>(latency.max()),
+           wall_s > 0 ? cpu_s / wall_s * 100.0 : 0.0, static_cast<unsigned long long>(stats.spin_hits));
+}
+}
+
+int main(int argc, char **argv) {
+    int rt_cpu = -1;
+    int packets = 5000;
+    uint64_t period_us = 1000;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--rt-cpu=", 0) == 0) {
+            rt_cpu = std::atoi(arg.c_str() + 9);
+        } else if (arg.rfind("--packets=", 0) == 0 && std::atoi(arg.c_str() + 10) > 0) {
+            packets = std::atoi(arg.c_str() + 10);
+        } else if (arg.rfind("--period-us=", 0) == 0 && std::atoi(arg.c_str() + 12) > 0) {
+            period_us = static_cast<uint64_t>(std::atoi(arg.c_str() + 12));
+        } else {
+            std::cerr << "Uso: " << argv[0] << " [--rt-cpu=N] [--packets=N] [--period-us=N]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("%d datagrammi ogni %llu us su loopback, latenze in ns\n", packets,
+           static_cast<unsigned long long>(period_us));
+    if (sysconf(_SC_NPROCESSORS_ONLN) < 2 || rt_cpu < 0) {
+        printf("Attenzione: senza una CPU dedicata al ricevitore (--rt-cpu) l'attesa attiva toglie CPU al mittente\n");
+    }
+    printf("%-30s %8s %8s %8s %8s %8s %8s\n", "modalità", "p50", "p99", "p99.9", "max", "CPU", "spin");
+    for (const RxMode &mode : RX_MODES) {
+        runMode(mode, rt_cpu, packets, period_us);
+    }
+    return EXIT_SUCCESS;
+}
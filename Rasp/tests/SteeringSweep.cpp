@@ -17,14 +17,14 @@ void configurePWM() {
         std::exit(EXIT_FAILURE);
     }
 
-    pinMode(SERVO_PIN, PWM_OUTPUT);
+    pinMode(RuntimeConfig().servo_pin, PWM_OUTPUT);
     pwmSetMode(PWM_MODE_MS);
     pwmSetRange(20000); // ~50Hz, 1µs resolution (clock=19)
     pwmSetClock(19);
 }
 
 void writeServo(int value) {
-    pwmWrite(SERVO_PIN, value);
+    pwmWrite(RuntimeConfig().servo_pin, value);
     delay(20);
 }
 }
@@ -0,0 +1,263 @@
+#include "../include/rrc_simvehicle.hpp"
+#include "../include/rrc_esc.hpp"
+#include "../include/rrc_traction.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+// Manovre di riferimento sul modello del veicolo simulato, un passo per frame PWM (20 ms):
+// accelerazione, frenata, retromarcia con e senza doppio tocco dell'ESC, raggio di curva.
+// Serve a tarare il modello e a vedere cosa fa l'auto con una sequenza di impulsi.
+// Infine confronta il vecchio impulso diretto dai pedali con EscSequencer quando il pilota
+// chiede la retromarcia con comandi a cadenza irregolare, prova freno, rilascio e freno in
+// corsa con il sequencer e la partenza a gas pieno con e senza controllo di trazione.
+namespace {
+constexpr double FRAME_S = 0.02;
+
+struct Pulses {
+    int steering;
+    int throttle;
+};
+
+// Ripete gli stessi impulsi per frames frame
+void hold(VehicleModel &model, const RuntimeConfig &config, Pulses pulses, int frames) {
+    for (int i = 0; i < frames; ++i) {
+        model.step(pulses.steering, pulses.throttle, config, FRAME_S);
+    }
+}
+
+// Frame necessari perché la velocità arrivi a target, salendo o scendendo; -1 se non ci arriva
+int framesUntil(VehicleModel &model, const RuntimeConfig &config, Pulses pulses, double target, int limit) {
+    const bool rising = target > model.state().speed_m_s;
+    for (int i = 1; i <= limit; ++i) {
+        model.step(pulses.steering, pulses.throttle, config, FRAME_S);
+        const double speed = model.state().speed_m_s;
+        if (rising ? speed >= target : speed <= target) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Pilota che chiede la retromarcia in corsa: in REVERSE preme l'acceleratore, lo rilascia per
+// gap_us e lo ripreme. I comandi arrivano ogni 10-30 ms, l'ESC campiona l'impulso una volta per
+// frame con fase casuale. Ritorna i µs dal primo comando premuto alla retromarcia, -1 se entro 2 s no.
+long reverseEngagement(const RuntimeConfig &config, bool sequenced, std::mt19937 &rng, uint64_t gap_us) {
+    std::uniform_int_distribution<uint64_t> command_period(10000, 30000);
+    std::uniform_int_distribution<uint64_t> frame_phase(0, 19999);
+    const int neutral = config.pwm_neutral_us;
+    const int reverse_pwm = config.pwm_min_us;
+    const uint64_t frame_us = static_cast<uint64_t>(FRAME_S * 1e6);
+    const uint64_t start_us = 1000000; // Il tempo 0 vale come "nessuna scadenza" per il sequencer
+    const uint64_t press_us = start_us + 300000;
+
+    VehicleModel model;
+    EscSequencer esc;
+    hold(model, config, {neutral, neutral + 200}, 50); // In marcia avanti
+    int output = neutral;
+    uint64_t first_press = 0;
+    uint64_t next_command = start_us + command_period(rng);
+    uint64_t next_frame = start_us + frame_phase(rng);
+    for (uint64_t now = start_us; now < press_us + 2000000; now += 100) {
+        if (now >= next_command) {
+            next_command += command_period(rng);
+            const bool pressed = now >= press_us && (now < press_us + 300000 || now >= press_us + 300000 + gap_us);
+            if (pressed && first_press == 0) {
+                first_press = now;
+            }
+            if (sequenced) {
+                output = esc.request(pressed ? EscSequencer::WANT_REVERSE : EscSequencer::WANT_NEUTRAL,
+                                     pressed ? reverse_pwm : neutral, now, config);
+            } else {
+                output = pressed ? reverse_pwm : neutral;
+            }
+        }
+        const uint64_t deadline = esc.deadlineUs(config);
+        if (sequenced && deadline != 0 && now >= deadline) {
+            output = esc.tick(now, config); // Il timer dell'uscita, con la risoluzione del ciclo
+        }
+        if (now >= next_frame) {
+            next_frame += frame_us;
+            model.step(neutral, output, config, FRAME_S);
+            if (model.state().esc == SimEsc::REVERSE) {
+                return static_cast<long>(now - first_press);
+            }
+        }
+    }
+    return -1;
+}
+
+// In corsa il pilota frena, rilascia per release_ms e frena di nuovo, un comando per frame.
+// Entro la finestra dell'ESC il secondo freno resta folle (l'ESC andrebbe indietro), dopo frena davvero.
+void brakeReleaseBrake(const RuntimeConfig &config, int release_ms) {
+    const int neutral = config.pwm_neutral_us;
+    VehicleModel model;
+    EscSequencer esc;
+    uint64_t now = 1000000;
+    int frame = 0;
+    int output = neutral;
+    bool reversed = false;
+    auto drive = [&](EscSequencer::Intent intent, int pulse_us, int ms) {
+        for (const int end = frame + ms / 20; frame < end; ++frame, now += 20000) {
+            output = esc.request(intent, pulse_us, now, config);
+            model.step(neutral, output, config, FRAME_S);
+            reversed = reversed || model.state().esc == SimEsc::REVERSE;
+        }
+    };
+    drive(EscSequencer::WANT_FORWARD, neutral + 300, 2000);
+    drive(EscSequencer::WANT_BRAKE, config.pwm_min_us, 200);
+    drive(EscSequencer::WANT_NEUTRAL, neutral, release_ms);
+    const double before = model.state().speed_m_s;
+    drive(EscSequencer::WANT_BRAKE, config.pwm_min_us, 500);
+    printf("  rilascio %4d ms: secondo freno %s, %.2f -> %.2f m/s, ESC %s%s\n", release_ms,
+           output < neutral ? "applicato" : "in folle", before, model.state().speed_m_s,
+           simEscStateName(model.state().esc), reversed ? ", RETROMARCIA" : "");
+}
+
+// Gas pieno da fermo per 2 s, un comando per frame; il modello fa da IMU e sensore delle ruote
+void launchReport(RuntimeConfig config, bool traction_on) {
+    config.traction_control = traction_on ? 1 : 0;
+    VehicleModel model;
+    TractionControl traction;
+    const int neutral = config.pwm_neutral_us;
+    double peak_slip = 0.0;
+    double slip_time = 0.0;
+    int to_5 = -1;
+    uint64_t now = 1000000;
+    for (int frame = 1; frame <= 100; ++frame, now += 20000) {
+        VehicleMotion motion;
+        motion.stamp_us = now;
+        motion.speed_m_s = model.state().speed_m_s;
+        motion.speed_estimated = false;
+        motion.has_accel = true;
+        motion.accel_long_m_s2 = model.state().accel_long_m_s2;
+        motion.has_wheel_speed = true;
+        motion.wheel_speed_m_s = model.state().wheel_speed_m_s;
+        int throttle = config.pwm_max_us;
+        if (traction_on) {
+            throttle = traction.shapeThrottle(throttle, true, now, motion, config);
+        }
+        model.step(neutral, throttle, config, FRAME_S);
+        const double slip = model.state().wheel_speed_m_s - model.state().speed_m_s;
+        peak_slip = std::max(peak_slip, slip);
+        slip_time += slip > 0.3 ? FRAME_S : 0.0;
+        if (to_5 < 0 && model.state().speed_m_s >= 5.0) {
+            to_5 = frame;
+        }
+    }
+    printf("  %-9s 0-5 m/s in %.2f s, pattinamento massimo %.2f m/s, oltre 0.3 m/s per %.2f s, tagli %llu\n",
+           traction_on ? "trazione" : "diretto", to_5 * FRAME_S, peak_slip, slip_time,
+           static_cast<unsigned long long>(traction.cuts()));
+}
+
+// Costo per comando di gas e sterzo modellati, da sommare al passo di scrittura dei PWM
+void tractionCost(RuntimeConfig config) {
+    config.traction_control = 1;
+    TractionControl traction;
+    VehicleMotion motion;
+    motion.has_accel = true;
+    motion.has_wheel_speed = true;
+    const int calls = 1000000;
+    volatile int sink = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) {
+        const uint64_t now = 1000000 + static_cast<uint64_t>(i) * 1000;
+        motion.stamp_us = now;
+        motion.speed_m_s = (i % 500) / 100.0;
+        motion.wheel_speed_m_s = motion.speed_m_s + (i % 7) / 10.0;
+        motion.accel_long_m_s2 = (i % 11) - 3.0;
+        sink = sink + traction.shapeThrottle(1500 + (i % 500), true, now, motion, config) +
+               traction.shapeSteering(1000 + (i % 1000), now, motion, config);
+    }
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    printf("Controllo di trazione: %.0f ns per comando (gas e sterzo)\n", ns / calls);
+}
+
+void reverseReport(const RuntimeConfig &config, bool sequenced, uint64_t gap_us) {
+    std::mt19937 rng(42);
+    long best = -1;
+    long worst = -1;
+    int failures = 0;
+    const int runs = 1000;
+    for (int i = 0; i < runs; ++i) {
+        const long t = reverseEngagement(config, sequenced, rng, gap_us);
+        if (t < 0) {
+            failures++;
+            continue;
+        }
+        best = best < 0 ? t : std::min(best, t);
+        worst = std::max(worst, t);
+    }
+    printf("  %-10s rilascio %4llu ms: ", sequenced ? "sequencer" : "diretto",
+           static_cast<unsigned long long>(gap_us / 1000));
+    if (best >= 0) {
+        printf("retromarcia in %5.1f-%5.1f ms, ", best / 1000.0, worst / 1000.0);
+    }
+    printf("mancata %d/%d\n", failures, runs);
+}
+}
+
+int main() {
+    const RuntimeConfig config;
+    const int neutral = config.pwm_neutral_us;
+    VehicleModel model;
+
+    const int to_5 = framesUntil(model, config, {neutral, config.pwm_max_us}, 5.0, 500);
+    hold(model, config, {neutral, config.pwm_max_us}, 150 - to_5);
+    printf("Pieno gas: 0-5 m/s in %.2f s, %.2f m/s dopo 3 s\n", to_5 * FRAME_S, model.state().speed_m_s);
+
+    const double brake_from = model.state().speed_m_s;
+    const double start_y = model.state().y_m;
+    const int stop = framesUntil(model, config, {neutral, config.pwm_min_us}, 0.0, 500);
+    printf("Frenata a fondo da %.2f m/s: ferma in %.2f s e %.2f m\n", brake_from, stop * FRAME_S,
+           model.state().y_m - start_y);
+
+    // Il pedale resta sotto il neutro senza mai passare dal folle: l'ESC continua a frenare
+    hold(model, config, {neutral, config.pwm_min_us}, 100);
+    printf("Sotto il neutro per altri 2 s senza folle: %.2f m/s, ESC %s\n", model.state().speed_m_s,
+           simEscStateName(model.state().esc));
+
+    // Doppio tocco: un frame in folle arma la retromarcia, il secondo impulso sotto il neutro la innesta
+    hold(model, config, {neutral, neutral}, 1);
+    const int reverse = framesUntil(model, config, {neutral, config.pwm_min_us}, -1.0, 500);
+    printf("Dopo un frame in folle: -1 m/s in %.2f s, ESC %s\n", reverse * FRAME_S, simEscStateName(model.state().esc));
+
+    // Raggio di curva a sterzo pieno: dalla velocità di imbardata a regime
+    for (double speed : {1.0, 3.0, 8.0}) {
+        model.reset();
+        const int throttle = neutral + static_cast<int>(std::lround(speed / VehicleModel::MAX_SPEED_M_S *
+                                                                    (config.pwm_max_us - neutral)));
+        hold(model, config, {neutral, throttle}, 500);
+        hold(model, config, {config.pwm_max_us, throttle}, 100);
+        const double before = model.state().heading_rad;
+        hold(model, config, {config.pwm_max_us, throttle}, 1);
+        const double yaw_rate = std::remainder(model.state().heading_rad - before, 2.0 * M_PI) / FRAME_S;
+        printf("Sterzo pieno a %.1f m/s: raggio %.2f m, laterale %.2f g\n", model.state().speed_m_s,
+               model.state().speed_m_s / yaw_rate, model.state().accel_lat_m_s2 / 9.81);
+    }
+
+    // Retromarcia in corsa con comandi irregolari: il mappaggio diretto dipende dal rilascio
+    // del pedale, il sequencer no (freno esc_brake_ms, folle esc_gap_ms, poi indietro)
+    printf("Retromarcia in corsa, comandi ogni 10-30 ms:\n");
+    for (uint64_t gap_us : {0ULL, 15000ULL, 40000ULL, 2000000ULL}) {
+        reverseReport(config, false, gap_us);
+        reverseReport(config, true, gap_us);
+    }
+
+    printf("Freno, rilascio, freno in corsa (finestra dell'ESC %d ms):\n", config.esc_arm_window_ms);
+    for (int release_ms : {100, 600, 1200, 3000}) {
+        brakeReleaseBrake(config, release_ms);
+    }
+
+    printf("Partenza a gas pieno:\n");
+    launchReport(config, false);
+    launchReport(config, true);
+    RuntimeConfig slip_only = config;
+    slip_only.accel_limit_cm_s2 = 0;
+    printf("  senza limite di accelerazione:\n");
+    launchReport(slip_only, true);
+    tractionCost(config);
+    return 0;
+}
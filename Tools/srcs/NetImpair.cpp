@@ -0,0 +1,514 @@
+// Proxy UDP che peggiora la rete tra client e Pi sulla stessa macchina, senza tc né permessi di root.
+// Il client parla con il proxy come se fosse il Pi: i comandi vengono inoltrati al Pi (o a Rasp_sim)
+// e il video del Pi viene girato al client, con perdita casuale o a raffiche (Gilbert-Elliott),
+// ritardo, jitter, riordino, duplicati e limite di banda, separati per direzione. Uso:
+//   net_impair [--pi=IP:PORTA] [--listen=PORTA] [--video-listen=PORTA] [--client-video-port=PORTA]
+//              [--scenario=FILE] [--set=DIREZIONE:CHIAVE=VALORE ...] [--seed=N] [--stats=S]
+// Con Rasp_sim sulla stessa macchina (il client si collega a 127.0.0.1 come sempre):
+//   Rasp_sim --set=control_port=9080 --set=video_port=11234
+//   net_impair --scenario=scenarios/wifi-burst.txt
+// Direzioni: control-up (client -> Pi), control-down (Pi -> client), video, control, all.
+// Chiavi:
+//   loss=P                         perdita indipendente (nello stato buono se burst è attivo)
+//   burst=P_ENTRATA,P_USCITA[,P]   Gilbert-Elliott: passaggi buono/cattivo per datagramma, perdita P nel cattivo (1)
+//   delay=MS jitter=MS             ritardo fisso più uniforme in [0, jitter]; l'ordine resta quello di arrivo
+//   reorder=P reorder_ms=MS        trattiene un datagramma di MS in più (10) e lo fa superare dai successivi
+//   duplicate=P                    consegna una seconda copia
+//   rate=KBIT queue_ms=MS          collo di bottiglia con coda di MS (50), poi scarto in coda; 0 = illimitato
+//   clear                          torna alla rete pulita
+// Scenario: una riga per cambio, "SECONDI DIREZIONE CHIAVE=VALORE ...", oppure "SECONDI end" per uscire.
+// Con lo stesso --seed e lo stesso scenario le perdite cadono sugli stessi datagrammi.
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <poll.h>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+constexpr size_t UDP_IP_OVERHEAD = 28; // Header IPv4 + UDP, contati nel limite di banda
+constexpr size_t MAX_DATAGRAM = 65536;
+
+static volatile sig_atomic_t running = 1;
+
+static uint64_t nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Impairment {
+    double loss = 0.0;
+    double burst_enter = 0.0;
+    double burst_exit = 1.0;
+    double burst_loss = 1.0;
+    double delay_ms = 0.0;
+    double jitter_ms = 0.0;
+    double reorder = 0.0;
+    double reorder_ms = 10.0;
+    double duplicate = 0.0;
+    double rate_kbps = 0.0;
+    double queue_ms = 50.0;
+};
+
+struct LinkStats {
+    uint64_t forwarded = 0;
+    uint64_t bytes = 0;
+    uint64_t lost_random = 0;
+    uint64_t lost_burst = 0;
+    uint64_t lost_queue = 0;
+    uint64_t duplicated = 0;
+    uint64_t reordered = 0;
+};
+
+enum LinkId { CONTROL_UP = 0, CONTROL_DOWN = 1, VIDEO = 2, LINKS = 3 };
+static const char *const LINK_NAMES[LINKS] = {"control-up", "control-down", "video"};
+
+// Una direzione del proxy: parametri correnti, stato del canale di Gilbert-Elliott e del collo di bottiglia
+struct Link {
+    Impairment params;
+    bool bad_state = false;
+    uint64_t link_free_us = 0;   // Fine della trasmissione dell'ultimo datagramma accodato
+    uint64_t last_in_order_us = 0;
+    std::mt19937_64 random;
+    LinkStats stats;
+};
+
+// Datagramma in attesa della sua consegna
+struct Pending {
+    uint64_t deliver_us;
+    uint64_t order;  // A parità di istante si consegna nell'ordine di arrivo
+    int sock;
+    sockaddr_in dest;
+    std::vector<uint8_t> data;
+
+    bool operator>(const Pending &other) const {
+        return deliver_us != other.deliver_us ? deliver_us > other.deliver_us : order > other.order;
+    }
+};
+
+struct ScenarioStep {
+    double at_s;
+    std::string direction;
+    std::vector<std::string> settings;
+    bool end;
+};
+
+static bool parseProbability(const std::string &text, double &out) {
+    char *end = nullptr;
+    const double value = std::strtod(text.c_str(), &end);
+    if (text.empty() || *end != '\0' || value < 0.0 || value > 1.0) {
+        return false;
+    }
+    out = value;
+    return true;
+}
+
+static bool parseNonNegative(const std::string &text, double &out) {
+    char *end = nullptr;
+    const double value = std::strtod(text.c_str(), &end);
+    if (text.empty() || *end != '\0' || value < 0.0) {
+        return false;
+    }
+    out = value;
+    return true;
+}
+
+static bool applySetting(Impairment &params, const std::string &setting, std::string &error) {
+    if (setting == "clear") {
+        params = Impairment();
+        return true;
+    }
+    const size_t equal = setting.find('=');
+    const std::string key = setting.substr(0, equal);
+    const std::string value = equal == std::string::npos ? "" : setting.substr(equal + 1);
+    bool ok = false;
+    if (key == "loss") {
+        ok = parseProbability(value, params.loss);
+    } else if (key == "burst") {
+        std::stringstream parts(value);
+        std::string enter, exit, loss = "1";
+        std::getline(parts, enter, ',');
+        std::getline(parts, exit, ',');
+        std::getline(parts, loss, ',');
+        ok = parseProbability(enter, params.burst_enter) && parseProbability(exit, params.burst_exit) &&
+             parseProbability(loss, params.burst_loss) && params.burst_exit > 0.0;
+    } else if (key == "delay") {
+        ok = parseNonNegative(value, params.delay_ms);
+    } else if (key == "jitter") {
+        ok = parseNonNegative(value, params.jitter_ms);
+    } else if (key == "reorder") {
+        ok = parseProbability(value, params.reorder);
+    } else if (key == "reorder_ms") {
+        ok = parseNonNegative(value, params.reorder_ms);
+    } else if (key == "duplicate") {
+        ok = parseProbability(value, params.duplicate);
+    } else if (key == "rate") {
+        ok = parseNonNegative(value, params.rate_kbps);
+    } else if (key == "queue_ms") {
+        ok = parseNonNegative(value, params.queue_ms);
+    }
+    if (!ok) {
+        error = "impostazione non valida '" + setting + "'";
+    }
+    return ok;
+}
+
+// Direzione -> maschera di link; 0 se sconosciuta
+static int directionMask(const std::string &direction) {
+    if (direction == "control-up") {
+        return 1 << CONTROL_UP;
+    } else if (direction == "control-down") {
+        return 1 << CONTROL_DOWN;
+    } else if (direction == "video") {
+        return 1 << VIDEO;
+    } else if (direction == "control") {
+        return (1 << CONTROL_UP) | (1 << CONTROL_DOWN);
+    } else if (direction == "all") {
+        return (1 << LINKS) - 1;
+    }
+    return 0;
+}
+
+// Controlla direzione e impostazioni subito, così uno scenario sbagliato non fallisce a metà prova
+static bool validateStep(const ScenarioStep &step, std::string &error) {
+    if (step.end) {
+        return true;
+    }
+    if (directionMask(step.direction) == 0) {
+        error = "direzione sconosciuta '" + step.direction + "'";
+        return false;
+    }
+    Impairment scratch;
+    for (const std::string &setting : step.settings) {
+        if (!applySetting(scratch, setting, error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool loadScenario(const std::string &path, std::vector<ScenarioStep> &steps) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Impossibile aprire lo scenario " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    int number = 0;
+    while (std::getline(file, line)) {
+        ++number;
+        line = line.substr(0, line.find('#'));
+        std::stringstream tokens(line);
+        std::string time_text;
+        if (!(tokens >> time_text)) {
+            continue;
+        }
+        ScenarioStep step{0.0, "", {}, false};
+        std::string word;
+        tokens >> step.direction;
+        while (tokens >> word) {
+            step.settings.push_back(word);
+        }
+        step.end = step.direction == "end";
+        std::string error;
+        if (!parseNonNegative(time_text, step.at_s)) {
+            error = "istante non valido '" + time_text + "'";
+        }
+        if (!error.empty() || !validateStep(step, error)) {
+            std::cerr << path << ":" << number << ": " << error << std::endl;
+            return false;
+        }
+        steps.push_back(step);
+    }
+    return true;
+}
+
+static void applyStep(Link (&links)[LINKS], const ScenarioStep &step) {
+    std::string error;
+    const int mask = directionMask(step.direction);
+    for (int i = 0; i < LINKS; ++i) {
+        if (mask & (1 << i)) {
+            for (const std::string &setting : step.settings) {
+                applySetting(links[i].params, setting, error);
+            }
+        }
+    }
+    std::cout << "[" << step.at_s << " s] " << step.direction;
+    for (const std::string &setting : step.settings) {
+        std::cout << " " << setting;
+    }
+    std::cout << std::endl;
+}
+
+// Decide la sorte di un datagramma: quante copie e quando consegnarle (0, 1 o 2 istanti)
+static int scheduleDatagram(Link &link, size_t size, uint64_t now, uint64_t deliver[2]) {
+    const Impairment &p = link.params;
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    // Canale di Gilbert-Elliott: lo stato avanza a ogni datagramma, poi si pesca la perdita
+    if (p.burst_enter > 0.0) {
+        link.bad_state = link.bad_state ? uniform(link.random) >= p.burst_exit : uniform(link.random) < p.burst_enter;
+    } else {
+        link.bad_state = false;
+    }
+    if (uniform(link.random) < (link.bad_state ? p.burst_loss : p.loss)) {
+        ++(link.bad_state ? link.stats.lost_burst : link.stats.lost_random);
+        return 0;
+    }
+
+    // Collo di bottiglia: il datagramma parte quando il link ha finito con i precedenti
+    uint64_t depart = now;
+    if (p.rate_kbps > 0.0) {
+        const uint64_t start = std::max(now, link.link_free_us);
+        if (start - now > static_cast<uint64_t>(p.queue_ms * 1000.0)) {
+            ++link.stats.lost_queue;
+            return 0;
+        }
+        link.link_free_us = start + static_cast<uint64_t>((size + UDP_IP_OVERHEAD) * 8 * 1000.0 / p.rate_kbps);
+        depart = link.link_free_us;
+    }
+
+    uint64_t at = depart + static_cast<uint64_t>((p.delay_ms + p.jitter_ms * uniform(link.random)) * 1000.0);
+    if (p.reorder > 0.0 && uniform(link.random) < p.reorder) {
+        at += static_cast<uint64_t>(p.reorder_ms * 1000.0);
+        ++link.stats.reordered;
+    } else {
+        at = std::max(at, link.last_in_order_us);
+        link.last_in_order_us = at;
+    }
+    ++link.stats.forwarded;
+    link.stats.bytes += size;
+    deliver[0] = at;
+    if (p.duplicate > 0.0 && uniform(link.random) < p.duplicate) {
+        ++link.stats.duplicated;
+        deliver[1] = at;
+        return 2;
+    }
+    return 1;
+}
+
+static void printStats(const Link (&links)[LINKS]) {
+    for (int i = 0; i < LINKS; ++i) {
+        const LinkStats &s = links[i].stats;
+        printf("%-13s inoltrati %8llu (%7.1f kB), persi casuali %6llu, a raffica %6llu, in coda %6llu, "
+               "duplicati %5llu, riordinati %5llu\n", LINK_NAMES[i], static_cast<unsigned long long>(s.forwarded),
+               s.bytes / 1000.0, static_cast<unsigned long long>(s.lost_random),
+               static_cast<unsigned long long>(s.lost_burst), static_cast<unsigned long long>(s.lost_queue),
+               static_cast<unsigned long long>(s.duplicated), static_cast<unsigned long long>(s.reordered));
+    }
+    fflush(stdout);
+}
+
+static bool parseEndpoint(const std::string &text, sockaddr_in &addr) {
+    const size_t colon = text.find(':');
+    addr = sockaddr_in{};
+    addr.sin_family = AF_INET;
+    const int port = colon == std::string::npos ? 0 : std::atoi(text.c_str() + colon + 1);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    return port > 0 && port < 65536 && inet_pton(AF_INET, text.substr(0, colon).c_str(), &addr.sin_addr) == 1;
+}
+
+static int bindUdp(int port) {
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    int rcvbuf = 1 << 20;
+    if (sock >= 0) {
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    }
+    if (sock < 0 || bind(sock, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+        std::cerr << "Impossibile usare la porta " << port << ": " << strerror(errno) << std::endl;
+        if (sock >= 0) {
+            close(sock);
+        }
+        return -1;
+    }
+    return sock;
+}
+
+int main(int argc, char **argv) {
+    sockaddr_in pi_addr{};
+    parseEndpoint("127.0.0.1:9080", pi_addr);
+    int listen_port = 8080;
+    int video_listen_port = 11234;
+    int client_video_port = 1234;
+    int stats_s = 5;
+    uint64_t seed = 1;
+    std::vector<ScenarioStep> steps;
+    std::vector<ScenarioStep> overrides;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::string error;
+        if (arg.rfind("--pi=", 0) == 0) {
+            if (!parseEndpoint(arg.substr(5), pi_addr)) {
+                std::cerr << "Indirizzo del Pi non valido: " << arg.substr(5) << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (arg.rfind("--listen=", 0) == 0 && std::atoi(arg.c_str() + 9) > 0) {
+            listen_port = std::atoi(arg.c_str() + 9);
+        } else if (arg.rfind("--video-listen=", 0) == 0 && std::atoi(arg.c_str() + 15) > 0) {
+            video_listen_port = std::atoi(arg.c_str() + 15);
+        } else if (arg.rfind("--client-video-port=", 0) == 0 && std::atoi(arg.c_str() + 20) > 0) {
+            client_video_port = std::atoi(arg.c_str() + 20);
+        } else if (arg.rfind("--scenario=", 0) == 0) {
+            if (!loadScenario(arg.substr(11), steps)) {
+                return EXIT_FAILURE;
+            }
+        } else if (arg.rfind("--set=", 0) == 0 && arg.find(':') != std::string::npos) {
+            const size_t colon = arg.find(':');
+            ScenarioStep step{0.0, arg.substr(6, colon - 6), {arg.substr(colon + 1)}, false};
+            if (!validateStep(step, error)) {
+                std::cerr << arg << ": " << error << std::endl;
+                return EXIT_FAILURE;
+            }
+            overrides.push_back(step);
+        } else if (arg.rfind("--seed=", 0) == 0) {
+            seed = std::strtoull(arg.c_str() + 7, nullptr, 10);
+        } else if (arg.rfind("--stats=", 0) == 0 && std::atoi(arg.c_str() + 8) > 0) {
+            stats_s = std::atoi(arg.c_str() + 8);
+        } else {
+            std::cerr << "Uso: " << argv[0] << " [--pi=IP:PORTA] [--listen=PORTA] [--video-listen=PORTA]"
+                      << " [--client-video-port=PORTA] [--scenario=FILE] [--set=DIREZIONE:CHIAVE=VALORE]"
+                      << " [--seed=N] [--stats=S]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    // Le --set valgono dall'inizio e prevalgono sulle righe a 0 s dello scenario
+    steps.insert(steps.end(), overrides.begin(), overrides.end());
+    std::stable_sort(steps.begin(), steps.end(),
+                     [](const ScenarioStep &a, const ScenarioStep &b) { return a.at_s < b.at_s; });
+
+    signal(SIGINT, [](int) { running = 0; });
+    signal(SIGTERM, [](int) { running = 0; });
+
+    // Lato client: comandi sulla porta del Pi; lato Pi: un socket connesso per i comandi e la
+    // porta su cui il Pi manda il video (il suo video_port)
+    const int client_sock = bindUdp(listen_port);
+    const int video_sock = bindUdp(video_listen_port);
+    const int pi_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (client_sock < 0 || video_sock < 0 || pi_sock < 0 ||
+        connect(pi_sock, reinterpret_cast<sockaddr *>(&pi_addr), sizeof(pi_addr)) < 0) {
+        std::cerr << "Impossibile configurare i socket del proxy: " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Link links[LINKS];
+    for (int i = 0; i < LINKS; ++i) {
+        links[i].random.seed(seed * LINKS + i); // Sequenze indipendenti per direzione
+    }
+
+    char pi_text[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &pi_addr.sin_addr, pi_text, sizeof(pi_text));
+    std::cout << "Proxy: client sulla porta " << listen_port << " -> Pi " << pi_text << ":" << ntohs(pi_addr.sin_port)
+              << ", video dalla porta " << video_listen_port << " -> client:" << client_video_port << std::endl;
+
+    std::priority_queue<Pending, std::vector<Pending>, std::greater<Pending>> pending;
+    uint64_t order = 0;
+    sockaddr_in client_addr{};
+    bool has_client = false;
+    size_t next_step = 0;
+    const uint64_t start_us = nowMicros();
+    uint64_t next_print_us = start_us + static_cast<uint64_t>(stats_s) * 1000000;
+    std::vector<uint8_t> datagram(MAX_DATAGRAM);
+
+    while (running) {
+        uint64_t now = nowMicros();
+        while (next_step < steps.size() && now - start_us >= static_cast<uint64_t>(steps[next_step].at_s * 1e6)) {
+            if (steps[next_step].end) {
+                running = 0;
+                break;
+            }
+            applyStep(links, steps[next_step++]);
+        }
+        while (!pending.empty() && pending.top().deliver_us <= now) {
+            const Pending &top = pending.top();
+            sendto(top.sock, top.data.data(), top.data.size(), 0, reinterpret_cast<const sockaddr *>(&top.dest),
+                   sizeof(top.dest));
+            pending.pop();
+        }
+        if (now >= next_print_us) {
+            printStats(links);
+            next_print_us = now + static_cast<uint64_t>(stats_s) * 1000000;
+        }
+
+        // Si dorme fino alla prossima consegna, al prossimo passo dello scenario o alle statistiche
+        uint64_t wake_us = next_print_us;
+        if (!pending.empty()) {
+            wake_us = std::min(wake_us, pending.top().deliver_us);
+        }
+        if (next_step < steps.size()) {
+            wake_us = std::min(wake_us, start_us + static_cast<uint64_t>(steps[next_step].at_s * 1e6));
+        }
+        const uint64_t wait_us = wake_us > now ? wake_us - now : 0;
+        const timespec timeout = {static_cast<time_t>(wait_us / 1000000), static_cast<long>(wait_us % 1000000) * 1000};
+        pollfd fds[3] = {{client_sock, POLLIN, 0}, {pi_sock, POLLIN, 0}, {video_sock, POLLIN, 0}};
+        if (ppoll(fds, 3, &timeout, nullptr) <= 0) {
+            continue;
+        }
+
+        now = nowMicros();
+        for (int i = 0; i < 3; ++i) {
+            if (!(fds[i].revents & POLLIN)) {
+                continue;
+            }
+            // Svuota il socket: sotto raffica di video un datagramma per giro non basterebbe
+            while (true) {
+                sockaddr_in from{};
+                socklen_t from_len = sizeof(from);
+                const ssize_t n = recvfrom(fds[i].fd, datagram.data(), datagram.size(), MSG_DONTWAIT,
+                                           reinterpret_cast<sockaddr *>(&from), &from_len);
+                if (n < 0) {
+                    break;
+                }
+                Link *link;
+                Pending out{0, 0, -1, {}, {}};
+                if (fds[i].fd == client_sock) {
+                    client_addr = from; // L'ultimo mittente è il client: segue anche un suo riavvio
+                    has_client = true;
+                    link = &links[CONTROL_UP];
+                    out.sock = pi_sock;
+                    out.dest = pi_addr;
+                } else if (!has_client) {
+                    continue; // Niente da fare con le risposte o il video prima che il client si presenti
+                } else if (fds[i].fd == pi_sock) {
+                    link = &links[CONTROL_DOWN];
+                    out.sock = client_sock;
+                    out.dest = client_addr;
+                } else {
+                    link = &links[VIDEO];
+                    out.sock = video_sock;
+                    out.dest = client_addr;
+                    out.dest.sin_port = htons(static_cast<uint16_t>(client_video_port));
+                }
+                uint64_t deliver[2];
+                const int copies = scheduleDatagram(*link, static_cast<size_t>(n), now, deliver);
+                out.data.assign(datagram.begin(), datagram.begin() + n);
+                for (int c = 0; c < copies; ++c) {
+                    out.deliver_us = deliver[c];
+                    out.order = order++;
+                    pending.push(out);
+                }
+            }
+        }
+    }
+
+    std::cout << "=== Risultato finale dopo " << (nowMicros() - start_us) / 1000000.0 << " s" << std::endl;
+    printStats(links);
+    close(client_sock);
+    close(pi_sock);
+    close(video_sock);
+    return 0;
+}
@@ -0,0 +1,368 @@
+// Misura la latenza del video fase per fase, dal Pi (o da Rasp_sim sulla stessa macchina)
+// fino alla decodifica. Uso:
+//   video_latency <ip_pi> [--duration=S] [--decode=WxH] [--vsync=HZ]
+// --decode passa i frame a ffmpeg e misura quando esce ogni immagine decodificata
+// (richiede una sorgente decodificabile: camera o testsrc). --vsync modella la presentazione
+// sul primo refresh successivo alla decodifica di un display a HZ.
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <csignal>
+#include <cerrno>
+
+#include "rrc_auth.hpp"
+#include "rrc_link.hpp"
+#include "rrc_proto.hpp"
+#include "rrc_stats.hpp"
+#include "rrc_stream.hpp"
+
+#define PORT 8080
+#define VIDEO_PORT 1234
+
+constexpr size_t FRAME_RING = 256;
+
+static volatile sig_atomic_t running = 1;
+
+static uint64_t nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Fasi misurate per ogni frame
+struct Stages {
+    LatencyHistogram encoder_to_send; // Uscita encoder -> invio (relay, FEC), orologio del Pi
+    LatencyHistogram network;         // Invio -> primo pacchetto ricevuto (con offset di orologio)
+    LatencyHistogram reassembly;      // Primo pacchetto -> frame completo (incluso recupero FEC)
+    LatencyHistogram decode;          // Frame completo -> immagine decodificata
+    LatencyHistogram present;         // Immagine decodificata -> refresh del display
+    LatencyHistogram total;           // Uscita encoder -> ultima fase misurata
+};
+
+struct PendingDecode {
+    int64_t capture_client_us; // capture_us del Pi riportato sull'orologio locale
+    uint64_t complete_us;
+};
+
+// Decodifica con ffmpeg: i frame entrano da stdin, le immagini in scala di grigi escono da stdout
+// nello stesso ordine (nessun B-frame con rpicam-vid o libx264 zerolatency).
+class Decoder {
+public:
+    bool start(int width, int height, Stages &stages, std::mutex &stats_mutex, int vsync_hz) {
+        int in_pipe[2];
+        int out_pipe[2];
+        if (pipe(in_pipe) < 0 || pipe(out_pipe) < 0) {
+            perror("pipe");
+            return false;
+        }
+
+        pid_ = fork();
+        if (pid_ == 0) {
+            dup2(in_pipe[0], STDIN_FILENO);
+            dup2(out_pipe[1], STDOUT_FILENO);
+            close(in_pipe[1]);
+            close(out_pipe[0]);
+            execlp("ffmpeg", "ffmpeg", "-loglevel", "quiet", "-fflags", "nobuffer", "-flags", "low_delay",
+                   "-probesize", "32", "-threads", "1", "-f", "h264", "-i", "pipe:0",
+                   "-f", "rawvideo", "-pix_fmt", "gray", "pipe:1", (char *)NULL);
+            _exit(EXIT_FAILURE);
+        }
+        close(in_pipe[0]);
+        close(out_pipe[1]);
+        if (pid_ < 0) {
+            return false;
+        }
+
+        input_fd_ = in_pipe[1];
+        output_fd_ = out_pipe[0];
+        frame_bytes_ = static_cast<size_t>(width) * height;
+        reader_ = std::thread(&Decoder::readLoop, this, std::ref(stages), std::ref(stats_mutex), vsync_hz);
+        return true;
+    }
+
+    void submit(const VideoFrame &frame, const PendingDecode &pending) {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            queue_.push_back(pending);
+        }
+        const uint8_t *data = frame.data;
+        size_t left = frame.size;
+        while (left > 0) {
+            ssize_t n = write(input_fd_, data, left);
+            if (n <= 0) {
+                return;
+            }
+            data += n;
+            left -= n;
+        }
+    }
+
+    void stop() {
+        if (pid_ <= 0) {
+            return;
+        }
+        close(input_fd_);
+        kill(pid_, SIGTERM);
+        waitpid(pid_, nullptr, 0);
+        if (reader_.joinable()) {
+            reader_.join();
+        }
+        close(output_fd_);
+        pid_ = -1;
+    }
+
+private:
+    void readLoop(Stages &stages, std::mutex &stats_mutex, int vsync_hz) {
+        std::string image(frame_bytes_, '\0');
+        while (true) {
+            size_t got = 0;
+            while (got < frame_bytes_) {
+                ssize_t n = read(output_fd_, &image[got], frame_bytes_ - got);
+                if (n <= 0) {
+                    return;
+                }
+                got += n;
+            }
+
+            const uint64_t decoded_us = nowMicros();
+            PendingDecode pending;
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex_);
+                if (queue_.empty()) {
+                    continue;
+                }
+                pending = queue_.front();
+                queue_.pop_front();
+            }
+
+            uint64_t present_us = decoded_us;
+            if (vsync_hz > 0) {
+                const uint64_t period = 1000000 / vsync_hz;
+                present_us = (decoded_us / period + 1) * period;
+            }
+
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            stages.decode.record(static_cast<int64_t>(decoded_us - pending.complete_us));
+            stages.present.record(static_cast<int64_t>(present_us - decoded_us));
+            stages.total.record(static_cast<int64_t>(present_us) - pending.capture_client_us);
+        }
+    }
+
+    pid_t pid_ = -1;
+    int input_fd_ = -1;
+    int output_fd_ = -1;
+    size_t frame_bytes_ = 0;
+    std::thread reader_;
+    std::mutex queue_mutex_;
+    std::deque<PendingDecode> queue_;
+};
+
+static void printStages(const Stages &stages, const ClockSync &clock, bool decoding) {
+    std::cout << "--- offset orologio " << clock.offsetUs() << " us, rtt " << clock.rttUs() << " us" << std::endl;
+    std::cout << "encoder->invio    " << stages.encoder_to_send.summary() << std::endl;
+    std::cout << "rete              " << stages.network.summary() << std::endl;
+    std::cout << "riassemblaggio    " << stages.reassembly.summary() << std::endl;
+    if (decoding) {
+        std::cout << "decodifica        " << stages.decode.summary() << std::endl;
+        std::cout << "presentazione     " << stages.present.summary() << std::endl;
+    }
+    std::cout << "totale            " << stages.total.summary() << std::endl;
+}
+
+static ControlAuth control_auth; // Stessa chiave del Pi (RRC_PSK), altrimenti i messaggi vengono scartati
+
+static void sendTimeRequest(int sock) {
+    TimeSync sync;
+    sync.client_send_us = nowMicros();
+    uint8_t request[TIME_SYNC_SIZE + AUTH_TRAILER_SIZE];
+    writeTimeSync(request, MSG_TIME_REQUEST, sync);
+    send(sock, request, control_auth.seal(request, TIME_SYNC_SIZE), 0);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cerr << "Uso: " << argv[0] << " <ip_pi> [--duration=S] [--decode=WxH] [--vsync=HZ]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    int duration_s = 30;
+    int decode_width = 0;
+    int decode_height = 0;
+    int vsync_hz = 0;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--duration=", 0) == 0) {
+            duration_s = std::atoi(arg.c_str() + 11);
+        } else if (arg.rfind("--decode=", 0) == 0) {
+            sscanf(arg.c_str() + 9, "%dx%d", &decode_width, &decode_height);
+        } else if (arg.rfind("--vsync=", 0) == 0) {
+            vsync_hz = std::atoi(arg.c_str() + 8);
+        } else {
+            std::cerr << "Opzione non valida: " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    signal(SIGINT, [](int) { running = 0; });
+    signal(SIGPIPE, SIG_IGN);
+
+    sockaddr_in pi_addr{};
+    pi_addr.sin_family = AF_INET;
+    pi_addr.sin_port = htons(PORT);
+    if (inet_pton(AF_INET, argv[1], &pi_addr.sin_addr) <= 0) {
+        std::cerr << "Indirizzo IP non valido: " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    int control_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    int video_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in video_addr{};
+    video_addr.sin_family = AF_INET;
+    video_addr.sin_addr.s_addr = INADDR_ANY;
+    video_addr.sin_port = htons(VIDEO_PORT);
+    int rcvbuf = 1 << 20;
+    setsockopt(video_sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    if (control_sock < 0 || video_sock < 0 ||
+        connect(control_sock, reinterpret_cast<sockaddr *>(&pi_addr), sizeof(pi_addr)) < 0 ||
+        bind(video_sock, reinterpret_cast<sockaddr *>(&video_addr), sizeof(video_addr)) < 0) {
+        std::cerr << "Impossibile configurare i socket: " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    control_auth.loadFromEnv();
+
+    Stages stages;
+    std::mutex stats_mutex;
+    ClockSync clock;
+    VideoDepacketizer depacketizer;
+    Decoder decoder;
+    const bool decoding = decode_width > 0 && decode_height > 0;
+    if (decoding && !decoder.start(decode_width, decode_height, stages, stats_mutex, vsync_hz)) {
+        std::cerr << "Impossibile avviare ffmpeg per la decodifica" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Primo pacchetto ricevuto per ogni frame, indicizzato per frame_id
+    uint32_t ring_id[FRAME_RING] = {};
+    uint64_t ring_first_us[FRAME_RING] = {};
+
+    const uint64_t start_us = nowMicros();
+    uint64_t next_sync_us = start_us;
+    uint64_t next_hello_us = start_us;
+    bool busy_reported = false;
+    uint32_t challenge = 0; // Sfida del Pi con l'autenticazione attiva
+    uint64_t next_print_us = start_us + 5000000;
+    int sync_burst = 8; // Raffica iniziale per avere subito un offset affidabile
+    uint8_t datagram[2048];
+
+    std::cout << "Misura della latenza video da " << argv[1] << " per " << duration_s << " s" << std::endl;
+
+    while (running && nowMicros() - start_us < static_cast<uint64_t>(duration_s) * 1000000) {
+        const uint64_t now = nowMicros();
+        // Hello periodici: ottengono e rinnovano il lease, che fa partire il video verso questo host.
+        // Nessun comando di guida viene inviato: l'auto resta in folle.
+        if (now >= next_hello_us) {
+            uint8_t hello[HELLO_SIZE + AUTH_TRAILER_SIZE];
+            writeHello(hello, 1, challenge);
+            send(control_sock, hello, control_auth.seal(hello, HELLO_SIZE), 0);
+            next_hello_us = now + 250000;
+        }
+        if (now >= next_sync_us) {
+            sendTimeRequest(control_sock);
+            next_sync_us = now + (sync_burst > 0 ? 20000 : 1000000);
+            sync_burst--;
+        }
+        if (now >= next_print_us) {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            printStages(stages, clock, decoding);
+            next_print_us = now + 5000000;
+        }
+
+        pollfd fds[2] = {{control_sock, POLLIN, 0}, {video_sock, POLLIN, 0}};
+        if (poll(fds, 2, 20) <= 0) {
+            continue;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            ssize_t n = recv(control_sock, datagram, sizeof(datagram), 0);
+            TimeSync sync;
+            SessionAccept accept;
+            size_t len = 0;
+            uint32_t counter;
+            if (n <= 0 || !control_auth.open(datagram, n, len, counter)) {
+                len = 0;
+            }
+            if (len > 0 && parseTimeSync(datagram, len, MSG_TIME_REPLY, sync)) {
+                clock.onReply(sync, nowMicros());
+            } else if (len > 0 && parseAccept(datagram, len, accept)) {
+                if (accept.status == SESSION_CHALLENGE && accept.token != challenge) {
+                    challenge = accept.token;
+                    next_hello_us = nowMicros(); // Hello di nuovo subito, con la sfida
+                } else if (accept.status == SESSION_BUSY && !busy_reported) {
+                    std::cerr << "Il Pi è guidato da un altro client: nessun video finché il lease non si libera"
+                              << std::endl;
+                    busy_reported = true;
+                }
+            }
+        }
+
+        if (!(fds[1].revents & POLLIN)) {
+            continue;
+        }
+        ssize_t n = recv(video_sock, datagram, sizeof(datagram), 0);
+        const uint64_t recv_us = nowMicros();
+        VideoPacketHeader header;
+        if (n <= 0 || !parseVideoHeader(datagram, n, header)) {
+            continue;
+        }
+
+        const size_t slot = header.frame_id % FRAME_RING;
+        if (ring_id[slot] != header.frame_id || ring_first_us[slot] == 0) {
+            ring_id[slot] = header.frame_id;
+            ring_first_us[slot] = recv_us;
+        }
+
+        if (!depacketizer.push(datagram, n) || !clock.valid()) {
+            continue;
+        }
+
+        // Tempi del Pi: capture_us a 64 bit, send_us modulo 2^32 relativo alla cattura
+        const uint64_t encoder_to_send = static_cast<uint32_t>(header.send_us - static_cast<uint32_t>(header.capture_us));
+        const int64_t send_pi_us = static_cast<int64_t>(header.capture_us + encoder_to_send);
+        const int64_t capture_client_us = static_cast<int64_t>(header.capture_us) - clock.offsetUs();
+        const uint64_t first_us = ring_first_us[slot];
+
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            stages.encoder_to_send.record(static_cast<int64_t>(encoder_to_send));
+            stages.network.record(clock.toServer(first_us) - send_pi_us);
+            stages.reassembly.record(static_cast<int64_t>(recv_us - first_us));
+            if (!decoding) {
+                stages.total.record(static_cast<int64_t>(recv_us) - capture_client_us);
+            }
+        }
+        if (decoding) {
+            decoder.submit(depacketizer.frame(), {capture_client_us, recv_us});
+        }
+    }
+
+    decoder.stop();
+    const VideoReceiveStats &video = depacketizer.stats();
+    std::cout << "=== Risultato finale: frame " << video.frames_complete << ", persi " << video.frames_dropped
+              << ", pacchetti recuperati " << video.recovered << std::endl;
+    printStages(stages, clock, decoding);
+
+    close(control_sock);
+    close(video_sock);
+    return 0;
+}